@@ -1,5 +1,8 @@
 #/bin/bash
 
+# Objects shared by the C++ examples are built outside of the source tree.
+X9_TMP_DIR=$(mktemp -d)
+
 echo "- Running examples with GCC with \"-fsanitize=thread,undefined\" enabled.";
 gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_1.c ../x9.c -o X9_TEST_1 -fsanitize=thread,undefined -D X9_DEBUG
 gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_2.c ../x9.c -o X9_TEST_2 -fsanitize=thread,undefined -D X9_DEBUG
@@ -7,9 +10,25 @@ gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_3.c ../x9.c -o
 gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_4.c ../x9.c -o X9_TEST_4 -fsanitize=thread,undefined -D X9_DEBUG
 gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_5.c ../x9.c -o X9_TEST_5 -fsanitize=thread,undefined -D X9_DEBUG
 gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_6.c ../x9.c -o X9_TEST_6 -fsanitize=thread,undefined -D X9_DEBUG
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_7.c ../x9.c -o X9_TEST_7 -fsanitize=thread,undefined -D X9_DEBUG
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_8.c ../x9.c -o X9_TEST_8 -fsanitize=thread,undefined -D X9_DEBUG
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_9.c ../x9.c -o X9_TEST_9 -fsanitize=thread,undefined -D X9_DEBUG -D X9_STATS
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_10.c ../x9.c -o X9_TEST_10 -fsanitize=thread,undefined -D X9_DEBUG
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_11.c ../x9.c -o X9_TEST_11 -fsanitize=thread,undefined -D X9_DEBUG -D X9_LATENCY
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_12.c ../x9.c -o X9_TEST_12 -fsanitize=thread,undefined -D X9_DEBUG
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_13.c ../x9.c -o X9_TEST_13 -fsanitize=thread,undefined -D X9_DEBUG
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_14.c ../x9.c -o X9_TEST_14 -fsanitize=thread,undefined -D X9_DEBUG
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_15.c ../x9.c -o X9_TEST_15 -fsanitize=thread,undefined -D X9_DEBUG -D X9_LATENCY
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_16.c ../x9.c -o X9_TEST_16 -fsanitize=thread,undefined -D X9_DEBUG
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native -c ../x9.c -o "$X9_TMP_DIR"/X9_C.o -fsanitize=thread,undefined -D X9_DEBUG
+g++ -std=c++20 -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_17.cpp "$X9_TMP_DIR"/X9_C.o -o X9_TEST_17 -fsanitize=thread,undefined -D X9_DEBUG
+g++ -std=c++20 -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_18.cpp "$X9_TMP_DIR"/X9_C.o -o X9_TEST_18 -fsanitize=thread,undefined -D X9_DEBUG
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_19.c ../x9.c -o X9_TEST_19 -fsanitize=thread,undefined -D X9_DEBUG
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_20.c ../x9.c -o X9_TEST_20 -fsanitize=thread,undefined -D X9_DEBUG
+gcc -Wextra -Wall -Werror -pedantic -O3 -march=native x9_example_21.c ../x9.c -o X9_TEST_21 -fsanitize=thread,undefined -D X9_DEBUG -D X9_TRACE
 
-./X9_TEST_1; ./X9_TEST_2; ./X9_TEST_3; ./X9_TEST_4; ./X9_TEST_5; ./X9_TEST_6
-rm X9_TEST_1 X9_TEST_2 X9_TEST_3 X9_TEST_4 X9_TEST_5 X9_TEST_6
+./X9_TEST_1; ./X9_TEST_2; ./X9_TEST_3; ./X9_TEST_4; ./X9_TEST_5; ./X9_TEST_6; ./X9_TEST_7; ./X9_TEST_8; ./X9_TEST_9; ./X9_TEST_10; ./X9_TEST_11; ./X9_TEST_12; ./X9_TEST_13; ./X9_TEST_14; ./X9_TEST_15; ./X9_TEST_16; ./X9_TEST_17; ./X9_TEST_18; ./X9_TEST_19; ./X9_TEST_20; ./X9_TEST_21
+rm X9_TEST_1 X9_TEST_2 X9_TEST_3 X9_TEST_4 X9_TEST_5 X9_TEST_6 X9_TEST_7 X9_TEST_8 X9_TEST_9 X9_TEST_10 X9_TEST_11 X9_TEST_12 X9_TEST_13 X9_TEST_14 X9_TEST_15 X9_TEST_16 X9_TEST_17 X9_TEST_18 X9_TEST_19 X9_TEST_20 X9_TEST_21 "$X9_TMP_DIR"/X9_C.o
 
 echo ""
 echo "- Running examples with clang with \"-fsanitize=address,undefined,leak\" enabled.";
@@ -20,7 +39,24 @@ clang -Wextra -Wall -Werror -O3 -march=native x9_example_3.c ../x9.c -o X9_TEST_
 clang -Wextra -Wall -Werror -O3 -march=native x9_example_4.c ../x9.c -o X9_TEST_4 -fsanitize=address,undefined,leak -D X9_DEBUG
 clang -Wextra -Wall -Werror -O3 -march=native x9_example_5.c ../x9.c -o X9_TEST_5 -fsanitize=address,undefined,leak -D X9_DEBUG
 clang -Wextra -Wall -Werror -O3 -march=native x9_example_6.c ../x9.c -o X9_TEST_6 -fsanitize=address,undefined,leak -D X9_DEBUG
+clang -Wextra -Wall -Werror -O3 -march=native x9_example_7.c ../x9.c -o X9_TEST_7 -fsanitize=address,undefined,leak -D X9_DEBUG
+clang -Wextra -Wall -Werror -O3 -march=native x9_example_8.c ../x9.c -o X9_TEST_8 -fsanitize=address,undefined,leak -D X9_DEBUG
+clang -Wextra -Wall -Werror -O3 -march=native x9_example_9.c ../x9.c -o X9_TEST_9 -fsanitize=address,undefined,leak -D X9_DEBUG -D X9_STATS
+clang -Wextra -Wall -Werror -O3 -march=native x9_example_10.c ../x9.c -o X9_TEST_10 -fsanitize=address,undefined,leak -D X9_DEBUG
+clang -Wextra -Wall -Werror -O3 -march=native x9_example_11.c ../x9.c -o X9_TEST_11 -fsanitize=address,undefined,leak -D X9_DEBUG -D X9_LATENCY
+clang -Wextra -Wall -Werror -O3 -march=native x9_example_12.c ../x9.c -o X9_TEST_12 -fsanitize=address,undefined,leak -D X9_DEBUG
+clang -Wextra -Wall -Werror -O3 -march=native x9_example_13.c ../x9.c -o X9_TEST_13 -fsanitize=address,undefined,leak -D X9_DEBUG
+clang -Wextra -Wall -Werror -O3 -march=native x9_example_14.c ../x9.c -o X9_TEST_14 -fsanitize=address,undefined,leak -D X9_DEBUG
+clang -Wextra -Wall -Werror -O3 -march=native x9_example_15.c ../x9.c -o X9_TEST_15 -fsanitize=address,undefined,leak -D X9_DEBUG -D X9_LATENCY
+clang -Wextra -Wall -Werror -O3 -march=native x9_example_16.c ../x9.c -o X9_TEST_16 -fsanitize=address,undefined,leak -D X9_DEBUG
+clang -Wextra -Wall -Werror -O3 -march=native -c ../x9.c -o "$X9_TMP_DIR"/X9_C.o -fsanitize=address,undefined,leak -D X9_DEBUG
+clang++ -std=c++20 -Wextra -Wall -Werror -O3 -march=native x9_example_17.cpp "$X9_TMP_DIR"/X9_C.o -o X9_TEST_17 -fsanitize=address,undefined,leak -D X9_DEBUG
+clang++ -std=c++20 -Wextra -Wall -Werror -O3 -march=native x9_example_18.cpp "$X9_TMP_DIR"/X9_C.o -o X9_TEST_18 -fsanitize=address,undefined,leak -D X9_DEBUG
+clang -Wextra -Wall -Werror -O3 -march=native x9_example_19.c ../x9.c -o X9_TEST_19 -fsanitize=address,undefined,leak -D X9_DEBUG
+clang -Wextra -Wall -Werror -O3 -march=native x9_example_20.c ../x9.c -o X9_TEST_20 -fsanitize=address,undefined,leak -D X9_DEBUG
+clang -Wextra -Wall -Werror -O3 -march=native x9_example_21.c ../x9.c -o X9_TEST_21 -fsanitize=address,undefined,leak -D X9_DEBUG -D X9_TRACE
 
-./X9_TEST_1; ./X9_TEST_2; ./X9_TEST_3; ./X9_TEST_4; ./X9_TEST_5; ./X9_TEST_6
-rm X9_TEST_1 X9_TEST_2 X9_TEST_3 X9_TEST_4 X9_TEST_5 X9_TEST_6 
+./X9_TEST_1; ./X9_TEST_2; ./X9_TEST_3; ./X9_TEST_4; ./X9_TEST_5; ./X9_TEST_6; ./X9_TEST_7; ./X9_TEST_8; ./X9_TEST_9; ./X9_TEST_10; ./X9_TEST_11; ./X9_TEST_12; ./X9_TEST_13; ./X9_TEST_14; ./X9_TEST_15; ./X9_TEST_16; ./X9_TEST_17; ./X9_TEST_18; ./X9_TEST_19; ./X9_TEST_20; ./X9_TEST_21
+rm X9_TEST_1 X9_TEST_2 X9_TEST_3 X9_TEST_4 X9_TEST_5 X9_TEST_6 X9_TEST_7 X9_TEST_8 X9_TEST_9 X9_TEST_10 X9_TEST_11 X9_TEST_12 X9_TEST_13 X9_TEST_14 X9_TEST_15 X9_TEST_16 X9_TEST_17 X9_TEST_18 X9_TEST_19 X9_TEST_20 X9_TEST_21 "$X9_TMP_DIR"/X9_C.o
 
+rm -r "$X9_TMP_DIR"
@@ -0,0 +1,176 @@
+/* x9_example_10.c
+ *
+ *  One producer
+ *  One consumer
+ *  One monitor
+ *  One message type
+ *
+ *  ┌────────┐       ┏━━━━━━━━┓       ┌────────┐
+ *  │Producer│──────▷┃ inbox  ┃◁ ─ ─ ─│Consumer│
+ *  └────────┘       ┗━━━━━━━━┛       └────────┘
+ *                       △
+ *                       │
+ *                   ┌───────┐
+ *                   │Monitor│
+ *                   └───────┘
+ *
+ *  This example showcases how a monitoring thread can poll the depth of an
+ *  inbox while it is in use, and track its high-water mark.
+ *
+ *  Data structures used:
+ *   - x9_inbox
+ *
+ *  Functions used:
+ *   - x9_create_inbox
+ *   - x9_inbox_is_valid
+ *   - x9_inbox_sz
+ *   - x9_write_to_inbox
+ *   - x9_read_from_inbox
+ *   - x9_inbox_depth_approx
+ *   - x9_inbox_depth_hwm
+ *   - x9_inbox_reset_depth_hwm
+ *   - x9_free_inbox
+ *
+ *  Test is considered passed iff:
+ *   - The depth of an idle inbox is exact, and the high-water mark reflects
+ *   both the depths sampled and the inbox having been full.
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - All messages sent by the producer(s) are received and asserted to be
+ *   valid by the consumer(s).
+ *   - The depths polled by the monitor never exceed the inbox size.
+ */
+
+#include <assert.h>    /* assert */
+#include <pthread.h>   /* pthread_t, pthread functions */
+#include <stdatomic.h> /* atomic_* */
+#include <stdbool.h>   /* bool */
+#include <stdint.h>    /* uint64_t */
+#include <stdio.h>     /* printf */
+#include <stdlib.h>    /* rand, RAND_MAX */
+
+#include "../x9.h"
+
+/* Both producer and consumer loops, would commonly be infinite loops, but for
+ * the purpose of testing a reasonable NUMBER_OF_MESSAGES is defined. */
+#define NUMBER_OF_MESSAGES 1000000
+
+#define INBOX_SIZE 8
+
+typedef struct {
+  x9_inbox*      inbox;
+  _Atomic(bool)* done;
+  uint64_t       polls;
+} th_struct;
+
+typedef struct {
+  int a;
+  int b;
+  int sum;
+} msg;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static inline void fill_msg_type(msg* const m) {
+  m->a   = random_int(0, 10);
+  m->b   = random_int(0, 10);
+  m->sum = m->a + m->b;
+}
+
+static void* producer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    fill_msg_type(&m);
+    while (!x9_write_to_inbox(data->inbox, sizeof(msg), &m)) {}
+  }
+  return 0;
+}
+
+static void* consumer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    while (!x9_read_from_inbox(data->inbox, sizeof(msg), &m)) {}
+    assert(m.sum == (m.a + m.b));
+  }
+  atomic_store(data->done, true);
+  return 0;
+}
+
+static void* monitor_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  while (!atomic_load(data->done)) {
+    uint64_t const depth = x9_inbox_depth_approx(data->inbox);
+    assert(depth <= x9_inbox_sz(data->inbox));
+    assert(depth <= x9_inbox_depth_hwm(data->inbox));
+    ++data->polls;
+  }
+  return 0;
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Create inbox */
+  x9_inbox* const inbox = x9_create_inbox(INBOX_SIZE, "ibx", sizeof(msg));
+
+  /* Using assert to simplify code for presentation purpose. */
+  assert(x9_inbox_is_valid(inbox));
+  assert(INBOX_SIZE == x9_inbox_sz(inbox));
+
+  /* Depth of an idle inbox */
+  msg m = {0};
+  for (uint64_t k = 0; k != 3; ++k) {
+    x9_write_to_inbox(inbox, sizeof(msg), &m);
+  }
+  assert(3 == x9_inbox_depth_approx(inbox));
+  x9_read_from_inbox(inbox, sizeof(msg), &m);
+  assert(2 == x9_inbox_depth_approx(inbox));
+  assert(3 == x9_inbox_depth_hwm(inbox));
+
+  /* A writer finding the inbox full sets the high-water mark. */
+  while (x9_write_to_inbox(inbox, sizeof(msg), &m)) {}
+  assert(INBOX_SIZE == x9_inbox_depth_hwm(inbox));
+  while (x9_read_from_inbox(inbox, sizeof(msg), &m)) {}
+  assert(0 == x9_inbox_depth_approx(inbox));
+  assert(INBOX_SIZE == x9_inbox_reset_depth_hwm(inbox));
+  assert(0 == x9_inbox_depth_hwm(inbox));
+
+  _Atomic(bool) done = false;
+
+  /* Producer */
+  pthread_t producer_th     = {0};
+  th_struct producer_struct = {.inbox = inbox, .done = &done};
+
+  /* Consumer */
+  pthread_t consumer_th     = {0};
+  th_struct consumer_struct = {.inbox = inbox, .done = &done};
+
+  /* Monitor */
+  pthread_t monitor_th     = {0};
+  th_struct monitor_struct = {.inbox = inbox, .done = &done};
+
+  /* Launch threads */
+  pthread_create(&producer_th, NULL, producer_fn, &producer_struct);
+  pthread_create(&consumer_th, NULL, consumer_fn, &consumer_struct);
+  pthread_create(&monitor_th, NULL, monitor_fn, &monitor_struct);
+
+  /* Join them */
+  pthread_join(producer_th, NULL);
+  pthread_join(consumer_th, NULL);
+  pthread_join(monitor_th, NULL);
+
+  assert(x9_inbox_depth_hwm(inbox) <= INBOX_SIZE);
+
+  /* Cleanup */
+  x9_free_inbox(inbox);
+
+  printf("TEST PASSED: x9_example_10.c\n");
+  return EXIT_SUCCESS;
+}
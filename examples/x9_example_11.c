@@ -0,0 +1,159 @@
+/* x9_example_11.c
+ *
+ *  One producer.
+ *  One consumer.
+ *  One message type.
+ *
+ *  ┌────────┐       ┏━━━━━━━━┓       ┌────────┐
+ *  │Producer│──────▷┃ inbox  ┃◁ ─ ─ ─│Consumer│
+ *  └────────┘       ┗━━━━━━━━┛       └────────┘
+ *
+ *  This example showcases how to measure how long messages wait in an inbox
+ *  (must be compiled with -D X9_LATENCY).
+ *  Every message is stamped with the TSC when it is published, and readers
+ *  record the time it took to be read in a histogram owned by the inbox.
+ *
+ *  Data structures used:
+ *   - x9_inbox
+ *
+ *  Functions used:
+ *   - x9_create_inbox
+ *   - x9_inbox_is_valid
+ *   - x9_calibrate_tsc
+ *   - x9_write_to_inbox
+ *   - x9_read_from_inbox
+ *   - x9_inbox_latency_count
+ *   - x9_inbox_latency_percentile_ns
+ *   - x9_inbox_latency_percentiles_ns
+ *   - x9_inbox_latency_reset
+ *   - x9_free_inbox
+ *
+ *  Test is considered passed iff:
+ *   - A message left in the inbox for 1ms is reported to have waited at
+ *   least (roughly) that long.
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - All messages sent by the producer(s) are received and asserted to be
+ *   valid by the consumer(s).
+ *   - One latency is recorded per message read, and the percentiles reported
+ *   are ordered.
+ */
+
+#include <assert.h>  /* assert */
+#include <pthread.h> /* pthread_t, pthread functions */
+#include <stdint.h>  /* uint64_t */
+#include <stdio.h>   /* printf */
+#include <stdlib.h>  /* rand, RAND_MAX */
+#include <time.h>    /* nanosleep */
+
+#include "../x9.h"
+
+/* Both producer and consumer loops, would commonly be infinite loops, but for
+ * the purpose of testing a reasonable NUMBER_OF_MESSAGES is defined. */
+#define NUMBER_OF_MESSAGES 1000000
+
+typedef struct {
+  x9_inbox* inbox;
+} th_struct;
+
+typedef struct {
+  int  a;
+  int  b;
+  int  sum;
+  char pad[4];
+} msg;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static inline void fill_msg_type(msg* const m) {
+  m->a   = random_int(0, 10);
+  m->b   = random_int(0, 10);
+  m->sum = m->a + m->b;
+}
+
+static void* producer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    fill_msg_type(&m);
+    while (!x9_write_to_inbox(data->inbox, sizeof(msg), &m)) {}
+  }
+  return 0;
+}
+
+static void* consumer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    while (!x9_read_from_inbox(data->inbox, sizeof(msg), &m)) {}
+    assert(m.sum == (m.a + m.b));
+  }
+  return 0;
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Latencies are converted from TSC cycles to nanoseconds. */
+  x9_calibrate_tsc();
+
+  /* Create inbox */
+  x9_inbox* const inbox = x9_create_inbox(512, "ibx", sizeof(msg));
+
+  /* Using assert to simplify code for presentation purpose. */
+  assert(x9_inbox_is_valid(inbox));
+
+  /* A message that waited 1ms in the inbox. */
+  msg             m   = {0};
+  struct timespec nap = {.tv_nsec = 1000000};
+  assert(x9_write_to_inbox(inbox, sizeof(msg), &m));
+  nanosleep(&nap, NULL);
+  assert(x9_read_from_inbox(inbox, sizeof(msg), &m));
+
+  assert(1 == x9_inbox_latency_count(inbox));
+  /* Histogram buckets are only precise to ~3%. */
+  assert(x9_inbox_latency_percentile_ns(inbox, 100) >= 900000);
+
+  x9_inbox_latency_reset(inbox);
+  assert(0 == x9_inbox_latency_count(inbox));
+  assert(0 == x9_inbox_latency_percentile_ns(inbox, 50));
+
+  /* Producer */
+  pthread_t producer_th     = {0};
+  th_struct producer_struct = {.inbox = inbox};
+
+  /* Consumer */
+  pthread_t consumer_th     = {0};
+  th_struct consumer_struct = {.inbox = inbox};
+
+  /* Launch threads */
+  pthread_create(&producer_th, NULL, producer_fn, &producer_struct);
+  pthread_create(&consumer_th, NULL, consumer_fn, &consumer_struct);
+
+  /* Join them */
+  pthread_join(producer_th, NULL);
+  pthread_join(consumer_th, NULL);
+
+  /* Assert that every message read recorded its latency. */
+  assert(NUMBER_OF_MESSAGES == x9_inbox_latency_count(inbox));
+
+  /* Several percentiles at once, in a single walk of the histogram. */
+  double const percentiles[3] = {50, 99, 100};
+  double       ns[3]          = {0};
+  x9_inbox_latency_percentiles_ns(inbox, 3, percentiles, ns);
+  assert((ns[0] <= ns[1]) && (ns[1] <= ns[2]));
+  assert(ns[2] == x9_inbox_latency_percentile_ns(inbox, 100));
+
+  printf("x9_example_11.c latency (ns): p50 %.0f | p99 %.0f | max %.0f\n",
+         ns[0], ns[1], ns[2]);
+
+  /* Cleanup */
+  x9_free_inbox(inbox);
+
+  printf("TEST PASSED: x9_example_11.c\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+/* x9_example_12.c
+ *
+ *  One producer
+ *  One consumer
+ *  One message type
+ *
+ *                   ┏━━━━━━━━━━━━━━━━━━━━━━━━━━━┓
+ *  ┌────────┐       ┃ ┌───┐   ┌───────┐   ┌───┐ ┃       ┌────────┐
+ *  │Producer│──────▷┃ │seg│ → │  seg  │ → │seg│ ┃◁ ─ ─ ─│Consumer│
+ *  └────────┘       ┃ └───┘   └───────┘   └───┘ ┃       └────────┘
+ *                   ┗━━━━━━━━━━━━━━━━━━━━━━━━━━━┛
+ *
+ *  This example showcases how an elastic inbox grows, by linking larger
+ *  segments, when the consumer falls behind, and how it shrinks back once
+ *  the consumer catches up, while messages are read in the order they were
+ *  written.
+ *
+ *  Data structures used:
+ *   - x9_elastic_inbox
+ *
+ *  Functions used:
+ *   - x9_create_elastic_inbox
+ *   - x9_elastic_inbox_is_valid
+ *   - x9_elastic_inbox_name_is
+ *   - x9_elastic_inbox_sz
+ *   - x9_write_to_elastic_inbox
+ *   - x9_write_to_elastic_inbox_spin
+ *   - x9_read_from_elastic_inbox
+ *   - x9_read_from_elastic_inbox_spin
+ *   - x9_free_elastic_inbox
+ *
+ *  Test is considered passed iff:
+ *   - The inbox grows up to the sum of all of its segment sizes, and rejects
+ *   writes only after that.
+ *   - The inbox shrinks back to its minimum size once it is drained and
+ *   kept mostly empty.
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - All messages sent by the producer(s) are received, in order, and
+ *   asserted to be valid by the consumer(s).
+ */
+
+#include <assert.h>  /* assert */
+#include <pthread.h> /* pthread_t, pthread functions */
+#include <stdint.h>  /* uint64_t */
+#include <stdio.h>   /* printf */
+#include <stdlib.h>  /* rand, RAND_MAX */
+#include <time.h>    /* nanosleep */
+
+#include "../x9.h"
+
+/* Both producer and consumer loops, would commonly be infinite loops, but for
+ * the purpose of testing a reasonable NUMBER_OF_MESSAGES is defined. */
+#define NUMBER_OF_MESSAGES 1000000
+
+#define MIN_INBOX_SIZE 4
+#define MAX_INBOX_SIZE 64
+
+/* Segments of 4, 8, 16, 32 and 64 slots */
+#define MAX_CAPACITY 124
+
+typedef struct {
+  x9_elastic_inbox* inbox;
+} th_struct;
+
+typedef struct {
+  uint64_t seq;
+  int      a;
+  int      b;
+  int      sum;
+  char     pad[4];
+} msg;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static inline void fill_msg_type(msg* const m, uint64_t const seq) {
+  m->seq = seq;
+  m->a   = random_int(0, 10);
+  m->b   = random_int(0, 10);
+  m->sum = m->a + m->b;
+}
+
+static void* producer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    fill_msg_type(&m, k);
+    x9_write_to_elastic_inbox_spin(data->inbox, sizeof(msg), &m);
+  }
+  return 0;
+}
+
+static void* consumer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  /* Falls behind from time to time, so that the inbox grows. */
+  struct timespec const nap = {.tv_nsec = 10000};
+
+  msg m = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    if (!(k % 100000)) { nanosleep(&nap, NULL); }
+    x9_read_from_elastic_inbox_spin(data->inbox, sizeof(msg), &m);
+    assert(m.seq == k);
+    assert(m.sum == (m.a + m.b));
+  }
+  return 0;
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Create inbox */
+  x9_elastic_inbox* const inbox = x9_create_elastic_inbox(
+      MIN_INBOX_SIZE, MAX_INBOX_SIZE, "ibx", sizeof(msg));
+
+  /* Using assert to simplify code for presentation purpose. */
+  assert(x9_elastic_inbox_is_valid(inbox));
+  assert(x9_elastic_inbox_name_is(inbox, "ibx"));
+  assert(MIN_INBOX_SIZE == x9_elastic_inbox_sz(inbox));
+
+  /* Without a reader, the inbox grows until its largest segment is full. */
+  msg m = {0};
+  for (uint64_t k = 0; k != MAX_CAPACITY; ++k) {
+    fill_msg_type(&m, k);
+    assert(x9_write_to_elastic_inbox(inbox, sizeof(msg), &m));
+  }
+  assert(!x9_write_to_elastic_inbox(inbox, sizeof(msg), &m));
+  assert(MAX_CAPACITY == x9_elastic_inbox_sz(inbox));
+
+  /* Drained segments are freed, only the one being written to is left. */
+  for (uint64_t k = 0; k != MAX_CAPACITY; ++k) {
+    assert(x9_read_from_elastic_inbox(inbox, sizeof(msg), &m));
+    assert(m.seq == k);
+  }
+  assert(!x9_read_from_elastic_inbox(inbox, sizeof(msg), &m));
+  assert(MAX_INBOX_SIZE == x9_elastic_inbox_sz(inbox));
+
+  /* Kept mostly empty, it shrinks back a segment per lap. */
+  for (uint64_t k = 0; k != (4 * MAX_INBOX_SIZE); ++k) {
+    fill_msg_type(&m, k);
+    assert(x9_write_to_elastic_inbox(inbox, sizeof(msg), &m));
+    assert(x9_read_from_elastic_inbox(inbox, sizeof(msg), &m));
+    assert(m.seq == k);
+  }
+  assert(MIN_INBOX_SIZE == x9_elastic_inbox_sz(inbox));
+
+  /* Producer */
+  pthread_t producer_th     = {0};
+  th_struct producer_struct = {.inbox = inbox};
+
+  /* Consumer */
+  pthread_t consumer_th     = {0};
+  th_struct consumer_struct = {.inbox = inbox};
+
+  /* Launch threads */
+  pthread_create(&producer_th, NULL, producer_fn, &producer_struct);
+  pthread_create(&consumer_th, NULL, consumer_fn, &consumer_struct);
+
+  /* Join them */
+  pthread_join(producer_th, NULL);
+  pthread_join(consumer_th, NULL);
+
+  /* All messages were read. */
+  assert(!x9_read_from_elastic_inbox(inbox, sizeof(msg), &m));
+
+  /* Cleanup */
+  x9_free_elastic_inbox(inbox);
+
+  printf("TEST PASSED: x9_example_12.c\n");
+  return EXIT_SUCCESS;
+}
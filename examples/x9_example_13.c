@@ -0,0 +1,168 @@
+/* x9_example_13.c
+ *
+ *  One producer
+ *  One consumer
+ *  One message type
+ *
+ *  ┌────────┐       ┏━━━━━━━━┓       ┌────────┐
+ *  │Producer│──────▷┃ inbox  ┃◁ ─ ─ ─│Consumer│
+ *  └────────┘       ┗━━━━━━━━┛       └────────┘
+ *
+ *  This example showcases how a producer that must never wait (e.g. one
+ *  emitting telemetry from a latency sensitive thread) can write to a lossy
+ *  inbox, which overwrites the oldest unread message when the consumer falls
+ *  behind, and how the consumer finds out how many messages it missed.
+ *
+ *  Data structures used:
+ *   - x9_lossy_inbox
+ *
+ *  Functions used:
+ *   - x9_create_lossy_inbox
+ *   - x9_lossy_inbox_is_valid
+ *   - x9_lossy_inbox_name_is
+ *   - x9_write_to_lossy_inbox
+ *   - x9_read_from_lossy_inbox
+ *   - x9_read_from_lossy_inbox_spin
+ *   - x9_lossy_inbox_dropped
+ *   - x9_free_lossy_inbox
+ *
+ *  Test is considered passed iff:
+ *   - Writing more messages than the inbox size without reading them keeps
+ *   only the newest ones, and the reader is told how many were dropped.
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - Every message read is valid and newer than the previous one, and the
+ *   messages read plus the ones dropped add up to the ones written.
+ */
+
+#include <assert.h>  /* assert */
+#include <pthread.h> /* pthread_t, pthread functions */
+#include <stdint.h>  /* uint64_t */
+#include <stdio.h>   /* printf */
+#include <stdlib.h>  /* rand, RAND_MAX */
+#include <time.h>    /* time */
+
+#include "../x9.h"
+
+/* Both producer and consumer loops, would commonly be infinite loops, but for
+ * the purpose of testing a reasonable NUMBER_OF_MESSAGES is defined. */
+#define NUMBER_OF_MESSAGES 1000000
+
+#define INBOX_SIZE 8
+
+typedef struct {
+  x9_lossy_inbox* inbox;
+  uint64_t        msgs_read;
+  uint64_t        msgs_dropped;
+} th_struct;
+
+typedef struct {
+  uint64_t seq;
+  int      a;
+  int      b;
+  int      sum;
+  char     pad[4];
+} msg;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static inline void fill_msg_type(msg* const m, uint64_t const seq) {
+  m->seq = seq;
+  m->a   = random_int(0, 10);
+  m->b   = random_int(0, 10);
+  m->sum = m->a + m->b;
+}
+
+static void* producer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    fill_msg_type(&m, k);
+    x9_write_to_lossy_inbox(data->inbox, sizeof(msg), &m);
+  }
+  return 0;
+}
+
+static void* consumer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg      m        = {0};
+  uint64_t dropped  = 0;
+  uint64_t next_seq = 0;
+  for (;;) {
+    x9_read_from_lossy_inbox_spin(data->inbox, sizeof(msg), &m, &dropped);
+    /* Messages are read in order, skipping exactly the ones dropped. */
+    assert(m.seq == (next_seq + dropped));
+    assert(m.sum == (m.a + m.b));
+    ++data->msgs_read;
+    data->msgs_dropped += dropped;
+    next_seq = m.seq + 1;
+    /* The last message can't be overwritten, hence is always read. */
+    if ((NUMBER_OF_MESSAGES - 1) == m.seq) { break; }
+  }
+  return 0;
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Create inbox */
+  x9_lossy_inbox* const inbox =
+      x9_create_lossy_inbox(INBOX_SIZE, "ibx", sizeof(msg));
+
+  /* Using assert to simplify code for presentation purpose. */
+  assert(x9_lossy_inbox_is_valid(inbox));
+  assert(x9_lossy_inbox_name_is(inbox, "ibx"));
+
+  /* Without a reader, only the newest INBOX_SIZE messages are kept. */
+  msg      m       = {0};
+  uint64_t dropped = 0;
+  for (uint64_t k = 0; k != (3 * INBOX_SIZE); ++k) {
+    fill_msg_type(&m, k);
+    x9_write_to_lossy_inbox(inbox, sizeof(msg), &m);
+  }
+  assert(x9_read_from_lossy_inbox(inbox, sizeof(msg), &m, &dropped));
+  assert((2 * INBOX_SIZE) == dropped);
+  assert((2 * INBOX_SIZE) == m.seq);
+  for (uint64_t k = (2 * INBOX_SIZE) + 1; k != (3 * INBOX_SIZE); ++k) {
+    assert(x9_read_from_lossy_inbox(inbox, sizeof(msg), &m, &dropped));
+    assert(0 == dropped);
+    assert(k == m.seq);
+  }
+  assert(!x9_read_from_lossy_inbox(inbox, sizeof(msg), &m, &dropped));
+  assert((2 * INBOX_SIZE) == x9_lossy_inbox_dropped(inbox));
+
+  /* Producer */
+  pthread_t producer_th     = {0};
+  th_struct producer_struct = {.inbox = inbox};
+
+  /* Consumer */
+  pthread_t consumer_th     = {0};
+  th_struct consumer_struct = {.inbox = inbox};
+
+  /* Launch threads */
+  pthread_create(&producer_th, NULL, producer_fn, &producer_struct);
+  pthread_create(&consumer_th, NULL, consumer_fn, &consumer_struct);
+
+  /* Join them */
+  pthread_join(producer_th, NULL);
+  pthread_join(consumer_th, NULL);
+
+  /* Every message was either read or dropped. */
+  assert(NUMBER_OF_MESSAGES ==
+         (consumer_struct.msgs_read + consumer_struct.msgs_dropped));
+  assert(((2 * INBOX_SIZE) + consumer_struct.msgs_dropped) ==
+         x9_lossy_inbox_dropped(inbox));
+
+  printf("x9_example_13.c: %lu messages read, %lu dropped\n",
+         consumer_struct.msgs_read, consumer_struct.msgs_dropped);
+
+  /* Cleanup */
+  x9_free_lossy_inbox(inbox);
+
+  printf("TEST PASSED: x9_example_13.c\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+/* x9_example_14.c
+ *
+ *  One submitter
+ *  Four workers
+ *  One task type
+ *
+ *                   ┏━━━━━━━━┓       ┌────────┐
+ *               ┌──▷┃inbox 1 ┃◁ ─ ─ ─│Worker 1│─ ┐
+ *               │   ┗━━━━━━━━┛       └────────┘
+ *  ┌─────────┐  │   ┏━━━━━━━━┓       ┌────────┐  │
+ *  │Submitter│──┼──▷┃inbox 2 ┃◁ ─ ─ ─│Worker 2│   steal from siblings
+ *  └─────────┘  │   ┗━━━━━━━━┛       └────────┘  │  when idle
+ *               │       ...              ...
+ *               │   ┏━━━━━━━━┓       ┌────────┐  │
+ *               └──▷┃inbox 4 ┃◁ ─ ─ ─│Worker 4│─ ┘
+ *                   ┗━━━━━━━━┛       └────────┘
+ *
+ *  This example showcases how to run tasks (a function plus its args) in a
+ *  pool of workers, each with its own inbox, without spawning threads or
+ *  wiring inboxes by hand, and how idle workers steal the tasks queued
+ *  behind a worker that is stuck on a long task.
+ *
+ *  Data structures used:
+ *   - x9_executor
+ *
+ *  Functions used:
+ *   - x9_create_executor
+ *   - x9_executor_is_valid
+ *   - x9_executor_name_is
+ *   - x9_executor_submit_to
+ *   - x9_executor_submit_spin
+ *   - x9_executor_tasks_run
+ *   - x9_executor_tasks_stolen
+ *   - x9_free_executor
+ *
+ *  Test is considered passed iff:
+ *   - Tasks submitted to workers that are busy are stolen and run by the one
+ *   that is idle.
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - All tasks submitted are run exactly once, and their args are asserted
+ *   to be valid.
+ */
+
+#include <assert.h>    /* assert */
+#include <stdatomic.h> /* atomic_* */
+#include <stdbool.h>   /* bool */
+#include <stdint.h>    /* uint64_t */
+#include <stdio.h>     /* printf */
+#include <stdlib.h>    /* rand, RAND_MAX */
+#include <time.h>      /* time */
+#include <x86intrin.h> /* _mm_pause */
+
+#include "../x9.h"
+
+/* The submitter loop would commonly be an infinite loop, but for the
+ * purpose of testing a reasonable NUMBER_OF_TASKS is defined. */
+#define NUMBER_OF_TASKS 1000000
+
+#define NUMBER_OF_WORKERS 4
+#define INBOX_SIZE        4
+
+typedef struct {
+  uint64_t seq;
+  int      a;
+  int      b;
+  int      sum;
+  char     pad[4];
+} task_args;
+
+typedef struct {
+  _Atomic(uint64_t)* started;
+  _Atomic(bool)*     release;
+} blocker_args;
+
+/* Sum of the 'seq' of every task run */
+static _Atomic(uint64_t) checksum = 0;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static inline void fill_task_args(task_args* const t, uint64_t const seq) {
+  t->seq = seq;
+  t->a   = random_int(0, 10);
+  t->b   = random_int(0, 10);
+  t->sum = t->a + t->b;
+}
+
+static void sum_task(void* const args) {
+  task_args const* const t = (task_args*)args;
+  assert(t->sum == (t->a + t->b));
+  atomic_fetch_add_explicit(&checksum, t->seq, __ATOMIC_RELAXED);
+}
+
+/* Keeps the worker running it busy until released. */
+static void blocker_task(void* const args) {
+  blocker_args const* const t = (blocker_args*)args;
+  atomic_fetch_add_explicit(t->started, 1, __ATOMIC_RELEASE);
+  while (!atomic_load_explicit(t->release, __ATOMIC_ACQUIRE)) { _mm_pause(); }
+}
+
+static uint64_t total(x9_executor const* const executor,
+                      uint64_t (*counter)(x9_executor const* const,
+                                          uint64_t const)) {
+  uint64_t n = 0;
+  for (uint64_t k = 0; k != NUMBER_OF_WORKERS; ++k) {
+    n += counter(executor, k);
+  }
+  return n;
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Create executor, its workers are not pinned ('cores' is NULL). */
+  x9_executor* const executor =
+      x9_create_executor(NUMBER_OF_WORKERS, NULL, INBOX_SIZE, "exec");
+
+  /* Using assert to simplify code for presentation purpose. */
+  assert(x9_executor_is_valid(executor));
+  assert(x9_executor_name_is(executor, "exec"));
+
+  /* Keep all workers but one busy, as each of them can only run one blocker
+   * at a time. */
+  _Atomic(uint64_t) started = 0;
+  _Atomic(bool)     release = false;
+  blocker_args      b       = {.started = &started, .release = &release};
+  for (uint64_t k = 0; k != (NUMBER_OF_WORKERS - 1); ++k) {
+    assert(x9_executor_submit_to(executor, k, blocker_task, sizeof(b), &b));
+  }
+  while ((NUMBER_OF_WORKERS - 1) !=
+         atomic_load_explicit(&started, __ATOMIC_ACQUIRE)) {
+    _mm_pause();
+  }
+
+  /* Fill every inbox, the ones of the busy workers can only be drained by
+   * the idle worker stealing from them. */
+  task_args t   = {0};
+  uint64_t  seq = 0;
+  for (uint64_t k = 0; k != NUMBER_OF_WORKERS; ++k) {
+    for (uint64_t j = 0; j != INBOX_SIZE; ++j, ++seq) {
+      fill_task_args(&t, seq);
+      while (!x9_executor_submit_to(executor, k, sum_task, sizeof(t), &t)) {
+        _mm_pause();
+      }
+    }
+  }
+  while (seq != total(executor, x9_executor_tasks_run)) { _mm_pause(); }
+  assert(total(executor, x9_executor_tasks_stolen) >=
+         ((NUMBER_OF_WORKERS - 1) * INBOX_SIZE));
+
+  atomic_store_explicit(&release, true, __ATOMIC_RELEASE);
+
+  /* Spread the rest in round-robin order */
+  for (uint64_t k = 0; k != NUMBER_OF_TASKS; ++k, ++seq) {
+    fill_task_args(&t, seq);
+    x9_executor_submit_spin(executor, sum_task, sizeof(t), &t);
+  }
+
+  /* Every task is run exactly once */
+  uint64_t const n_tasks = seq + (NUMBER_OF_WORKERS - 1);
+  while (n_tasks != total(executor, x9_executor_tasks_run)) { _mm_pause(); }
+  assert(((seq * (seq - 1)) / 2) ==
+         atomic_load_explicit(&checksum, __ATOMIC_RELAXED));
+
+  printf("x9_example_14.c: %lu tasks run, %lu stolen\n", n_tasks,
+         total(executor, x9_executor_tasks_stolen));
+
+  /* Cleanup */
+  x9_free_executor(executor);
+
+  printf("TEST PASSED: x9_example_14.c\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,228 @@
+/* x9_example_15.c
+ *
+ *  One producer
+ *  Five stages in two threads
+ *  One message type
+ *
+ *  ┌────────┐   ┏━━━━━┓   ┌──────────┐   ┏━━━━━━━━━━┓   ┌────────┐
+ *  │Producer│──▷┃ raw ┃◁ ─│Normalizer│──▷┃normalized┃◁ ─│Strategy│───┐
+ *  └────────┘   ┗━━━━━┛   └──────────┘   ┗━━━━━━━━━━┛   └────────┘   │
+ *                          (thread 0)                    (thread 0)  │
+ *           ┌────────────────────────────────────────────────────────┤
+ *           │   ┏━━━━━━┓   ┌────┐   ┏━━━━━━━━┓   ┌───────┐           │
+ *           └──▷┃orders┃◁ ─│Risk│──▷┃approved┃◁ ─│Gateway│           │
+ *               ┗━━━━━━┛   └────┘   ┗━━━━━━━━┛   └───────┘           │
+ *                        (thread 1)             (thread 1)           │
+ *               ┏━━━━━━┓   ┌─────┐                                   │
+ *               ┃audit ┃◁ ─│Audit│                                   │
+ *               ┗━━━━━━┛   └─────┘                                   │
+ *                  △      (thread 1)                                 │
+ *                  └─────────────────────────────────────────────────┘
+ *
+ *  This example showcases how to declare a graph of stages (a handler with
+ *  an input inbox and zero or more output inboxes), placing several of them
+ *  in the same thread, and how to query the throughput, queue depth and hop
+ *  latency of each of them (must be compiled with -D X9_LATENCY for the
+ *  latter).
+ *
+ *  Data structures used:
+ *   - x9_inbox
+ *   - x9_graph
+ *
+ *  Functions used:
+ *   - x9_calibrate_tsc
+ *   - x9_create_inbox
+ *   - x9_inbox_is_valid
+ *   - x9_write_to_inbox
+ *   - x9_create_graph
+ *   - x9_graph_is_valid
+ *   - x9_graph_name_is
+ *   - x9_graph_add_stage
+ *   - x9_graph_start
+ *   - x9_graph_stop
+ *   - x9_graph_stage_stats
+ *   - x9_free_graph
+ *   - x9_free_inbox
+ *
+ *  Test is considered passed iff:
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - All messages sent by the producer are handled by every stage, in
+ *   order, and asserted to be valid by the last ones.
+ *   - The stats of every stage account for all the messages.
+ */
+
+#include <assert.h>    /* assert */
+#include <stdatomic.h> /* atomic_* */
+#include <stdint.h>    /* uint64_t */
+#include <stdio.h>     /* printf */
+#include <stdlib.h>    /* rand, RAND_MAX */
+#include <time.h>      /* time */
+#include <x86intrin.h> /* _mm_pause */
+
+#include "../x9.h"
+
+/* The producer loop would commonly be an infinite loop, but for the purpose
+ * of testing a reasonable NUMBER_OF_MESSAGES is defined. */
+#define NUMBER_OF_MESSAGES 1000000
+
+#define NUMBER_OF_THREADS 2
+#define BATCH             8
+
+typedef struct {
+  uint64_t seq;
+  int      a;
+  int      b;
+  int      sum;
+  char     pad[4];
+} msg;
+
+/* Context of the last stages, only read by the main thread once they are
+ * done. */
+typedef struct {
+  _Atomic(uint64_t) msgs;
+} sink_ctx;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static void normalizer_fn(void* const            m,
+                          x9_inbox* const* const outputs,
+                          void* const            ctx) {
+  (void)ctx;
+  msg* const n = (msg*)m;
+  n->sum       = n->a + n->b;
+  /* Always succeeds, the graph only calls a stage when its outputs have a
+   * free slot. */
+  x9_write_to_inbox(outputs[0], sizeof(msg), n);
+}
+
+static void strategy_fn(void* const            m,
+                        x9_inbox* const* const outputs,
+                        void* const            ctx) {
+  (void)ctx;
+  x9_write_to_inbox(outputs[0], sizeof(msg), m);
+  x9_write_to_inbox(outputs[1], sizeof(msg), m);
+}
+
+static void risk_fn(void* const            m,
+                    x9_inbox* const* const outputs,
+                    void* const            ctx) {
+  (void)ctx;
+  msg const* const r = (msg*)m;
+  assert(r->sum == (r->a + r->b));
+  x9_write_to_inbox(outputs[0], sizeof(msg), r);
+}
+
+static void sink_fn(void* const            m,
+                    x9_inbox* const* const outputs,
+                    void* const            ctx) {
+  (void)outputs;
+  msg const* const s    = (msg*)m;
+  sink_ctx* const  sink = (sink_ctx*)ctx;
+  uint64_t const   n    = atomic_load_explicit(&sink->msgs, __ATOMIC_RELAXED);
+  assert(s->seq == n);
+  assert(s->sum == (s->a + s->b));
+  atomic_store_explicit(&sink->msgs, n + 1, __ATOMIC_RELEASE);
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Hop latencies are converted from TSC cycles to nanoseconds. */
+  x9_calibrate_tsc();
+
+  /* Create inboxes */
+  x9_inbox* const raw        = x9_create_inbox(4, "raw", sizeof(msg));
+  x9_inbox* const normalized = x9_create_inbox(4, "normalized", sizeof(msg));
+  x9_inbox* const orders     = x9_create_inbox(4, "orders", sizeof(msg));
+  x9_inbox* const audit      = x9_create_inbox(4, "audit", sizeof(msg));
+  x9_inbox* const approved   = x9_create_inbox(4, "approved", sizeof(msg));
+
+  /* Using assert to simplify code for presentation purpose. */
+  assert(x9_inbox_is_valid(raw));
+  assert(x9_inbox_is_valid(normalized));
+  assert(x9_inbox_is_valid(orders));
+  assert(x9_inbox_is_valid(audit));
+  assert(x9_inbox_is_valid(approved));
+
+  /* Create graph, its threads are not pinned ('cores' is NULL). */
+  x9_graph* const graph =
+      x9_create_graph("graph", NUMBER_OF_THREADS, NULL, BATCH);
+  assert(x9_graph_is_valid(graph));
+  assert(x9_graph_name_is(graph, "graph"));
+
+  sink_ctx gateway_ctx = {0};
+  sink_ctx audit_ctx   = {0};
+
+  /* Declare stages */
+  assert(x9_graph_add_stage(graph, "normalizer", 0, raw, normalizer_fn, NULL,
+                            1, normalized));
+  assert(x9_graph_add_stage(graph, "strategy", 0, normalized, strategy_fn,
+                            NULL, 2, orders, audit));
+  assert(x9_graph_add_stage(graph, "risk", 1, orders, risk_fn, NULL, 1,
+                            approved));
+  assert(x9_graph_add_stage(graph, "gateway", 1, approved, sink_fn,
+                            &gateway_ctx, 0));
+  assert(x9_graph_add_stage(graph, "audit", 1, audit, sink_fn, &audit_ctx,
+                            0));
+
+  /* There's no thread 2 */
+  assert(!x9_graph_add_stage(graph, "none", 2, audit, sink_fn, NULL, 0));
+
+  assert(x9_graph_start(graph));
+
+  /* Producer */
+  msg m = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    m.seq = k;
+    m.a   = random_int(0, 10);
+    m.b   = random_int(0, 10);
+    while (!x9_write_to_inbox(raw, sizeof(msg), &m)) { _mm_pause(); }
+  }
+
+  /* Wait for the last stages */
+  while (
+      (NUMBER_OF_MESSAGES !=
+       atomic_load_explicit(&gateway_ctx.msgs, __ATOMIC_ACQUIRE)) ||
+      (NUMBER_OF_MESSAGES !=
+       atomic_load_explicit(&audit_ctx.msgs, __ATOMIC_ACQUIRE))) {
+    _mm_pause();
+  }
+  x9_graph_stop(graph);
+
+  /* Every stage handled every message */
+  char const* const stages[] = {"normalizer", "strategy", "risk", "gateway",
+                                "audit"};
+  for (uint64_t k = 0; k != (sizeof(stages) / sizeof(stages[0])); ++k) {
+    x9_stage_stats stats = {0};
+    assert(x9_graph_stage_stats(graph, stages[k], &stats));
+    assert(NUMBER_OF_MESSAGES == stats.msgs);
+    assert(0 == stats.depth);
+    assert(stats.depth_hwm <= 4);
+  }
+  x9_stage_stats stats = {0};
+  assert(!x9_graph_stage_stats(graph, "none", &stats));
+
+  /* Formatting is left to the caller */
+  printf("%-16s | %12s | %12s | %6s | %6s | %12s | %12s\n", "Stage", "Msgs",
+         "Msgs/second", "Depth", "HWM", "Hop p50 (ns)", "Hop p99 (ns)");
+  for (uint64_t k = 0; k != (sizeof(stages) / sizeof(stages[0])); ++k) {
+    assert(x9_graph_stage_stats(graph, stages[k], &stats));
+    printf("%-16s | %12lu | %12.2f | %6lu | %6lu | %12.0f | %12.0f\n",
+           stages[k], stats.msgs, stats.msgs_per_sec, stats.depth,
+           stats.depth_hwm, stats.hop_p50_ns, stats.hop_p99_ns);
+  }
+
+  /* Cleanup */
+  x9_free_graph(graph);
+  x9_free_inbox(raw);
+  x9_free_inbox(normalized);
+  x9_free_inbox(orders);
+  x9_free_inbox(audit);
+  x9_free_inbox(approved);
+
+  printf("TEST PASSED: x9_example_15.c\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,271 @@
+/* x9_example_16.c
+ *
+ *  Two producers
+ *  One consumer
+ *  Two message types
+ *
+ *  ┌────────┐       ┏━━━━━━━━┓
+ *  │Producer│──────▷┃inbox 1 ┃◁ ─ ─ ┐
+ *  └────────┘       ┗━━━━━━━━┛
+ *                                   │  ┌────────┐
+ *                                    ─ │Consumer│
+ *                                   │  └────────┘
+ *  ┌────────┐       ┏━━━━━━━━┓
+ *  │Producer│──────▷┃inbox 2 ┃◁ ─ ─ ┘
+ *  └────────┘       ┗━━━━━━━━┛
+ *
+ *  This example showcases how a consumer can register a handler per inbox
+ *  of its node and let 'x9_node_run' drain them, calling each handler on
+ *  the messages in place, instead of reading from each inbox and
+ *  dispatching on its name.
+ *
+ *  Data structures used:
+ *   - x9_inbox
+ *   - x9_node
+ *
+ *  Functions used:
+ *   - x9_create_inbox
+ *   - x9_inbox_is_valid
+ *   - x9_create_node
+ *   - x9_node_is_valid
+ *   - x9_select_inbox_from_node
+ *   - x9_node_register_handler
+ *   - x9_node_run
+ *   - x9_write_to_inbox
+ *   - x9_read_from_inbox
+ *   - x9_free_node_and_attached_inboxes
+ *
+ *  Test is considered passed iff:
+ *   - Inboxes without a handler are not read.
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - All messages sent by the producer(s) are received, in order, by the
+ *   handler of their inbox and asserted to be valid.
+ *   - A full inbox does not starve the other one.
+ */
+
+#include <assert.h>  /* assert */
+#include <math.h>    /* fabs */
+#include <pthread.h> /* pthread_t, pthread functions */
+#include <stdint.h>  /* uint64_t */
+#include <stdio.h>   /* printf */
+#include <stdlib.h>  /* rand, RAND_MAX */
+#include <time.h>    /* time */
+
+#include "../x9.h"
+
+/* Both producer and consumer loops, would commonly be infinite loops, but for
+ * the purpose of testing a reasonable NUMBER_OF_MESSAGES is defined. */
+#define NUMBER_OF_MESSAGES 1000000
+
+/* Maximum number of messages handled per 'x9_node_run' call */
+#define BUDGET 16
+
+typedef struct {
+  x9_node* node;
+} th_struct;
+
+typedef struct {
+  uint64_t seq;
+  int      a;
+  int      b;
+  int      sum;
+  char     pad[4];
+} msg_type_1;
+
+typedef struct {
+  uint64_t seq;
+  double   x;
+  double   y;
+  double   product;
+} msg_type_2;
+
+/* Messages handled by each handler, only used by the consumer */
+typedef struct {
+  uint64_t msgs;
+} handler_ctx;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static inline double random_double(int const min, int const max) {
+  return ((double)(random_int(min, max) * 1.0));
+}
+
+static inline void fill_msg_type_1(msg_type_1* const msg, uint64_t const seq) {
+  msg->seq = seq;
+  msg->a   = random_int(0, 10);
+  msg->b   = random_int(0, 10);
+  msg->sum = msg->a + msg->b;
+}
+
+static inline void fill_msg_type_2(msg_type_2* const msg, uint64_t const seq) {
+  msg->seq     = seq;
+  msg->x       = random_double(0, 10);
+  msg->y       = random_double(0, 10);
+  msg->product = msg->x * msg->y;
+}
+
+static void handle_msg_type_1(void const* const msg, void* const ctx) {
+  msg_type_1 const* const m = (msg_type_1 const*)msg;
+  handler_ctx* const      h = (handler_ctx*)ctx;
+  assert(m->seq == h->msgs);
+  assert(m->sum == (m->a + m->b));
+  ++h->msgs;
+}
+
+static void handle_msg_type_2(void const* const msg, void* const ctx) {
+  msg_type_2 const* const m = (msg_type_2 const*)msg;
+  handler_ctx* const      h = (handler_ctx*)ctx;
+  assert(m->seq == h->msgs);
+  assert(fabs(m->product - (m->x * m->y)) < 0.1);
+  ++h->msgs;
+}
+
+static void* producer_1_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  x9_inbox* const inbox = x9_select_inbox_from_node(data->node, "ibx_1");
+  assert(inbox);
+
+  msg_type_1 m = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    fill_msg_type_1(&m, k);
+    while (!x9_write_to_inbox(inbox, sizeof(msg_type_1), &m)) {}
+  }
+  return 0;
+}
+
+static void* producer_2_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  x9_inbox* const inbox = x9_select_inbox_from_node(data->node, "ibx_2");
+  assert(inbox);
+
+  msg_type_2 m = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    fill_msg_type_2(&m, k);
+    while (!x9_write_to_inbox(inbox, sizeof(msg_type_2), &m)) {}
+  }
+  return 0;
+}
+
+static void* consumer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  x9_inbox* const inbox_1 = x9_select_inbox_from_node(data->node, "ibx_1");
+  assert(inbox_1);
+
+  x9_inbox* const inbox_2 = x9_select_inbox_from_node(data->node, "ibx_2");
+  assert(inbox_2);
+
+  handler_ctx ctx_1 = {0};
+  handler_ctx ctx_2 = {0};
+
+  /* Registering again replaces the handler (and its ctx). */
+  assert(x9_node_register_handler(data->node, inbox_1, handle_msg_type_2,
+                                  &ctx_2));
+  assert(x9_node_register_handler(data->node, inbox_1, handle_msg_type_1,
+                                  &ctx_1));
+  assert(x9_node_register_handler(data->node, inbox_2, handle_msg_type_2,
+                                  &ctx_2));
+
+  for (;;) {
+    assert(x9_node_run(data->node, BUDGET) <= BUDGET);
+    if ((NUMBER_OF_MESSAGES == ctx_1.msgs) &&
+        (NUMBER_OF_MESSAGES == ctx_2.msgs)) {
+      break;
+    }
+  }
+
+  /* Every call starts with the next handler, hence a full 'inbox_1' can not
+   * starve 'inbox_2', even with a budget of one message per call. */
+  msg_type_1 m_1 = {0};
+  msg_type_2 m_2 = {0};
+  for (uint64_t k = 0; k != 4; ++k) {
+    fill_msg_type_1(&m_1, NUMBER_OF_MESSAGES + k);
+    assert(x9_write_to_inbox(inbox_1, sizeof(msg_type_1), &m_1));
+  }
+  fill_msg_type_2(&m_2, NUMBER_OF_MESSAGES);
+  assert(x9_write_to_inbox(inbox_2, sizeof(msg_type_2), &m_2));
+
+  assert(1 == x9_node_run(data->node, 1));
+  assert(1 == x9_node_run(data->node, 1));
+  assert((NUMBER_OF_MESSAGES + 1) == ctx_2.msgs);
+  assert(3 == x9_node_run(data->node, BUDGET));
+  assert((NUMBER_OF_MESSAGES + 4) == ctx_1.msgs);
+  return 0;
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Create inboxes */
+  x9_inbox* const inbox_msg_type_1 =
+      x9_create_inbox(4, "ibx_1", sizeof(msg_type_1));
+
+  x9_inbox* const inbox_msg_type_2 =
+      x9_create_inbox(4, "ibx_2", sizeof(msg_type_2));
+
+  /* Read without a handler */
+  x9_inbox* const inbox_msg_type_3 =
+      x9_create_inbox(4, "ibx_3", sizeof(msg_type_1));
+
+  /* Using asserts to simplify code for presentation purpose. */
+  assert(x9_inbox_is_valid(inbox_msg_type_1));
+  assert(x9_inbox_is_valid(inbox_msg_type_2));
+  assert(x9_inbox_is_valid(inbox_msg_type_3));
+
+  /* Create node */
+  x9_node* const node = x9_create_node("my_node", 3, inbox_msg_type_1,
+                                       inbox_msg_type_2, inbox_msg_type_3);
+
+  /* Asserts - Same reason as above.*/
+  assert(x9_node_is_valid(node));
+
+  /* Only inboxes of the node can have a handler. */
+  x9_inbox* const other = x9_create_inbox(4, "other", sizeof(msg_type_1));
+  assert(x9_inbox_is_valid(other));
+  assert(!x9_node_register_handler(node, other, handle_msg_type_1, NULL));
+  x9_free_inbox(other);
+
+  /* Nothing to handle yet */
+  msg_type_1 m = {0};
+  fill_msg_type_1(&m, 0);
+  assert(x9_write_to_inbox(inbox_msg_type_3, sizeof(msg_type_1), &m));
+  assert(0 == x9_node_run(node, BUDGET));
+
+  /* Producer 1 */
+  pthread_t producer_1_th     = {0};
+  th_struct producer_1_struct = {.node = node};
+
+  /* Producer 2 */
+  pthread_t producer_2_th     = {0};
+  th_struct producer_2_struct = {.node = node};
+
+  /* Consumer */
+  pthread_t consumer_th     = {0};
+  th_struct consumer_struct = {.node = node};
+
+  /* Launch threads */
+  pthread_create(&producer_1_th, NULL, producer_1_fn, &producer_1_struct);
+  pthread_create(&producer_2_th, NULL, producer_2_fn, &producer_2_struct);
+  pthread_create(&consumer_th, NULL, consumer_fn, &consumer_struct);
+
+  /* Join them */
+  pthread_join(producer_1_th, NULL);
+  pthread_join(producer_2_th, NULL);
+  pthread_join(consumer_th, NULL);
+
+  /* The inbox without a handler was left untouched. */
+  msg_type_1 r = {0};
+  assert(x9_read_from_inbox(inbox_msg_type_3, sizeof(msg_type_1), &r));
+  assert(r.sum == m.sum);
+
+  /* Cleanup */
+  x9_free_node_and_attached_inboxes(node);
+
+  printf("TEST PASSED: x9_example_16.c\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+/* x9_example_17.cpp
+ *
+ *  One producer
+ *  Many consumers (coroutines) and producers sharing one thread
+ *  One consumer
+ *  Two message types
+ *
+ *                   ┏━━━━━━━━┓       ┌───────────┐       ┏━━━━━━━━┓
+ *  ┌────────┐       ┃        ┃       │ Scheduler │       ┃        ┃
+ *  │Producer│──────▷┃inbox 1 ┃◁ ─ ─ ─│(coroutine)│──────▷┃inbox 2 ┃
+ *  └────────┘       ┃        ┃       │    ...    │       ┃        ┃
+ *                   ┗━━━━━━━━┛       │(coroutine)│       ┗━━━━━━━━┛
+ *                                    └───────────┘            △
+ *                                                             │
+ *                                                        ┌────────┐
+ *                                                        │Consumer│
+ *                                                        └────────┘
+ *
+ *  This example showcases how many coroutines, run by a x9::scheduler in a
+ *  single thread, can 'co_await' reading from and writing to inboxes,
+ *  being suspended (instead of spinning) until they can, and resumed by the
+ *  scheduler.
+ *  Must be compiled with '-std=c++20', and linked with x9.c compiled as C.
+ *
+ *  Data structures used:
+ *   - x9_inbox
+ *   - x9::scheduler
+ *   - x9::task
+ *   - x9::async_inbox
+ *
+ *  Functions used:
+ *   - x9_create_inbox
+ *   - x9_inbox_is_valid
+ *   - x9_write_to_inbox
+ *   - x9_read_from_inbox
+ *   - x9::scheduler::attach
+ *   - x9::scheduler::spawn
+ *   - x9::scheduler::run
+ *   - x9::async_inbox::read
+ *   - x9::async_inbox::write
+ *   - x9_free_inbox
+ *
+ *  Test is considered passed iff:
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - Every coroutine runs to completion.
+ *   - All messages sent by the producer(s) are received and asserted to be
+ *   valid by the consumer(s).
+ */
+
+#include <cassert>     /* assert */
+#include <cstdint>     /* uint64_t */
+#include <cstdio>      /* printf */
+#include <cstdlib>     /* rand, RAND_MAX */
+#include <ctime>       /* time */
+#include <thread>      /* std::thread */
+#include <x86intrin.h> /* _mm_pause */
+
+#include "../x9.hpp"
+
+/* Both producer and consumer loops, would commonly be infinite loops, but for
+ * the purpose of testing a reasonable NUMBER_OF_MESSAGES is defined. */
+#define NUMBER_OF_MESSAGES 1000000
+
+#define NUMBER_OF_COROUTINES 1000
+
+typedef struct {
+  int a;
+  int b;
+  int sum;
+} msg_type_1;
+
+typedef struct {
+  uint64_t coroutine;
+  int      sum;
+  int      pad;
+} msg_type_2;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static void producer_fn(x9_inbox* const inbox) {
+  msg_type_1 m = {};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    m.a   = random_int(0, 10);
+    m.b   = random_int(0, 10);
+    m.sum = m.a + m.b;
+    while (!x9_write_to_inbox(inbox, sizeof(msg_type_1), &m)) { _mm_pause(); }
+  }
+}
+
+static void consumer_fn(x9_inbox* const inbox, uint64_t* const msgs_read) {
+  msg_type_2 m = {};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    while (!x9_read_from_inbox(inbox, sizeof(msg_type_2), &m)) { _mm_pause(); }
+    assert(m.coroutine < NUMBER_OF_COROUTINES);
+    assert((m.sum >= 0) && (m.sum <= 20));
+    ++*msgs_read;
+  }
+}
+
+/* Each coroutine handles its share of the messages. */
+static x9::task coroutine_fn(x9::async_inbox const in,
+                             x9::async_inbox const out,
+                             uint64_t const        id,
+                             uint64_t* const       done) {
+  for (uint64_t k = 0; k != (NUMBER_OF_MESSAGES / NUMBER_OF_COROUTINES); ++k) {
+    msg_type_1 const m = co_await in.read<msg_type_1>();
+    assert(m.sum == (m.a + m.b));
+    co_await out.write(msg_type_2{.coroutine = id, .sum = m.sum, .pad = 0});
+  }
+  ++*done;
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Create inboxes */
+  x9_inbox* const inbox_msg_type_1 =
+      x9_create_inbox(4, "ibx_1", sizeof(msg_type_1));
+
+  x9_inbox* const inbox_msg_type_2 =
+      x9_create_inbox(4, "ibx_2", sizeof(msg_type_2));
+
+  /* Using asserts to simplify code for presentation purpose. */
+  assert(x9_inbox_is_valid(inbox_msg_type_1));
+  assert(x9_inbox_is_valid(inbox_msg_type_2));
+
+  /* Coroutines, run by the main thread */
+  x9::scheduler         sched;
+  x9::async_inbox const in  = sched.attach(inbox_msg_type_1);
+  x9::async_inbox const out = sched.attach(inbox_msg_type_2);
+  assert(inbox_msg_type_1 == in.get());
+
+  uint64_t done = 0;
+  for (uint64_t k = 0; k != NUMBER_OF_COROUTINES; ++k) {
+    sched.spawn(coroutine_fn(in, out, k, &done));
+  }
+  assert(NUMBER_OF_COROUTINES == sched.n_tasks());
+
+  /* Producer and consumer */
+  uint64_t    msgs_read = 0;
+  std::thread producer_th(producer_fn, inbox_msg_type_1);
+  std::thread consumer_th(consumer_fn, inbox_msg_type_2, &msgs_read);
+
+  sched.run();
+
+  /* Join them */
+  producer_th.join();
+  consumer_th.join();
+
+  assert(NUMBER_OF_COROUTINES == done);
+  assert(0 == sched.n_tasks());
+  assert(NUMBER_OF_MESSAGES == msgs_read);
+
+  /* Cleanup */
+  x9_free_inbox(inbox_msg_type_1);
+  x9_free_inbox(inbox_msg_type_2);
+
+  printf("TEST PASSED: x9_example_17.cpp\n");
+  return EXIT_SUCCESS;
+}
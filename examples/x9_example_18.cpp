@@ -0,0 +1,155 @@
+/* x9_example_18.cpp
+ *
+ *  One producer
+ *  One consumer
+ *  One message type
+ *
+ *  ┌────────┐       ┏━━━━━━━━┓       ┌────────┐
+ *  │Producer│──────▷┃ inbox  ┃◁ ─ ─ ─│Consumer│
+ *  └────────┘       ┗━━━━━━━━┛       └────────┘
+ *
+ *  This example showcases the typed x9::inbox<T, Capacity>, which owns its
+ *  x9_inbox (freeing it when destroyed), can only be moved, and whose
+ *  member functions take/return messages of type 'T' instead of a 'msg_sz'
+ *  and a void pointer.
+ *  Must be compiled with '-std=c++20', and linked with x9.c compiled as C.
+ *
+ *  Data structures used:
+ *   - x9::inbox
+ *
+ *  Functions used:
+ *   - x9::inbox::write
+ *   - x9::inbox::write_spin
+ *   - x9::inbox::read
+ *   - x9::inbox::read_spin
+ *   - x9::inbox::depth_approx
+ *   - x9::inbox::get
+ *   - x9::inbox::release
+ *   - x9_inbox_sz
+ *   - x9_inbox_name_is
+ *   - x9_free_inbox
+ *
+ *  Test is considered passed iff:
+ *   - A moved from x9::inbox no longer owns a x9_inbox, and the one it was
+ *   moved to does.
+ *   - Messages of a type without a default constructor are read by value.
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - All messages sent by the producer are received, in order, and
+ *   asserted to be valid by the consumer.
+ */
+
+#include <cassert>     /* assert */
+#include <cstdint>     /* uint64_t */
+#include <cstdio>      /* printf */
+#include <cstdlib>     /* rand, RAND_MAX */
+#include <ctime>       /* time */
+#include <thread>      /* std::thread */
+#include <utility>     /* std::move */
+#include <x86intrin.h> /* _mm_pause */
+
+#include "../x9.hpp"
+
+/* Both producer and consumer loops, would commonly be infinite loops, but for
+ * the purpose of testing a reasonable NUMBER_OF_MESSAGES is defined. */
+#define NUMBER_OF_MESSAGES 1000000
+
+typedef struct {
+  uint64_t seq;
+  int      a;
+  int      b;
+  int      sum;
+  char     pad[4];
+} msg;
+
+typedef x9::inbox<msg, 4> msg_inbox;
+
+/* Not default constructible */
+struct point {
+  explicit point(uint64_t const x_) : x(x_) {}
+  uint64_t x;
+};
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static void producer_fn(msg_inbox* const inbox) {
+  msg m = {};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    m.seq = k;
+    m.a   = random_int(0, 10);
+    m.b   = random_int(0, 10);
+    m.sum = m.a + m.b;
+    /* Not 'write_spin', which moves on to the next slot when the current
+     * one is full, and thus doesn't keep the messages in order. */
+    while (!inbox->write(m)) { _mm_pause(); }
+  }
+}
+
+static void consumer_fn(msg_inbox* const inbox) {
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    msg const m = inbox->read_spin();
+    assert(m.seq == k);
+    assert(m.sum == (m.a + m.b));
+  }
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Create inbox */
+  msg_inbox first{"ibx"};
+  static_assert(4 == msg_inbox::capacity);
+  static_assert(sizeof(msg) == msg_inbox::msg_sz);
+  assert(4 == x9_inbox_sz(first.get()));
+
+  /* Moving it transfers the ownership of the x9_inbox */
+  x9_inbox* const underlying = first.get();
+  msg_inbox       inbox{std::move(first)};
+  assert(nullptr == first.get());
+  assert(underlying == inbox.get());
+  assert(x9_inbox_name_is(inbox.get(), "ibx"));
+
+  /* Non-spinning functions */
+  msg m = {};
+  assert(!inbox.read(m));
+  for (uint64_t k = 0; k != msg_inbox::capacity; ++k) {
+    m.seq = k;
+    assert(inbox.write(m));
+  }
+  assert(!inbox.write(m));
+  assert(msg_inbox::capacity == inbox.depth_approx());
+  for (uint64_t k = 0; k != msg_inbox::capacity; ++k) {
+    assert(inbox.read(m));
+    assert(m.seq == k);
+  }
+  assert(0 == inbox.depth_approx());
+
+  /* Spinning functions */
+  m.seq = msg_inbox::capacity;
+  inbox.write_spin(m);
+  assert(msg_inbox::capacity == inbox.read_spin().seq);
+
+  /* Types without a default constructor */
+  x9::inbox<point, 2> points{"points"};
+  points.write_spin(point{7});
+  assert(7 == points.read_spin().x);
+  points.write_spin(point{8});
+  assert(8 == points.read_shared_spin().x);
+
+  /* Producer and consumer */
+  std::thread producer_th(producer_fn, &inbox);
+  std::thread consumer_th(consumer_fn, &inbox);
+
+  /* Join them */
+  producer_th.join();
+  consumer_th.join();
+
+  /* Cleanup, 'inbox' would otherwise free it when going out of scope. */
+  x9_free_inbox(inbox.release());
+  assert(nullptr == inbox.get());
+
+  printf("TEST PASSED: x9_example_18.cpp\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,255 @@
+/* x9_example_19.c
+ *
+ *  Two clients
+ *  One server
+ *  Two message types (request and reply)
+ *
+ *  ┌────────┐       ┏━━━━━━━━━━┓
+ *  │Client 1│◁─────▷┃channel 1 ┃◁ ─ ─ ┐
+ *  └────────┘       ┗━━━━━━━━━━┛
+ *                                     │  ┌────────┐
+ *                                      ─ │ Server │
+ *                                     │  └────────┘
+ *  ┌────────┐       ┏━━━━━━━━━━┓
+ *  │Client 2│◁─────▷┃channel 2 ┃◁ ─ ─ ┘
+ *  └────────┘       ┗━━━━━━━━━━┛
+ *
+ *  This example showcases how to make synchronous calls (e.g. risk checks)
+ *  between threads with a x9_channel, without tagging messages and scanning
+ *  replies by hand.
+ *  Client 1 makes one call at a time, which the server handles in place with
+ *  'x9_serve'. Client 2 keeps several calls pending (pipelined), which the
+ *  server replies to out of order, and matches each reply by its id.
+ *
+ *  Data structures used:
+ *   - x9_channel
+ *
+ *  Functions used:
+ *   - x9_create_channel
+ *   - x9_channel_is_valid
+ *   - x9_channel_name_is
+ *   - x9_call
+ *   - x9_call_async
+ *   - x9_call_poll
+ *   - x9_serve
+ *   - x9_channel_recv
+ *   - x9_channel_reply
+ *   - x9_free_channel
+ *
+ *  Test is considered passed iff:
+ *   - No more than 'sz' calls can be pending at once.
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - Every call gets the reply to its own request, regardless of the order
+ *   the server replied in.
+ */
+
+#include <assert.h>    /* assert */
+#include <pthread.h>   /* pthread_t, pthread functions */
+#include <stdbool.h>   /* bool */
+#include <stdint.h>    /* uint64_t */
+#include <stdio.h>     /* printf */
+#include <stdlib.h>    /* rand, RAND_MAX */
+#include <time.h>      /* time */
+#include <x86intrin.h> /* _mm_pause */
+
+#include "../x9.h"
+
+/* Both client and server loops, would commonly be infinite loops, but for
+ * the purpose of testing a reasonable NUMBER_OF_CALLS is defined. */
+#define NUMBER_OF_CALLS 1000000
+
+#define CHANNEL_SZ 4
+
+/* Maximum number of requests the server holds before replying to them (in
+ * reverse order). */
+#define DEFERRED 4
+
+typedef struct {
+  x9_channel* chan_1;
+  x9_channel* chan_2;
+} th_struct;
+
+typedef struct {
+  uint64_t order_id;
+  int      qty;
+  int      limit;
+} risk_req;
+
+typedef struct {
+  uint64_t order_id;
+  bool     approved;
+  char     pad[7];
+} risk_reply;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static inline void fill_req(risk_req* const req, uint64_t const order_id) {
+  req->order_id = order_id;
+  req->qty      = random_int(0, 10);
+  req->limit    = random_int(0, 10);
+}
+
+static inline void check_reply(risk_req const* const   req,
+                               risk_reply const* const reply) {
+  assert(reply->order_id == req->order_id);
+  assert(reply->approved == (req->qty <= req->limit));
+}
+
+static void risk_check(void const* const req,
+                       void* const       reply,
+                       void* const       ctx) {
+  (void)ctx;
+  risk_req const* const r = (risk_req const*)req;
+  risk_reply* const     a = (risk_reply*)reply;
+  a->order_id             = r->order_id;
+  a->approved             = (r->qty <= r->limit);
+}
+
+static void* client_1_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  risk_req   req   = {0};
+  risk_reply reply = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_CALLS; ++k) {
+    fill_req(&req, k);
+    x9_call(data->chan_1, &req, &reply);
+    check_reply(&req, &reply);
+  }
+  return 0;
+}
+
+static void* client_2_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  uint64_t ids[CHANNEL_SZ]  = {0};
+  risk_req reqs[CHANNEL_SZ] = {0};
+  uint64_t n_pending        = 0;
+  uint64_t sent             = 0;
+  uint64_t received         = 0;
+
+  while (NUMBER_OF_CALLS != received) {
+    /* As many pending calls as the channel allows */
+    while ((NUMBER_OF_CALLS != sent) && (CHANNEL_SZ != n_pending)) {
+      fill_req(&reqs[n_pending], sent);
+      uint64_t const id = x9_call_async(data->chan_2, &reqs[n_pending]);
+      if (!id) { break; }
+      ids[n_pending++] = id;
+      ++sent;
+    }
+
+    /* Newest first, replies are matched by id in any order. */
+    for (uint64_t k = n_pending; k-- != 0;) {
+      risk_reply reply = {0};
+      if (x9_call_poll(data->chan_2, ids[k], &reply)) {
+        check_reply(&reqs[k], &reply);
+        assert(!x9_call_poll(data->chan_2, ids[k], &reply));
+        --n_pending;
+        ids[k]  = ids[n_pending];
+        reqs[k] = reqs[n_pending];
+        ++received;
+      }
+    }
+  }
+  return 0;
+}
+
+static void* server_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  uint64_t served_1 = 0;
+  uint64_t served_2 = 0;
+
+  while ((NUMBER_OF_CALLS != served_1) || (NUMBER_OF_CALLS != served_2)) {
+    served_1 += x9_serve(data->chan_1, risk_check, NULL, CHANNEL_SZ);
+
+    /* Replies to the requests held in reverse order */
+    uint64_t ids[DEFERRED]  = {0};
+    risk_req reqs[DEFERRED] = {0};
+    uint64_t n              = 0;
+    while (DEFERRED != n) {
+      if (!x9_channel_recv(data->chan_2, &reqs[n], &ids[n])) { break; }
+      ++n;
+    }
+    for (uint64_t k = n; k-- != 0;) {
+      risk_reply reply = {0};
+      risk_check(&reqs[k], &reply, NULL);
+      x9_channel_reply(data->chan_2, ids[k], &reply);
+    }
+    served_2 += n;
+
+    if (!n) { _mm_pause(); }
+  }
+  return 0;
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Create channels */
+  x9_channel* const chan_1 = x9_create_channel(CHANNEL_SZ, "chan_1",
+                                               sizeof(risk_req),
+                                               sizeof(risk_reply));
+
+  x9_channel* const chan_2 = x9_create_channel(CHANNEL_SZ, "chan_2",
+                                               sizeof(risk_req),
+                                               sizeof(risk_reply));
+
+  /* Using asserts to simplify code for presentation purpose. */
+  assert(x9_channel_is_valid(chan_1));
+  assert(x9_channel_is_valid(chan_2));
+  assert(x9_channel_name_is(chan_1, "chan_1"));
+
+  /* Same size rules as 'x9_create_inbox' */
+  assert(!x9_channel_is_valid(
+      x9_create_channel(3, "chan_3", sizeof(risk_req), sizeof(risk_reply))));
+
+  /* At most CHANNEL_SZ pending calls */
+  uint64_t ids[CHANNEL_SZ]  = {0};
+  risk_req reqs[CHANNEL_SZ] = {0};
+  for (uint64_t k = 0; k != CHANNEL_SZ; ++k) {
+    fill_req(&reqs[k], k);
+    ids[k] = x9_call_async(chan_1, &reqs[k]);
+    assert(ids[k]);
+  }
+  assert(!x9_call_async(chan_1, &reqs[0]));
+
+  /* Not replied to yet */
+  risk_reply reply = {0};
+  assert(!x9_call_poll(chan_1, ids[0], &reply));
+
+  assert(CHANNEL_SZ == x9_serve(chan_1, risk_check, NULL, CHANNEL_SZ + 1));
+  assert(0 == x9_serve(chan_1, risk_check, NULL, CHANNEL_SZ));
+  for (uint64_t k = CHANNEL_SZ; k-- != 0;) {
+    assert(x9_call_poll(chan_1, ids[k], &reply));
+    check_reply(&reqs[k], &reply);
+  }
+
+  /* Clients */
+  pthread_t client_1_th = {0};
+  pthread_t client_2_th = {0};
+
+  /* Server */
+  pthread_t server_th = {0};
+
+  th_struct th_data = {.chan_1 = chan_1, .chan_2 = chan_2};
+
+  /* Launch threads */
+  pthread_create(&client_1_th, NULL, client_1_fn, &th_data);
+  pthread_create(&client_2_th, NULL, client_2_fn, &th_data);
+  pthread_create(&server_th, NULL, server_fn, &th_data);
+
+  /* Join them */
+  pthread_join(client_1_th, NULL);
+  pthread_join(client_2_th, NULL);
+  pthread_join(server_th, NULL);
+
+  /* Cleanup */
+  x9_free_channel(chan_1);
+  x9_free_channel(chan_2);
+
+  printf("TEST PASSED: x9_example_19.c\n");
+  return EXIT_SUCCESS;
+}
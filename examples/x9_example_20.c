@@ -0,0 +1,212 @@
+/* x9_example_20.c
+ *
+ *  One producer
+ *  One consumer (live) and one consumer (replay)
+ *  One message type
+ *
+ *                   ┏━━━━━━━━━━━━━━━━━━━━━━━┓       ┌────────┐
+ *  ┌────────┐       ┃        journal        ┃◁ ─ ─ ─│Consumer│
+ *  │Producer│──────▷┃ (<path>.0, <path>.1,  ┃       └────────┘
+ *  └────────┘       ┃         ...)          ┃       ┌────────┐
+ *                   ┃                       ┃◁ ─ ─ ─│ Replay │
+ *                   ┗━━━━━━━━━━━━━━━━━━━━━━━┛       └────────┘
+ *
+ *  This example showcases how a x9_journal persists every message written
+ *  to it in memory mapped segment files, without a copy on the side of the
+ *  producer, while a consumer reads them live, and how, once the journal is
+ *  reopened (e.g. after a crash), a consumer can replay them from any
+ *  sequence number.
+ *
+ *  Data structures used:
+ *   - x9_journal
+ *   - x9_journal_cursor
+ *
+ *  Functions used:
+ *   - x9_create_journal
+ *   - x9_journal_is_valid
+ *   - x9_journal_name_is
+ *   - x9_write_to_journal_spin
+ *   - x9_journal_seq
+ *   - x9_journal_synced_seq
+ *   - x9_journal_attach
+ *   - x9_journal_cursor_seq
+ *   - x9_read_from_journal
+ *   - x9_read_from_journal_spin
+ *   - x9_journal_detach
+ *   - x9_free_journal
+ *
+ *  Test is considered passed iff:
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - All messages sent by the producer are received, in order, and
+ *   asserted to be valid by the consumer.
+ *   - Reopening it with a different segment or message size fails without
+ *   truncating its files.
+ *   - Once reopened, the journal contains all of them, and they can be
+ *   replayed from any sequence number.
+ */
+
+#include <assert.h>  /* assert */
+#include <pthread.h> /* pthread_t, pthread functions */
+#include <stdint.h>  /* uint64_t */
+#include <stdio.h>   /* printf, snprintf, remove */
+#include <stdlib.h>  /* rand, RAND_MAX */
+#include <time.h>    /* time */
+
+#include "../x9.h"
+
+/* Both producer and consumer loops, would commonly be infinite loops, but for
+ * the purpose of testing a reasonable NUMBER_OF_MESSAGES is defined. */
+#define NUMBER_OF_MESSAGES 1000000
+
+#define JOURNAL_PATH     "/tmp/x9_example_20_journal"
+#define SEGMENT_SZ       65536
+#define MAX_SEGMENTS     32
+#define SYNC_INTERVAL_MS 10
+
+typedef struct {
+  x9_journal* journal;
+} th_struct;
+
+typedef struct {
+  uint64_t seq;
+  int      a;
+  int      b;
+  int      sum;
+  char     pad[4];
+} msg;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static inline void check_msg(msg const* const m, uint64_t const seq) {
+  assert(m->seq == seq);
+  assert(m->sum == (m->a + m->b));
+}
+
+static void* producer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    m.seq = k;
+    m.a   = random_int(0, 10);
+    m.b   = random_int(0, 10);
+    m.sum = m.a + m.b;
+    x9_write_to_journal_spin(data->journal, sizeof(msg), &m);
+  }
+  return 0;
+}
+
+static void* consumer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  x9_journal_cursor* const cursor = x9_journal_attach(data->journal, 0);
+  assert(cursor);
+
+  msg m = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    x9_read_from_journal_spin(cursor, sizeof(msg), &m);
+    check_msg(&m, k);
+  }
+  assert(NUMBER_OF_MESSAGES == x9_journal_cursor_seq(cursor));
+  x9_journal_detach(cursor);
+  return 0;
+}
+
+static void remove_segments(void) {
+  for (uint64_t k = 0; k != MAX_SEGMENTS; ++k) {
+    char file[64] = {0};
+    snprintf(file, sizeof(file), "%s.%lu", JOURNAL_PATH, k);
+    remove(file);
+  }
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Start from scratch */
+  remove_segments();
+
+  /* Create journal */
+  x9_journal* journal = x9_create_journal(JOURNAL_PATH, SEGMENT_SZ,
+                                          MAX_SEGMENTS, sizeof(msg),
+                                          SYNC_INTERVAL_MS);
+
+  /* Using asserts to simplify code for presentation purpose. */
+  assert(x9_journal_is_valid(journal));
+  assert(x9_journal_name_is(journal, JOURNAL_PATH));
+  assert(0 == x9_journal_seq(journal));
+
+  /* Beyond its capacity */
+  assert(!x9_journal_attach(journal, SEGMENT_SZ * MAX_SEGMENTS));
+
+  /* Producer */
+  pthread_t producer_th     = {0};
+  th_struct producer_struct = {.journal = journal};
+
+  /* Consumer */
+  pthread_t consumer_th     = {0};
+  th_struct consumer_struct = {.journal = journal};
+
+  /* Launch threads */
+  pthread_create(&producer_th, NULL, producer_fn, &producer_struct);
+  pthread_create(&consumer_th, NULL, consumer_fn, &consumer_struct);
+
+  /* Join them */
+  pthread_join(producer_th, NULL);
+  pthread_join(consumer_th, NULL);
+
+  assert(NUMBER_OF_MESSAGES == x9_journal_seq(journal));
+  x9_free_journal(journal);
+
+  /* Its files are never truncated by a journal that doesn't match them */
+  assert(!x9_journal_is_valid(x9_create_journal(
+      JOURNAL_PATH, SEGMENT_SZ * 2, MAX_SEGMENTS, sizeof(msg),
+      SYNC_INTERVAL_MS)));
+  assert(!x9_journal_is_valid(x9_create_journal(
+      JOURNAL_PATH, SEGMENT_SZ, MAX_SEGMENTS, sizeof(msg) * 2,
+      SYNC_INTERVAL_MS)));
+
+  /* The background thread needs a sync interval */
+  assert(!x9_journal_is_valid(
+      x9_create_journal(JOURNAL_PATH, SEGMENT_SZ, MAX_SEGMENTS, sizeof(msg),
+                        0)));
+
+  /* Reopen it, as if the process had crashed. */
+  journal = x9_create_journal(JOURNAL_PATH, SEGMENT_SZ, MAX_SEGMENTS,
+                              sizeof(msg), SYNC_INTERVAL_MS);
+  assert(x9_journal_is_valid(journal));
+  assert(NUMBER_OF_MESSAGES == x9_journal_seq(journal));
+  assert(NUMBER_OF_MESSAGES == x9_journal_synced_seq(journal));
+
+  /* Replay from the middle of the session */
+  uint64_t const           from   = NUMBER_OF_MESSAGES / 2 + 1;
+  x9_journal_cursor* const replay = x9_journal_attach(journal, from);
+  assert(replay);
+
+  msg m = {0};
+  for (uint64_t k = from; k != NUMBER_OF_MESSAGES; ++k) {
+    assert(x9_read_from_journal(replay, sizeof(msg), &m));
+    check_msg(&m, k);
+  }
+  /* Nothing was written after the last message */
+  assert(!x9_read_from_journal(replay, sizeof(msg), &m));
+
+  /* Writing resumes after the last message */
+  m.seq = NUMBER_OF_MESSAGES;
+  m.sum = m.a + m.b;
+  x9_write_to_journal_spin(journal, sizeof(msg), &m);
+  assert((NUMBER_OF_MESSAGES + 1) == x9_journal_seq(journal));
+  assert(x9_read_from_journal(replay, sizeof(msg), &m));
+  check_msg(&m, NUMBER_OF_MESSAGES);
+
+  /* Cleanup */
+  x9_journal_detach(replay);
+  x9_free_journal(journal);
+  remove_segments();
+
+  printf("TEST PASSED: x9_example_20.c\n");
+  return EXIT_SUCCESS;
+}
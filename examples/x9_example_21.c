@@ -0,0 +1,222 @@
+/* x9_example_21.c
+ *
+ *  Two producers
+ *  One consumer
+ *  One message type
+ *
+ *  ┌────────┐      ┏━━━━━━━━┓
+ *  │Producer│─────▷┃        ┃
+ *  └────────┘      ┃        ┃      ┌────────┐
+ *                  ┃ inbox  ┃◁ ─ ─ │Consumer│
+ *  ┌────────┐      ┃        ┃      └────────┘
+ *  │Producer│─────▷┃        ┃
+ *  └────────┘      ┗━━━━━━━━┛
+ *                      ┆
+ *                      ▽
+ *                 ┌──────────┐
+ *                 │  trace   │
+ *                 │  (file)  │
+ *                 └──────────┘
+ *
+ *  This example showcases how to capture the traffic of an inbox while it
+ *  is in use (must be compiled with -D X9_TRACE), by writing every message
+ *  and the TSC of when it was published to a binary trace file, which
+ *  '--test 8 --trace_file' of 'x9_profiler.c' can replay against other
+ *  inbox configurations.
+ *
+ *  Data structures used:
+ *   - x9_inbox
+ *   - x9_trace
+ *   - x9_trace_header
+ *
+ *  Functions used:
+ *   - x9_calibrate_tsc
+ *   - x9_create_inbox
+ *   - x9_inbox_is_valid
+ *   - x9_trace_inbox
+ *   - x9_trace_is_valid
+ *   - x9_write_to_inbox_spin
+ *   - x9_read_from_inbox_spin
+ *   - x9_trace_n_msgs
+ *   - x9_trace_dropped
+ *   - x9_trace_stop
+ *   - x9_free_inbox
+ *
+ *  Test is considered passed iff:
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - All messages sent by the producers are received and asserted to be
+ *   valid by the consumer.
+ *   - Every message is either in the trace, in the order each producer sent
+ *   it and with non decreasing TSCs, or counted as dropped.
+ *   - Tracing the inbox a second time, or to an existing file, fails
+ *   without touching the file.
+ */
+
+#include <assert.h>  /* assert */
+#include <pthread.h> /* pthread_t, pthread functions */
+#include <stdint.h>  /* uint64_t */
+#include <stdio.h>   /* printf, fopen, fread, remove */
+#include <stdlib.h>  /* rand, RAND_MAX */
+#include <string.h>  /* memcmp */
+#include <time.h>    /* time */
+
+#include "../x9.h"
+
+/* Both producer and consumer loops, would commonly be infinite loops, but for
+ * the purpose of testing a reasonable NUMBER_OF_MESSAGES is defined. */
+#define NUMBER_OF_MESSAGES 1000000
+
+#define TRACE_PATH   "/tmp/x9_example_21.x9trace"
+#define TRACE_BUF_SZ 4096
+
+#define NUMBER_OF_PRODUCERS 2
+
+typedef struct {
+  x9_inbox* inbox;
+  int       producer;
+} th_struct;
+
+typedef struct {
+  uint64_t seq;
+  int      a;
+  int      b;
+  int      sum;
+  int      producer;
+} msg;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static void* producer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.producer = data->producer};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    m.seq = k;
+    m.a   = random_int(0, 10);
+    m.b   = random_int(0, 10);
+    m.sum = m.a + m.b;
+    x9_write_to_inbox_spin(data->inbox, sizeof(msg), &m);
+  }
+  return 0;
+}
+
+static void* consumer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {0};
+  for (uint64_t k = 0; k != (NUMBER_OF_PRODUCERS * NUMBER_OF_MESSAGES); ++k) {
+    x9_read_from_inbox_spin(data->inbox, sizeof(msg), &m);
+    assert(m.seq < NUMBER_OF_MESSAGES);
+    assert(m.sum == (m.a + m.b));
+  }
+  return 0;
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Start from scratch */
+  remove(TRACE_PATH);
+  remove(TRACE_PATH ".2");
+
+  /* The trace header records how long a TSC cycle takes. */
+  x9_calibrate_tsc();
+
+  /* Create inbox */
+  x9_inbox* const inbox = x9_create_inbox(4, "ibx", sizeof(msg));
+
+  /* Using asserts to simplify code for presentation purpose. */
+  assert(x9_inbox_is_valid(inbox));
+
+  /* Start capturing its traffic */
+  x9_trace* const trace = x9_trace_inbox(inbox, TRACE_PATH, TRACE_BUF_SZ);
+  assert(x9_trace_is_valid(trace));
+
+  /* An inbox can only be traced once at a time, and the file of the running
+   * trace is left untouched. */
+  assert(!x9_trace_is_valid(x9_trace_inbox(inbox, TRACE_PATH ".2", 64)));
+  assert(NULL == fopen(TRACE_PATH ".2", "rb"));
+  assert(!x9_trace_is_valid(x9_trace_inbox(inbox, TRACE_PATH, 64)));
+
+  /* An existing capture is never overwritten */
+  x9_inbox* const other = x9_create_inbox(4, "other", sizeof(msg));
+  assert(x9_inbox_is_valid(other));
+  assert(!x9_trace_is_valid(x9_trace_inbox(other, TRACE_PATH, 64)));
+  x9_free_inbox(other);
+
+  /* Producers */
+  pthread_t producer_th_1     = {0};
+  th_struct producer_struct_1 = {.inbox = inbox, .producer = 0};
+
+  pthread_t producer_th_2     = {0};
+  th_struct producer_struct_2 = {.inbox = inbox, .producer = 1};
+
+  /* Consumer */
+  pthread_t consumer_th     = {0};
+  th_struct consumer_struct = {.inbox = inbox};
+
+  /* Launch threads */
+  pthread_create(&producer_th_1, NULL, producer_fn, &producer_struct_1);
+  pthread_create(&producer_th_2, NULL, producer_fn, &producer_struct_2);
+  pthread_create(&consumer_th, NULL, consumer_fn, &consumer_struct);
+
+  /* Join them */
+  pthread_join(producer_th_1, NULL);
+  pthread_join(producer_th_2, NULL);
+  pthread_join(consumer_th, NULL);
+
+  /* Nothing is dropped once the producers are done */
+  uint64_t const dropped = x9_trace_dropped(trace);
+  assert((x9_trace_n_msgs(trace) + dropped) <=
+         (NUMBER_OF_PRODUCERS * NUMBER_OF_MESSAGES));
+
+  /* Writes what is left and fills the header */
+  x9_trace_stop(trace);
+
+  /* Check the trace */
+  FILE* const f = fopen(TRACE_PATH, "rb");
+  assert(f);
+
+  msg             m      = {0};
+  x9_trace_header header = {0};
+  assert(1 == fread(&header, sizeof(x9_trace_header), 1, f));
+  assert(!memcmp(header.magic, X9_TRACE_MAGIC, sizeof(X9_TRACE_MAGIC)));
+  assert(X9_TRACE_VERSION == header.version);
+  assert(sizeof(msg) == header.msg_sz);
+  assert(dropped == header.dropped);
+  /* Both producers claim slots of the trace buffer concurrently, yet none is
+   * left behind: every message was either written or dropped. */
+  assert((NUMBER_OF_PRODUCERS * NUMBER_OF_MESSAGES) ==
+         (header.n_msgs + header.dropped));
+  assert(header.ns_per_cycle > 0);
+
+  uint64_t n_msgs                        = 0;
+  uint64_t n_seen[NUMBER_OF_PRODUCERS]   = {0};
+  uint64_t prev_seq[NUMBER_OF_PRODUCERS] = {0};
+  uint64_t prev_tsc[NUMBER_OF_PRODUCERS] = {0};
+  for (;;) {
+    uint64_t tsc = 0;
+    if (1 != fread(&tsc, sizeof(uint64_t), 1, f)) { break; }
+    assert(1 == fread(&m, sizeof(msg), 1, f));
+    assert(m.sum == (m.a + m.b));
+    assert((m.producer >= 0) && (m.producer < NUMBER_OF_PRODUCERS));
+    int const p = m.producer;
+    assert(!n_seen[p] || ((m.seq > prev_seq[p]) && (tsc >= prev_tsc[p])));
+    prev_seq[p] = m.seq;
+    prev_tsc[p] = tsc;
+    ++n_seen[p];
+    ++n_msgs;
+  }
+  assert(header.n_msgs == n_msgs);
+  fclose(f);
+
+  /* Cleanup */
+  x9_free_inbox(inbox);
+  remove(TRACE_PATH);
+
+  printf("TEST PASSED: x9_example_21.c\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+/* x9_example_7.c
+ *
+ *  Two producers, each writing to a different lane of the same inbox.
+ *  One consumer.
+ *  One message type.
+ *
+ *  ┌────────┐       ┏━━━━━━━━┓
+ *  │Producer│──────▷┃ lane 0 ┃
+ *  └────────┘       ┃        ┃       ┌────────┐
+ *                   ┃ inbox  ┃◁ ─ ─ ─│Consumer│
+ *  ┌────────┐       ┃        ┃       └────────┘
+ *  │Producer│──────▷┃ lane 1 ┃
+ *  └────────┘       ┗━━━━━━━━┛
+ *
+ *  This example showcases the use of 'x9_prio_inbox', where the consumer
+ *  always drains the most urgent (lowest numbered) non-empty lane first.
+ *
+ *  Data structures used:
+ *   - x9_prio_inbox
+ *
+ *  Functions used:
+ *   - x9_create_prio_inbox
+ *   - x9_prio_inbox_is_valid
+ *   - x9_write_to_prio_inbox
+ *   - x9_write_to_prio_inbox_spin
+ *   - x9_read_from_prio_inbox
+ *   - x9_read_from_prio_inbox_spin
+ *   - x9_free_prio_inbox
+ *
+ *  Test is considered passed iff:
+ *   - A message written to lane 0 is read before the messages already
+ *   pending in lane 1.
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - All messages sent by the producer(s) are received, in order within
+ *   each lane, and asserted to be valid by the consumer(s).
+ */
+
+#include <assert.h>  /* assert */
+#include <pthread.h> /* pthread_t, pthread functions */
+#include <stdint.h>  /* uint64_t */
+#include <stdio.h>   /* printf */
+#include <stdlib.h>  /* rand, RAND_MAX */
+
+#include "../x9.h"
+
+/* Both producer and consumer loops, would commonly be infinite loops, but for
+ * the purpose of testing a reasonable NUMBER_OF_MESSAGES is defined. */
+#define NUMBER_OF_MESSAGES 1000000
+
+#define NUMBER_OF_LANES 2
+
+typedef struct {
+  x9_prio_inbox* inbox;
+  uint64_t       lane;
+} th_struct;
+
+typedef struct {
+  uint64_t lane;
+  uint64_t seq;
+  int      a;
+  int      b;
+  int      sum;
+  char     pad[4];
+} msg;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static inline void fill_msg_type(msg* const m) {
+  m->a   = random_int(0, 10);
+  m->b   = random_int(0, 10);
+  m->sum = m->a + m->b;
+}
+
+static void* producer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.lane = data->lane};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    fill_msg_type(&m);
+    m.seq = k;
+    if (0 == data->lane) {
+      while (!x9_write_to_prio_inbox(data->inbox, 0, sizeof(msg), &m)) {}
+    } else {
+      x9_write_to_prio_inbox_spin(data->inbox, data->lane, sizeof(msg), &m);
+    }
+  }
+  return 0;
+}
+
+static void* consumer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  uint64_t next_seq[NUMBER_OF_LANES] = {0};
+
+  msg m = {0};
+  for (uint64_t k = 0; k != (NUMBER_OF_MESSAGES * NUMBER_OF_LANES); ++k) {
+    x9_read_from_prio_inbox_spin(data->inbox, sizeof(msg), &m);
+    assert(m.sum == (m.a + m.b));
+    assert(m.seq == next_seq[m.lane]);
+    ++next_seq[m.lane];
+  }
+  assert(next_seq[0] == NUMBER_OF_MESSAGES);
+  assert(next_seq[1] == NUMBER_OF_MESSAGES);
+  return 0;
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Create inbox */
+  x9_prio_inbox* const inbox =
+      x9_create_prio_inbox(NUMBER_OF_LANES, 4, "ibx", sizeof(msg));
+
+  /* Using assert to simplify code for presentation purpose. */
+  assert(x9_prio_inbox_is_valid(inbox));
+
+  /* Urgent messages overtake the backlog. */
+  msg m = {.lane = 1};
+  assert(x9_write_to_prio_inbox(inbox, 1, sizeof(msg), &m));
+  assert(x9_write_to_prio_inbox(inbox, 1, sizeof(msg), &m));
+  m.lane = 0;
+  assert(x9_write_to_prio_inbox(inbox, 0, sizeof(msg), &m));
+
+  assert(x9_read_from_prio_inbox(inbox, sizeof(msg), &m) && (0 == m.lane));
+  assert(x9_read_from_prio_inbox(inbox, sizeof(msg), &m) && (1 == m.lane));
+  assert(x9_read_from_prio_inbox(inbox, sizeof(msg), &m) && (1 == m.lane));
+  assert(!x9_read_from_prio_inbox(inbox, sizeof(msg), &m));
+
+  /* Producers */
+  pthread_t producer_1_th     = {0};
+  th_struct producer_1_struct = {.inbox = inbox, .lane = 0};
+
+  pthread_t producer_2_th     = {0};
+  th_struct producer_2_struct = {.inbox = inbox, .lane = 1};
+
+  /* Consumer */
+  pthread_t consumer_th     = {0};
+  th_struct consumer_struct = {.inbox = inbox};
+
+  /* Launch threads */
+  pthread_create(&producer_1_th, NULL, producer_fn, &producer_1_struct);
+  pthread_create(&producer_2_th, NULL, producer_fn, &producer_2_struct);
+  pthread_create(&consumer_th, NULL, consumer_fn, &consumer_struct);
+
+  /* Join them */
+  pthread_join(producer_1_th, NULL);
+  pthread_join(producer_2_th, NULL);
+  pthread_join(consumer_th, NULL);
+
+  /* Cleanup */
+  x9_free_prio_inbox(inbox);
+
+  printf("TEST PASSED: x9_example_7.c\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+/* x9_example_8.c
+ *
+ *  One producer writing updates for a fixed set of keys.
+ *  One consumer only interested in the latest update of each key.
+ *  One message type.
+ *
+ *  ┌────────┐       ┏━━━━━━━━━━┓       ┌────────┐
+ *  │Producer│──────▷┃conflating┃◁ ─ ─ ─│Consumer│
+ *  └────────┘       ┃  inbox   ┃       └────────┘
+ *                   ┗━━━━━━━━━━┛
+ *
+ *  This example showcases the use of 'x9_conflating_inbox', where an update
+ *  for a key that was not read yet overwrites the previous one, so a slow
+ *  consumer skips stale updates instead of processing all of them.
+ *
+ *  Data structures used:
+ *   - x9_conflating_inbox
+ *
+ *  Functions used:
+ *   - x9_create_conflating_inbox
+ *   - x9_conflating_inbox_is_valid
+ *   - x9_write_to_conflating_inbox
+ *   - x9_read_from_conflating_inbox
+ *   - x9_read_from_conflating_inbox_spin
+ *   - x9_free_conflating_inbox
+ *
+ *  Test is considered passed iff:
+ *   - Multiple pending updates of the same key are read once, with the value
+ *   of the latest update.
+ *   - Writing more keys than the inbox was created for fails.
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - The updates read for each key are valid, never older than the
+ *   previous one read for that key, and the last update of every key is
+ *   received by the consumer.
+ */
+
+#include <assert.h>  /* assert */
+#include <pthread.h> /* pthread_t, pthread functions */
+#include <stdbool.h> /* bool */
+#include <stdint.h>  /* uint64_t */
+#include <stdio.h>   /* printf */
+#include <stdlib.h>  /* rand, RAND_MAX */
+
+#include "../x9.h"
+
+/* Both producer and consumer loops, would commonly be infinite loops, but for
+ * the purpose of testing a reasonable NUMBER_OF_MESSAGES is defined. */
+#define NUMBER_OF_MESSAGES 1000000
+
+#define NUMBER_OF_KEYS 8
+
+typedef struct {
+  x9_conflating_inbox* inbox;
+  uint64_t             msgs_read;
+} th_struct;
+
+typedef struct {
+  uint64_t version;
+  int      a;
+  int      b;
+  int      sum;
+  char     pad[4];
+} msg;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static inline void fill_msg_type(msg* const m) {
+  m->a   = random_int(0, 10);
+  m->b   = random_int(0, 10);
+  m->sum = m->a + m->b;
+}
+
+static void* producer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {0};
+  for (uint64_t k = 0; k != NUMBER_OF_MESSAGES; ++k) {
+    fill_msg_type(&m);
+    m.version          = k / NUMBER_OF_KEYS;
+    bool const written = x9_write_to_conflating_inbox(
+        data->inbox, k % NUMBER_OF_KEYS, sizeof(msg), &m);
+    assert(written);
+  }
+  return 0;
+}
+
+static void* consumer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  uint64_t const last_version = (NUMBER_OF_MESSAGES / NUMBER_OF_KEYS) - 1;
+  uint64_t       versions[NUMBER_OF_KEYS] = {0};
+  uint64_t       keys_done                = 0;
+
+  msg      m   = {0};
+  uint64_t key = 0;
+  while (keys_done != NUMBER_OF_KEYS) {
+    x9_read_from_conflating_inbox_spin(data->inbox, sizeof(msg), &key, &m);
+    assert(key < NUMBER_OF_KEYS);
+    assert(m.sum == (m.a + m.b));
+    assert(m.version >= versions[key]);
+    if ((m.version == last_version) && (versions[key] != last_version)) {
+      ++keys_done;
+    }
+    versions[key] = m.version;
+    ++data->msgs_read;
+  }
+  return 0;
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Create inbox */
+  x9_conflating_inbox* const inbox =
+      x9_create_conflating_inbox(NUMBER_OF_KEYS, "ibx", sizeof(msg));
+
+  /* Using assert to simplify code for presentation purpose. */
+  assert(x9_conflating_inbox_is_valid(inbox));
+
+  /* Pending updates of the same key are conflated. */
+  msg      m   = {0};
+  uint64_t key = 0;
+  bool     ok  = false;
+  for (uint64_t k = 0; k != 3; ++k) {
+    m.version = k;
+    ok        = x9_write_to_conflating_inbox(inbox, 0, sizeof(msg), &m);
+    assert(ok);
+  }
+  ok = x9_read_from_conflating_inbox(inbox, sizeof(msg), &key, &m);
+  assert(ok && (0 == key) && (2 == m.version));
+  ok = x9_read_from_conflating_inbox(inbox, sizeof(msg), &key, &m);
+  assert(!ok);
+
+  /* The inbox holds at most NUMBER_OF_KEYS distinct keys. */
+  for (uint64_t k = 1; k != NUMBER_OF_KEYS; ++k) {
+    ok = x9_write_to_conflating_inbox(inbox, k, sizeof(msg), &m);
+    assert(ok);
+  }
+  ok = x9_write_to_conflating_inbox(inbox, NUMBER_OF_KEYS, sizeof(msg), &m);
+  assert(!ok);
+  for (uint64_t k = 1; k != NUMBER_OF_KEYS; ++k) {
+    ok = x9_read_from_conflating_inbox(inbox, sizeof(msg), &key, &m);
+    assert(ok);
+  }
+
+  /* Producer */
+  pthread_t producer_th     = {0};
+  th_struct producer_struct = {.inbox = inbox};
+
+  /* Consumer */
+  pthread_t consumer_th     = {0};
+  th_struct consumer_struct = {.inbox = inbox};
+
+  /* Launch threads */
+  pthread_create(&producer_th, NULL, producer_fn, &producer_struct);
+  pthread_create(&consumer_th, NULL, consumer_fn, &consumer_struct);
+
+  /* Join them */
+  pthread_join(producer_th, NULL);
+  pthread_join(consumer_th, NULL);
+
+  /* Assert that stale updates were not all delivered. */
+  assert(consumer_struct.msgs_read <= NUMBER_OF_MESSAGES);
+
+  /* Cleanup */
+  x9_free_conflating_inbox(inbox);
+
+  printf("TEST PASSED: x9_example_8.c\n");
+  return EXIT_SUCCESS;
+}
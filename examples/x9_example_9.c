@@ -0,0 +1,158 @@
+/* x9_example_9.c
+ *
+ *  One producer
+ *  One consumer
+ *  One message type
+ *
+ *  ┌────────┐       ┏━━━━━━━━┓       ┌────────┐
+ *  │Producer│──────▷┃ inbox  ┃◁ ─ ─ ─│Consumer│
+ *  └────────┘       ┗━━━━━━━━┛       └────────┘
+ *
+ *  This example showcases the use of 'x9_inbox_stats', which requires the
+ *  library to be compiled with 'X9_STATS'.
+ *  Half of the messages are sent with the non spinning functions and the
+ *  other half with the spinning ones.
+ *
+ *  Data structures used:
+ *   - x9_inbox
+ *
+ *  Functions used:
+ *   - x9_create_inbox
+ *   - x9_inbox_is_valid
+ *   - x9_write_to_inbox
+ *   - x9_write_to_inbox_spin
+ *   - x9_read_from_inbox
+ *   - x9_read_from_inbox_spin
+ *   - x9_inbox_stats
+ *   - x9_free_inbox
+ *
+ *  Test is considered passed iff:
+ *   - None of the threads stall and exit cleanly after doing the work.
+ *   - All messages sent by the producer(s) are received and asserted to be
+ *   valid by the consumer(s).
+ *   - The inbox counters match the number of messages and attempts done by
+ *   the producer(s) and consumer(s).
+ */
+
+#include <assert.h>  /* assert */
+#include <pthread.h> /* pthread_t, pthread functions */
+#include <stdbool.h> /* bool */
+#include <stdint.h>  /* uint64_t */
+#include <stdio.h>   /* printf */
+#include <stdlib.h>  /* rand, RAND_MAX */
+
+#include "../x9.h"
+
+/* Both producer and consumer loops, would commonly be infinite loops, but for
+ * the purpose of testing a reasonable NUMBER_OF_MESSAGES is defined. */
+#define NUMBER_OF_MESSAGES 1000000
+
+typedef struct {
+  x9_inbox* inbox;
+  uint64_t  attempts;
+} th_struct;
+
+typedef struct {
+  int a;
+  int b;
+  int sum;
+} msg;
+
+static inline int random_int(int const min, int const max) {
+  return min + rand() / (RAND_MAX / (max - min + 1) + 1);
+}
+
+static inline void fill_msg_type(msg* const m) {
+  m->a   = random_int(0, 10);
+  m->b   = random_int(0, 10);
+  m->sum = m->a + m->b;
+}
+
+static void* producer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {0};
+  for (uint64_t k = 0; k != (NUMBER_OF_MESSAGES / 2); ++k) {
+    fill_msg_type(&m);
+    for (;;) {
+      ++data->attempts;
+      if (x9_write_to_inbox(data->inbox, sizeof(msg), &m)) { break; }
+    }
+  }
+  for (uint64_t k = 0; k != (NUMBER_OF_MESSAGES / 2); ++k) {
+    fill_msg_type(&m);
+    x9_write_to_inbox_spin(data->inbox, sizeof(msg), &m);
+  }
+  return 0;
+}
+
+static void* consumer_fn(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {0};
+  for (uint64_t k = 0; k != (NUMBER_OF_MESSAGES / 2); ++k) {
+    for (;;) {
+      ++data->attempts;
+      if (x9_read_from_inbox(data->inbox, sizeof(msg), &m)) { break; }
+    }
+    assert(m.sum == (m.a + m.b));
+  }
+  for (uint64_t k = 0; k != (NUMBER_OF_MESSAGES / 2); ++k) {
+    x9_read_from_inbox_spin(data->inbox, sizeof(msg), &m);
+    assert(m.sum == (m.a + m.b));
+  }
+  return 0;
+}
+
+int main(void) {
+  /* Seed random generator */
+  srand((uint32_t)time(0));
+
+  /* Create inbox */
+  x9_inbox* const inbox = x9_create_inbox(4, "ibx", sizeof(msg));
+
+  /* Using assert to simplify code for presentation purpose. */
+  assert(x9_inbox_is_valid(inbox));
+
+  /* Producer */
+  pthread_t producer_th     = {0};
+  th_struct producer_struct = {.inbox = inbox};
+
+  /* Consumer */
+  pthread_t consumer_th     = {0};
+  th_struct consumer_struct = {.inbox = inbox};
+
+  /* Launch threads */
+  pthread_create(&producer_th, NULL, producer_fn, &producer_struct);
+  pthread_create(&consumer_th, NULL, consumer_fn, &consumer_struct);
+
+  /* Join them */
+  pthread_join(producer_th, NULL);
+  pthread_join(consumer_th, NULL);
+
+  /* Check the counters */
+  x9_inbox_counters counters = {0};
+  bool const        enabled  = x9_inbox_stats(inbox, &counters);
+  assert(enabled);
+
+  assert(NUMBER_OF_MESSAGES == counters.writes);
+  assert(NUMBER_OF_MESSAGES == counters.reads);
+  assert((producer_struct.attempts - (NUMBER_OF_MESSAGES / 2)) ==
+         counters.write_failures);
+  assert((consumer_struct.attempts - (NUMBER_OF_MESSAGES / 2)) ==
+         counters.read_failures);
+  /* Each failed call found the slot either occupied or contended, and the
+   * spinning calls count at most one event for all of their spins. */
+  assert(counters.write_failures <=
+         (counters.full_events + counters.write_cas_failures));
+  assert(counters.full_events <=
+         (counters.write_failures + counters.write_spins));
+  assert(counters.empty_events <=
+         (counters.read_failures + counters.read_spins));
+
+  /* Cleanup */
+  x9_free_inbox(inbox);
+
+  printf("TEST PASSED: x9_example_9.c\n");
+  return EXIT_SUCCESS;
+}
@@ -1,3 +1,5 @@
 #/bin/bash
 
-gcc -Wextra -Wall -Werror -pedantic -flto -O3 -march=native x9_profiler.c ../x9.c -o X9_PROF
+# Extra flags are forwarded to gcc, e.g. './compile_profiler.sh -D X9_STATS'
+CFLAGS="-Wextra -Wall -Werror -pedantic -flto -O3 -march=native${*:+ $*}"
+gcc $CFLAGS -D X9_PROF_CFLAGS="\"$CFLAGS\"" x9_profiler.c ../x9.c -o X9_PROF
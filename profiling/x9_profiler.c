@@ -10,27 +10,251 @@
  *
  *  '--test 1' uses 'x9_write_to_inbox_spin' and 'x9_read_from_inbox_spin'
  *  '--test 2' uses x9_read_from_inbox and 'x9_read_from_inbox'
+ *  '--test 3' bounces a message between two threads over a pair of inboxes
+ *  '--test 4' sweeps 1..P producers and 1..C consumers sharing one inbox
+ *  '--test 5' broadcasts to a node of 1..K inboxes, each with one consumer
+ *  '--test 6' fans in 1..K producers, one per inbox, into one consumer
+ *  '--test 7' chains 2..N stages with one inbox between each of them
+ *  '--test 8' publishes on a schedule (open-loop) at several offered loads
+ *  '--test 9' compares x9 with the reference queues of 'x9_ref_queues.h'
+ *
+ *  ┌────────┐       ┏━━━━━━━━┓       ┌────────┐
+ *  │        │──────▷┃  ping  ┃◁ ─ ─ ─│        │
+ *  │ Pinger │       ┗━━━━━━━━┛       │ Ponger │
+ *  │        │       ┏━━━━━━━━┓       │        │
+ *  │        │─ ─ ─ ▷┃  pong  ┃◁──────│        │
+ *  └────────┘       ┗━━━━━━━━┛       └────────┘
  *
  *  The advantage of '--test 2' is that, given its non spinning nature,
  *  it's possible to gather more performance metrics.
+ *  '--test 3' measures the round-trip latency of each message instead of the
+ *  throughput, using the TSC, and reports its distribution.
+ *  '--test 4' uses 'x9_write_to_inbox_spin' and
+ *  'x9_read_from_shared_inbox_spin' (as 'x9_example_5.c' and
+ *  'x9_example_6.c' do) and shows where the shared inbox stops scaling.
+ *  CAS failure rates are only available when compiled with 'X9_STATS'.
+ *
+ *  ┌────────┐       ┏━━━━━━━━┓       ┌────────┐       ┏━━━━━━━━┓
+ *  │Producer│──────▷┃ inbox  ┃◁ ─ ─ ─│ Stage  │──────▷┃ inbox  ┃◁ ─ ─ ...
+ *  └────────┘       ┗━━━━━━━━┛       └────────┘       ┗━━━━━━━━┛
+ *
+ *  Tests 5 to 7 have the shapes of 'x9_example_4.c', 'x9_example_3.c' and
+ *  'x9_example_2.c', the first 8 bytes of every message carry the TSC of when
+ *  it was sent, and the time it took to reach the last consumer(s) is
+ *  reported next to the throughput.
+ *  '--test 8' uses the same functions as '--test 1', but the producer sends
+ *  each message at its intended time (from '--rates' or replaying the gaps of
+ *  '--gaps_file'), even when behind schedule, and latency is measured from
+ *  then on, so queueing delay is not hidden by a stalled producer
+ *  (coordinated omission).
+ *  With '--trace_file' (captured with 'x9_trace_inbox' from x9.c compiled
+ *  with 'X9_TRACE'), '--test 8' replays the msgs of the trace and the gaps
+ *  between them, at their original pace or '--speedups' times faster.
+ *  '--test 9' runs the same producers and consumers, with the SPSC, MPSC,
+ *  SPMC and MPMC patterns, against a 'x9_inbox', a mutex + condition
+ *  variables queue, Lamport's SPSC ring buffer and Vyukov's MPMC ring buffer,
+ *  and reports their throughput and end-to-end latency side by side.
+ *
+ *  '--sweep_topology' replaces '--run_in_cores' (tests 1 to 3) with one pair
+ *  of cores of each relation found in the host (SMT siblings, sharing L2,
+ *  sharing L3, same package, different packages), and adds the round-trip
+ *  latency of each pair to the throughput.
+ *  '--hw_counters' counts cycles, instructions and L1D/LLC misses (and HITM
+ *  when a raw '--hitm_event' is given) in every thread with perf_event_open,
+ *  and reports them per message.
+ *  Cycles per message are measured with the TSC, which ticks at a constant
+ *  rate (when invariant), so they can be compared between hosts regardless
+ *  of turbo and frequency scaling.
+ *  '--sweep_msgs_szs' replaces '--msgs_szs' with the powers of 2 from 8B to
+ *  16KB, where copying the message and not the atomics dominates, and flags
+ *  the sizes at which a slot spans more than a cache line or a page, and the
+ *  inbox more than the L1D or L2 cache, to find where passing pointers to
+ *  large payloads starts paying off. Bandwidth (GB/s) is always reported
+ *  next to msgs/second.
+ *  '--format csv|json' emits every parameter, the value of each iteration
+ *  next to the median, and host metadata, instead of the table.
  */
 
 #define _GNU_SOURCE  /* cpu_*, pthread_setaffinity_np */
-#include <assert.h>  /* assert */
-#include <getopt.h>  /* required_argument, getopt_long */
-#include <pthread.h> /* pthread_t, pthread functions */
-#include <stdint.h>  /* uint8_t, uint64_t, int64_t */
-#include <stdio.h>   /* printf */
-#include <stdlib.h>  /* qsort, rand, RAND_MAX */
-#include <string.h>  /* memset, strcmp */
-#include <unistd.h>  /* sysconf, _SC_NPROCESSORS_ONLN */
+#include <assert.h>           /* assert */
+#include <cpuid.h>            /* __get_cpuid */
+#include <errno.h>            /* errno */
+#include <getopt.h>           /* required_argument, getopt_long */
+#include <linux/perf_event.h> /* perf_event_attr, PERF_* */
+#include <pthread.h>          /* pthread_t, pthread functions */
+#include <stdatomic.h>        /* atomic_* */
+#include <stdbool.h>          /* bool */
+#include <stdint.h>           /* uint8_t, uint64_t, int64_t */
+#include <stdio.h>            /* printf */
+#include <stdlib.h>           /* qsort, rand, RAND_MAX */
+#include <string.h>           /* memset, strcmp */
+#include <sys/syscall.h>      /* SYS_perf_event_open */
+#include <sys/utsname.h>      /* uname */
+#include <time.h>             /* clock_gettime, nanosleep */
+#include <unistd.h>           /* sysconf, _SC_NPROCESSORS_ONLN */
+#include <x86intrin.h>        /* __rdtsc */
 
 #include "../x9.h"
+#include "x9_ref_queues.h"
 
 typedef enum { HEADER = 1, SEPARATOR } stdout_output;
 
+typedef enum { TABLE = 1, CSV, JSON } output_format;
+
+/* Every value a test can report. */
+typedef enum {
+  TIME_SECS,
+  MSGS_PER_SEC,
+  BYTES_PER_SEC,
+  WRITER_HIT_RATIO,
+  READER_HIT_RATIO,
+  WRITER_TSC_PER_MSG,
+  READER_TSC_PER_MSG,
+  RTT_MIN_NS,
+  RTT_P50_NS,
+  RTT_P99_NS,
+  RTT_P999_NS,
+  RTT_MAX_NS,
+  E2E_P50_NS,
+  E2E_P90_NS,
+  E2E_P99_NS,
+  E2E_P999_NS,
+  E2E_P9999_NS,
+  E2E_MAX_NS,
+  WRITER_LATE_RATIO,
+  WRITER_FAIRNESS,
+  READER_FAIRNESS,
+  WRITER_CAS_FAILURE_RATIO,
+  READER_CAS_FAILURE_RATIO,
+  /* Same order as 'hw_counter' */
+  WRITER_CYCLES_PER_MSG,
+  WRITER_INSTRUCTIONS_PER_MSG,
+  WRITER_L1D_MISSES_PER_MSG,
+  WRITER_LLC_MISSES_PER_MSG,
+  WRITER_HITM_PER_MSG,
+  READER_CYCLES_PER_MSG,
+  READER_INSTRUCTIONS_PER_MSG,
+  READER_L1D_MISSES_PER_MSG,
+  READER_LLC_MISSES_PER_MSG,
+  READER_HITM_PER_MSG,
+  N_METRICS
+} metric_id;
+
+/* How a metric is shown in the table, csv and json always use raw values. */
+typedef enum {
+  SECONDS = 1,
+  MILLIONS,
+  GIGABYTES,
+  PERCENTAGE,
+  NANOSECONDS,
+  RATIO
+} metric_kind;
+
+typedef struct {
+  char const* key;    /* csv and json */
+  char const* header; /* table, its length is the width of the column */
+  metric_kind kind;
+} metric_desc;
+
+static metric_desc const metric_descs[N_METRICS] = {
+    [TIME_SECS]                   = {"time_secs", "Time (secs)", SECONDS},
+    [MSGS_PER_SEC]                = {"msgs_per_sec", "Msgs/second", MILLIONS},
+    [BYTES_PER_SEC]               = {"bytes_per_sec", "GB/second", GIGABYTES},
+    [WRITER_HIT_RATIO]            = {"writer_hit_ratio",
+                                     "Writer hit ratio", PERCENTAGE},
+    [READER_HIT_RATIO]            = {"reader_hit_ratio",
+                                     "Reader hit ratio", PERCENTAGE},
+    [WRITER_TSC_PER_MSG]          = {"writer_tsc_cycles_per_msg",
+                                     "W TSC cycles/msg", RATIO},
+    [READER_TSC_PER_MSG]          = {"reader_tsc_cycles_per_msg",
+                                     "R TSC cycles/msg", RATIO},
+    [RTT_MIN_NS]                  = {"rtt_min_ns", "Min (ns)", NANOSECONDS},
+    [RTT_P50_NS]                  = {"rtt_p50_ns", "p50 (ns)", NANOSECONDS},
+    [RTT_P99_NS]                  = {"rtt_p99_ns", "p99 (ns)", NANOSECONDS},
+    [RTT_P999_NS]                 = {"rtt_p999_ns", "p99.9 (ns)", NANOSECONDS},
+    [RTT_MAX_NS]                  = {"rtt_max_ns", "Max (ns)", NANOSECONDS},
+    [E2E_P50_NS]                  = {"e2e_p50_ns", "E2E p50 (ns)", NANOSECONDS},
+    [E2E_P90_NS]                  = {"e2e_p90_ns", "E2E p90 (ns)", NANOSECONDS},
+    [E2E_P99_NS]                  = {"e2e_p99_ns", "E2E p99 (ns)", NANOSECONDS},
+    [E2E_P999_NS]                 = {"e2e_p999_ns",
+                                     "E2E p99.9 (ns)", NANOSECONDS},
+    [E2E_P9999_NS]                = {"e2e_p9999_ns",
+                                     "E2E p99.99 (ns)", NANOSECONDS},
+    [E2E_MAX_NS]                  = {"e2e_max_ns", "E2E max (ns)", NANOSECONDS},
+    [WRITER_LATE_RATIO]           = {"writer_late_ratio",
+                                     "Late sends", PERCENTAGE},
+    [WRITER_FAIRNESS]             = {"writer_fairness",
+                                     "Writer fairness", RATIO},
+    [READER_FAIRNESS]             = {"reader_fairness",
+                                     "Reader fairness", RATIO},
+    [WRITER_CAS_FAILURE_RATIO]    = {"writer_cas_failures_per_msg",
+                                     "Writer CAS/msg", RATIO},
+    [READER_CAS_FAILURE_RATIO]    = {"reader_cas_failures_per_msg",
+                                     "Reader CAS/msg", RATIO},
+    [WRITER_CYCLES_PER_MSG]       = {"writer_cycles_per_msg",
+                                     "W cycles/msg", RATIO},
+    [WRITER_INSTRUCTIONS_PER_MSG] = {"writer_instructions_per_msg",
+                                     "W instrs/msg", RATIO},
+    [WRITER_L1D_MISSES_PER_MSG]   = {"writer_l1d_misses_per_msg",
+                                     "W L1D miss/msg", RATIO},
+    [WRITER_LLC_MISSES_PER_MSG]   = {"writer_llc_misses_per_msg",
+                                     "W LLC miss/msg", RATIO},
+    [WRITER_HITM_PER_MSG]         = {"writer_hitm_per_msg",
+                                     "W HITM/msg", RATIO},
+    [READER_CYCLES_PER_MSG]       = {"reader_cycles_per_msg",
+                                     "R cycles/msg", RATIO},
+    [READER_INSTRUCTIONS_PER_MSG] = {"reader_instructions_per_msg",
+                                     "R instrs/msg", RATIO},
+    [READER_L1D_MISSES_PER_MSG]   = {"reader_l1d_misses_per_msg",
+                                     "R L1D miss/msg", RATIO},
+    [READER_LLC_MISSES_PER_MSG]   = {"reader_llc_misses_per_msg",
+                                     "R LLC miss/msg", RATIO},
+    [READER_HITM_PER_MSG]         = {"reader_hitm_per_msg",
+                                     "R HITM/msg", RATIO},
+};
+
+/* Sizes past which copying a message costs more than moving its slot (cache
+ * line and page), or the whole inbox no longer fits in a cache level */
+typedef enum { CACHE_LINE, PAGE, L1D, L2, N_BOUNDARIES } boundary;
+
+typedef struct {
+  char const* key;   /* csv and json */
+  char const* label; /* table */
+} boundary_desc;
+
+static boundary_desc const boundary_descs[N_BOUNDARIES] = {
+    [CACHE_LINE] = {"cache_line", "CL"},
+    [PAGE]       = {"page", "page"},
+    [L1D]        = {"l1d", "L1D"},
+    [L2]         = {"l2", "L2"},
+};
+
+/* Hardware counters, opened per thread with 'perf_event_open' */
+typedef enum {
+  HW_CYCLES,
+  HW_INSTRUCTIONS,
+  HW_L1D_MISSES,
+  HW_LLC_MISSES,
+  HW_HITM,
+  N_HW_COUNTERS
+} hw_counter;
+
+typedef struct {
+  int    fds[N_HW_COUNTERS];
+  double values[N_HW_COUNTERS]; /* < 0 when not available */
+} hw_counters;
+
+/* Set by 'compile_profiler.sh' */
+#ifndef X9_PROF_CFLAGS
+#define X9_PROF_CFLAGS "unknown"
+#endif
+
 #define ARG(arg_name) (!strcmp(long_options[option_idx].name, arg_name))
 
+/* Inboxes of the node of '--test 5' and '--test 6', and of the pipeline of
+ * '--test 7'. 'x9_create_node' is always passed this many. */
+#define MAX_NODE_INBOXES 8
+
 typedef struct vector {
   uint64_t size;
   uint64_t used;
@@ -38,32 +262,211 @@ typedef struct vector {
 } vector;
 
 typedef struct {
-  vector* inboxes_sizes;
-  vector* msgs_sizes;
-  vector* run_in_cores;
-  int64_t n_messages;
-  int64_t n_iterations;
-  int64_t test;
+  vector*       inboxes_sizes;
+  vector*       msgs_sizes;
+  vector*       run_in_cores;
+  vector*       producers_cores;
+  vector*       consumers_cores;
+  vector*       stages_cores;
+  vector*       rates;    /* Offered loads of '--test 8', msgs per second */
+  double*       speedups; /* Or multiples of the pace of the gaps */
+  uint64_t      n_speedups;
+  double*       gaps_ns; /* Inter-arrival gaps of '--gaps_file' */
+  uint64_t      n_gaps;
+  double        mean_gap_ns;
+  uint8_t*      trace_msgs; /* Msgs of '--trace_file', one per gap */
+  uint64_t      trace_msg_sz;
+  int64_t       n_messages;
+  int64_t       n_iterations;
+  int64_t       test;
+  output_format format;
+  bool          hw_counters;
+  uint64_t      hitm_event; /* Raw event, 0 when not given */
+  bool          sweep_topology;
+  bool          sweep_msgs_sizes;
 } perf_config;
 
+/* How close two cores are, from closest to furthest */
+typedef enum {
+  SMT_SIBLINGS,
+  SHARED_L2,
+  SHARED_L3,
+  SAME_PACKAGE,
+  CROSS_SOCKET,
+  N_RELATIONS
+} core_relation;
+
+static char const* const relation_names[N_RELATIONS] = {
+    [SMT_SIBLINGS] = "SMT",
+    [SHARED_L2]    = "shared L2",
+    [SHARED_L3]    = "shared L3",
+    [SAME_PACKAGE] = "same package",
+    [CROSS_SOCKET] = "cross-socket",
+};
+
+typedef struct {
+  int64_t   package;
+  cpu_set_t smt;
+  cpu_set_t l2;
+  cpu_set_t l3;
+} cpu_topology;
+
+/* Writer and reader cores of a run */
+typedef struct {
+  char const* relation; /* NULL when not sweeping the topology */
+  int64_t     cores[2];
+} placement;
+
+typedef struct {
+  char   cpu_model[128];
+  char   governor[32];
+  char   kernel[256];
+  bool   invariant_tsc;
+  double tsc_ghz;
+  /* Of the core the (first) writer runs in, 0 when unknown */
+  uint64_t boundaries[N_BOUNDARIES];
+} host_info;
+
+/* One line of the table, the values of every iteration are kept so they can
+ * be emitted next to the median in csv and json. */
+typedef struct {
+  char const*    relation;
+  double         offered_rate; /* '--test 8' only */
+  char const*    queue;        /* '--test 9' only */
+  uint64_t       slot_sz;      /* Bytes between the slots of the inbox */
+  uint64_t       ibx_sz;
+  uint64_t       msg_sz;
+  uint64_t       n_writers;
+  int64_t const* writer_cores;
+  uint64_t       n_readers;
+  int64_t const* reader_cores;
+  double*        values[N_METRICS];
+} perf_row;
+
 typedef struct {
   double time_secs;
   double writer_hit_ratio;
   double reader_hit_ratio;
+  double writer_tsc_per_msg;
+  double reader_tsc_per_msg;
+  double rtt_min_ns;
+  double rtt_p50_ns;
+  double rtt_p99_ns;
+  double rtt_p999_ns;
+  double rtt_max_ns;
+  double e2e_p50_ns;
+  double e2e_p90_ns;
+  double e2e_p99_ns;
+  double e2e_p999_ns;
+  double e2e_p9999_ns;
+  double e2e_max_ns;
+  double writer_late_ratio; /* Msgs sent after their intended time */
+  double writer_fairness;
+  double reader_fairness;
+  double writer_cas_failure_ratio; /* CAS failures per msg */
+  double reader_cas_failure_ratio;
+  double writer_hw[N_HW_COUNTERS]; /* per msg, < 0 when not available */
+  double reader_hw[N_HW_COUNTERS];
 } perf_results;
 
+/* Queues compared by '--test 9', all of them wait until they can write/read */
+typedef struct {
+  char const* name;
+  bool        spsc_only;
+  void* (*create)(uint64_t const sz, uint64_t const msg_sz);
+  void (*write)(void* const q, uint64_t const msg_sz, void const* restrict msg);
+  void (*read)(void* const q, uint64_t const msg_sz, void* restrict outparam);
+  /* With more than one consumer, NULL when 'read' is already safe */
+  void (*shared_read)(void* const    q,
+                      uint64_t const msg_sz,
+                      void* restrict outparam);
+  void (*free)(void* const q);
+} queue_ops;
+
 typedef struct {
-  x9_inbox* inbox;
-  uint64_t  msg_sz;
-  uint64_t  n_msgs;
-  double    writer_hit_ratio;
-  double    reader_hit_ratio;
+  void* (*fn)(void*);
+  bool               count_hw;
+  uint64_t           hitm_event;
+  hw_counters        hw;
+  uint64_t           tsc_cycles;
+  x9_inbox*          inbox;
+  x9_inbox*          reply_inbox;
+  x9_inbox*          next_inbox; /* Next stage of '--test 7' */
+  x9_node*           node;
+  uint64_t           n_inboxes;
+  uint64_t*          rtt_cycles;
+  uint64_t*          e2e_cycles;
+  double const*      gap_cycles; /* Schedule of '--test 8' */
+  uint64_t           n_gaps;
+  uint8_t const*     trace_msgs; /* Sent instead of random msgs, if any */
+  uint64_t           late_msgs;
+  queue_ops const*   ops; /* '--test 9' */
+  void*              queue;
+  bool               shared;
+  uint64_t           msg_sz;
+  uint64_t           n_msgs;
+  double             writer_hit_ratio;
+  double             reader_hit_ratio;
+  uint64_t           msgs_read;
+  double             time_secs;
+  _Atomic(uint64_t)* total_msgs_read;
 } th_struct;
 
 typedef struct {
   uint8_t* a;
 } msg;
 
+static void* inbox_queue_create(uint64_t const sz, uint64_t const msg_sz) {
+  return x9_create_inbox(sz, "ibx_1", msg_sz);
+}
+
+static void inbox_queue_write(void* const          q,
+                              uint64_t const       msg_sz,
+                              void const* restrict msg) {
+  x9_write_to_inbox_spin((x9_inbox*)q, msg_sz, msg);
+}
+
+static void inbox_queue_read(void* const    q,
+                             uint64_t const msg_sz,
+                             void* restrict outparam) {
+  x9_read_from_inbox_spin((x9_inbox*)q, msg_sz, outparam);
+}
+
+static void inbox_queue_shared_read(void* const    q,
+                                    uint64_t const msg_sz,
+                                    void* restrict outparam) {
+  x9_read_from_shared_inbox_spin((x9_inbox*)q, msg_sz, outparam);
+}
+
+static void inbox_queue_free(void* const q) { x9_free_inbox((x9_inbox*)q); }
+
+static queue_ops const queues[] = {
+    {.name        = "x9",
+     .create      = inbox_queue_create,
+     .write       = inbox_queue_write,
+     .read        = inbox_queue_read,
+     .shared_read = inbox_queue_shared_read,
+     .free        = inbox_queue_free},
+    {.name   = "mutex+condvar",
+     .create = mutex_queue_create,
+     .write  = mutex_queue_write,
+     .read   = mutex_queue_read,
+     .free   = mutex_queue_free},
+    {.name      = "lamport",
+     .spsc_only = true,
+     .create    = lamport_queue_create,
+     .write     = lamport_queue_write,
+     .read      = lamport_queue_read,
+     .free      = lamport_queue_free},
+    {.name   = "vyukov",
+     .create = vyukov_queue_create,
+     .write  = vyukov_queue_write,
+     .read   = vyukov_queue_read,
+     .free   = vyukov_queue_free},
+};
+
+#define N_QUEUES (sizeof(queues) / sizeof(*queues))
+
 __attribute__((noreturn)) static void abort_test(char const* const msg) {
   printf("%s\n", msg);
   abort();
@@ -171,12 +574,453 @@ static void* consumer_fn_test_2(void* args) {
   return 0;
 }
 
+static void* pinger_fn_test_3(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  for (uint64_t k = 0; k != data->n_msgs; ++k) {
+    int32_t const random_val = random_int(1, 9);
+    memset(m.a, random_val, data->msg_sz);
+    uint64_t const tic = __rdtsc();
+    x9_write_to_inbox_spin(data->inbox, data->msg_sz, m.a);
+    x9_read_from_inbox_spin(data->reply_inbox, data->msg_sz, m.a);
+    data->rtt_cycles[k] = __rdtsc() - tic;
+    assert(m.a[(data->msg_sz - 1)] == random_val);
+  }
+  free(m.a);
+  return 0;
+}
+
+static void* ponger_fn_test_3(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  for (uint64_t k = 0; k != data->n_msgs; ++k) {
+    x9_read_from_inbox_spin(data->inbox, data->msg_sz, m.a);
+    assert(m.a[(data->msg_sz - 1)] == (m.a[0]));
+    x9_write_to_inbox_spin(data->reply_inbox, data->msg_sz, m.a);
+  }
+  free(m.a);
+  return 0;
+}
+
+static double elapsed_secs(struct timespec const* const tic,
+                           struct timespec const* const toc) {
+  return (double)(toc->tv_sec - tic->tv_sec) +
+         ((double)(toc->tv_nsec - tic->tv_nsec) / 1e9);
+}
+
+static void* producer_fn_test_4(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  struct timespec tic = {0};
+  clock_gettime(CLOCK_MONOTONIC, &tic);
+
+  for (uint64_t k = 0; k != data->n_msgs; ++k) {
+    int32_t const random_val = random_int(1, 9);
+    memset(m.a, random_val, data->msg_sz);
+    x9_write_to_inbox_spin(data->inbox, data->msg_sz, m.a);
+  }
+
+  struct timespec toc = {0};
+  clock_gettime(CLOCK_MONOTONIC, &toc);
+  data->time_secs = elapsed_secs(&tic, &toc);
+  free(m.a);
+  return 0;
+}
+
+static void* consumer_fn_test_4(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  for (;;) {
+    x9_read_from_shared_inbox_spin(data->inbox, data->msg_sz, m.a);
+    /* Poison pill, one per consumer is written once all producers are done.
+     * Given that spinning readers and writers skip busy slots, a pill can be
+     * read before messages written earlier, in which case it is written back
+     * so it's not lost for the other consumers. */
+    if (0 == m.a[0]) {
+      if (atomic_load(data->total_msgs_read) == data->n_msgs) { break; }
+      x9_write_to_inbox_spin(data->inbox, data->msg_sz, m.a);
+      continue;
+    }
+    assert(m.a[(data->msg_sz - 1)] == (m.a[0]));
+    atomic_fetch_add(data->total_msgs_read, 1);
+    ++data->msgs_read;
+  }
+  free(m.a);
+  return 0;
+}
+
+/* Tests 5 to 9 fill msgs with a random value and stamp them with 'tsc'. */
+static void fill_stamped_msg(msg const* const m,
+                             uint64_t const   msg_sz,
+                             uint64_t const   tsc) {
+  int32_t const random_val = random_int(1, 9);
+  memset(m->a, random_val, msg_sz);
+  memcpy(m->a, &tsc, sizeof(tsc));
+}
+
+/* TSC cycles since the stamp in the first 8 bytes of 'm'. */
+static uint64_t cycles_since_tsc(msg const* const m) {
+  uint64_t tsc = 0;
+  memcpy(&tsc, m->a, sizeof(tsc));
+  uint64_t const now = __rdtsc();
+  /* The TSCs of different cores can be slightly out of sync */
+  return (now > tsc) ? (now - tsc) : 0;
+}
+
+/* TSC cycles since 'm' was stamped by 'fill_stamped_msg'. */
+static uint64_t cycles_since_stamp(msg const* const m, uint64_t const msg_sz) {
+  assert((sizeof(uint64_t) == msg_sz) ||
+         (m->a[(msg_sz - 1)] == m->a[sizeof(uint64_t)]));
+  return cycles_since_tsc(m);
+}
+
+static void* producer_fn_test_5(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  for (uint64_t k = 0; k != data->n_msgs; ++k) {
+    fill_stamped_msg(&m, data->msg_sz, __rdtsc());
+    x9_broadcast_msg_to_all_node_inboxes(data->node, data->msg_sz, m.a);
+  }
+  free(m.a);
+  return 0;
+}
+
+/* Also the last stage of '--test 7' and the consumer of '--test 8' */
+static void* consumer_fn_test_5(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  for (uint64_t k = 0; k != data->n_msgs; ++k) {
+    x9_read_from_inbox_spin(data->inbox, data->msg_sz, m.a);
+    data->e2e_cycles[k] = cycles_since_stamp(&m, data->msg_sz);
+  }
+  free(m.a);
+  return 0;
+}
+
+static void* producer_fn_test_6(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  for (uint64_t k = 0; k != data->n_msgs; ++k) {
+    fill_stamped_msg(&m, data->msg_sz, __rdtsc());
+    while (!x9_write_to_inbox(data->inbox, data->msg_sz, m.a)) {}
+  }
+  free(m.a);
+  return 0;
+}
+
+static void* consumer_fn_test_6(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  x9_inbox* inboxes[MAX_NODE_INBOXES] = {0};
+  for (uint64_t k = 0; k != data->n_inboxes; ++k) {
+    char name[16] = {0};
+    snprintf(name, sizeof(name), "ibx_%lu", k);
+    inboxes[k] = x9_select_inbox_from_node(data->node, name);
+  }
+
+  /* Round-robin between the inboxes of all producers */
+  uint64_t msgs_read = 0;
+  for (uint64_t k = 0; msgs_read != data->n_msgs;
+       k = (k + 1) % data->n_inboxes) {
+    if (x9_read_from_inbox(inboxes[k], data->msg_sz, m.a)) {
+      data->e2e_cycles[msgs_read++] = cycles_since_stamp(&m, data->msg_sz);
+    }
+  }
+  free(m.a);
+  return 0;
+}
+
+static void* producer_fn_test_7(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  for (uint64_t k = 0; k != data->n_msgs; ++k) {
+    fill_stamped_msg(&m, data->msg_sz, __rdtsc());
+    x9_write_to_inbox_spin(data->inbox, data->msg_sz, m.a);
+  }
+  free(m.a);
+  return 0;
+}
+
+static void* producer_fn_test_8(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  double intended = (double)__rdtsc();
+  for (uint64_t k = 0; k != data->n_msgs; ++k) {
+    intended += data->gap_cycles[k % data->n_gaps];
+    uint64_t const send_at = (uint64_t)intended;
+
+    /* Never waits to catch up, the msg keeps its intended time */
+    if (__rdtsc() >= send_at) {
+      ++data->late_msgs;
+    } else {
+      while (__rdtsc() < send_at) { _mm_pause(); }
+    }
+    if (data->trace_msgs) {
+      /* The msg that was captured along with the gap */
+      memcpy(m.a, &data->trace_msgs[(k % data->n_gaps) * data->msg_sz],
+             data->msg_sz);
+      memcpy(m.a, &send_at, sizeof(send_at));
+    } else {
+      fill_stamped_msg(&m, data->msg_sz, send_at);
+    }
+    x9_write_to_inbox_spin(data->inbox, data->msg_sz, m.a);
+  }
+  free(m.a);
+  return 0;
+}
+
+/* Consumer of '--test 8' when replaying a '--trace_file', whose msgs don't
+ * have the pattern of 'fill_stamped_msg' after the stamp. */
+static void* consumer_fn_replay(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  for (uint64_t k = 0; k != data->n_msgs; ++k) {
+    x9_read_from_inbox_spin(data->inbox, data->msg_sz, m.a);
+    data->e2e_cycles[k] = cycles_since_tsc(&m);
+  }
+  free(m.a);
+  return 0;
+}
+
+static void* relay_fn_test_7(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  for (uint64_t k = 0; k != data->n_msgs; ++k) {
+    x9_read_from_inbox_spin(data->inbox, data->msg_sz, m.a);
+    x9_write_to_inbox_spin(data->next_inbox, data->msg_sz, m.a);
+  }
+  free(m.a);
+  return 0;
+}
+
+static void* producer_fn_test_9(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  for (uint64_t k = 0; k != data->n_msgs; ++k) {
+    fill_stamped_msg(&m, data->msg_sz, __rdtsc());
+    data->ops->write(data->queue, data->msg_sz, m.a);
+  }
+  free(m.a);
+  return 0;
+}
+
+static void* consumer_fn_test_9(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  msg m = {.a = calloc(data->msg_sz, sizeof(uint8_t))};
+  if (NULL == m.a) { abort_test("ERROR: failed to allocate msg buffer"); }
+
+  void (*const read)(void* const, uint64_t const, void* restrict) =
+      (data->shared && data->ops->shared_read) ? data->ops->shared_read
+                                               : data->ops->read;
+  for (;;) {
+    read(data->queue, data->msg_sz, m.a);
+    /* Poison pill (a TSC of 0), as in 'consumer_fn_test_4' */
+    uint64_t tsc = 0;
+    memcpy(&tsc, m.a, sizeof(tsc));
+    if (!tsc) {
+      if (atomic_load(data->total_msgs_read) == data->n_msgs) { break; }
+      data->ops->write(data->queue, data->msg_sz, m.a);
+      continue;
+    }
+    data->e2e_cycles[data->msgs_read++] = cycles_since_stamp(&m, data->msg_sz);
+    atomic_fetch_add(data->total_msgs_read, 1);
+  }
+  free(m.a);
+  return 0;
+}
+
+/* Jain's fairness index: 1 when all 'vals' are equal, 1/sz when a single
+ * one got everything. */
+static double fairness_index(uint64_t const sz, double const* const vals) {
+  double sum    = 0;
+  double sum_sq = 0;
+  for (uint64_t k = 0; k != sz; ++k) {
+    sum += vals[k];
+    sum_sq += vals[k] * vals[k];
+  }
+  return (sum_sq > 0) ? (sum * sum) / ((double)sz * sum_sq) : 0;
+}
+
+/* CPUID.80000007H:EDX[8], the TSC ticks at a constant rate in all ACPI P-,
+ * C- and T-states. */
+static bool tsc_is_invariant(void) {
+  uint32_t eax = 0;
+  uint32_t ebx = 0;
+  uint32_t ecx = 0;
+  uint32_t edx = 0;
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) { return false; }
+  return edx & (1U << 8);
+}
+
+static int cmp_u64(const void* a, const void* b) {
+  return (*(const uint64_t*)a > *(const uint64_t*)b)   ? 1
+         : (*(const uint64_t*)a < *(const uint64_t*)b) ? -1
+                                                       : 0;
+}
+
+/* Nearest-rank percentile, 'arr' must be sorted. */
+static uint64_t percentile(uint64_t const        sz,
+                           uint64_t const* const arr,
+                           double const          p) {
+  uint64_t rank = (uint64_t)((p / 100.0) * (double)sz + 0.999999);
+  if (!rank) { rank = 1; }
+  return arr[(rank > sz ? sz : rank) - 1];
+}
+
+/* Sorts the end-to-end latencies of tests 5 to 8 and fills 'results'. */
+static void e2e_percentiles(uint64_t const      sz,
+                            uint64_t* const     e2e_cycles,
+                            double const        ns_per_cycle,
+                            perf_results* const results) {
+  qsort(e2e_cycles, sz, sizeof(uint64_t), cmp_u64);
+  results->e2e_p50_ns =
+      (double)percentile(sz, e2e_cycles, 50) * ns_per_cycle;
+  results->e2e_p90_ns =
+      (double)percentile(sz, e2e_cycles, 90) * ns_per_cycle;
+  results->e2e_p99_ns =
+      (double)percentile(sz, e2e_cycles, 99) * ns_per_cycle;
+  results->e2e_p999_ns =
+      (double)percentile(sz, e2e_cycles, 99.9) * ns_per_cycle;
+  results->e2e_p9999_ns =
+      (double)percentile(sz, e2e_cycles, 99.99) * ns_per_cycle;
+  results->e2e_max_ns = (double)e2e_cycles[sz - 1] * ns_per_cycle;
+}
+
+static int hw_counter_open(uint32_t const type, uint64_t const config) {
+  struct perf_event_attr attr = {0};
+  attr.size                   = sizeof(attr);
+  attr.type                   = type;
+  attr.config                 = config;
+  attr.exclude_kernel         = 1;
+  attr.exclude_hv             = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  /* Calling thread, any cpu */
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+                      PERF_FLAG_FD_CLOEXEC);
+}
+
+static uint64_t hw_cache_event(uint64_t const cache) {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+static void hw_counters_open(hw_counters* const hw, uint64_t const hitm_event) {
+  hw->fds[HW_CYCLES] =
+      hw_counter_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  hw->fds[HW_INSTRUCTIONS] =
+      hw_counter_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  hw->fds[HW_L1D_MISSES] = hw_counter_open(
+      PERF_TYPE_HW_CACHE, hw_cache_event(PERF_COUNT_HW_CACHE_L1D));
+  hw->fds[HW_LLC_MISSES] = hw_counter_open(
+      PERF_TYPE_HW_CACHE, hw_cache_event(PERF_COUNT_HW_CACHE_LL));
+  /* There's no generic HITM event, its encoding is model specific */
+  hw->fds[HW_HITM] =
+      hitm_event ? hw_counter_open(PERF_TYPE_RAW, hitm_event) : -1;
+}
+
+static void hw_counters_close(hw_counters* const hw) {
+  for (uint64_t k = 0; k != N_HW_COUNTERS; ++k) {
+    hw->values[k] = -1;
+    if (hw->fds[k] < 0) { continue; }
+
+    uint64_t data[3] = {0}; /* value, time enabled, time running */
+    if ((sizeof(data) == read(hw->fds[k], data, sizeof(data))) && data[2]) {
+      /* Scaled in case counters were multiplexed */
+      hw->values[k] = (double)data[0] * ((double)data[1] / (double)data[2]);
+    }
+    close(hw->fds[k]);
+  }
+}
+
+/* Runs 'fn' of the thread, measuring the TSC cycles it takes and counting
+ * hardware events if requested. */
+static void* run_counted(void* args) {
+  th_struct* data = (th_struct*)args;
+
+  if (data->count_hw) { hw_counters_open(&data->hw, data->hitm_event); }
+  uint64_t const tic = __rdtsc();
+  data->fn(args);
+  data->tsc_cycles = __rdtsc() - tic;
+  if (data->count_hw) { hw_counters_close(&data->hw); }
+  return 0;
+}
+
+/* TSC cycles all 'n' threads took, per msg. */
+static double tsc_cycles_per_msg(uint64_t const         n,
+                                 th_struct const* const structs,
+                                 uint64_t const         n_msgs) {
+  double cycles = 0;
+  for (uint64_t k = 0; k != n; ++k) { cycles += (double)structs[k].tsc_cycles; }
+  return cycles / (double)n_msgs;
+}
+
+/* Adds the hardware counters of 'n' threads, per msg, into 'out'. */
+static void hw_counters_per_msg(uint64_t const         n,
+                                th_struct const* const structs,
+                                uint64_t const         n_msgs,
+                                double* const          out) {
+  for (uint64_t c = 0; c != N_HW_COUNTERS; ++c) {
+    out[c] = 0;
+    for (uint64_t k = 0; k != n; ++k) {
+      if (!structs[k].count_hw || (structs[k].hw.values[c] < 0)) {
+        out[c] = -1;
+        break;
+      }
+      out[c] += structs[k].hw.values[c] / (double)n_msgs;
+    }
+  }
+}
+
 static perf_results run_test(uint64_t const ibx_sz,
                              uint64_t const msg_sz,
                              uint64_t const n_msgs,
                              uint64_t const first_core,
                              uint64_t const second_core,
-                             uint64_t const test
+                             uint64_t const test,
+                             double const   ns_per_cycle,
+                             perf_config const* const config
 
 ) {
   /* Create inbox */
@@ -187,19 +1031,42 @@ static perf_results run_test(uint64_t const ibx_sz,
     abort_test("ERROR: x9_inbox is invalid");
   }
 
+  /* Reply inbox and round-trip times ('--test 3' only) */
+  x9_inbox* reply_inbox = NULL;
+  uint64_t* rtt_cycles  = NULL;
+  if (3 == test) {
+    reply_inbox = x9_create_inbox(ibx_sz, "ibx_2", msg_sz);
+    if (!(x9_inbox_is_valid(reply_inbox))) {
+      abort_test("ERROR: x9_inbox is invalid");
+    }
+    rtt_cycles = calloc(n_msgs, sizeof(uint64_t));
+    if (NULL == rtt_cycles) {
+      abort_test("ERROR: failed to allocate 'rtt_cycles'");
+    }
+  }
+
   /* Producer */
   pthread_t      producer_th   = {0};
   pthread_attr_t producer_attr = {0};
   pthread_attr_init(&producer_attr);
-  th_struct producer_struct = {
-      .inbox = inbox, .msg_sz = msg_sz, .n_msgs = n_msgs};
+  th_struct producer_struct = {.count_hw    = config->hw_counters,
+                               .hitm_event  = config->hitm_event,
+                               .inbox       = inbox,
+                               .reply_inbox = reply_inbox,
+                               .rtt_cycles  = rtt_cycles,
+                               .msg_sz      = msg_sz,
+                               .n_msgs      = n_msgs};
 
   /* Consumer */
   pthread_t      consumer_th   = {0};
   pthread_attr_t consumer_attr = {0};
   pthread_attr_init(&consumer_attr);
-  th_struct consumer_struct = {
-      .inbox = inbox, .msg_sz = msg_sz, .n_msgs = n_msgs};
+  th_struct consumer_struct = {.count_hw    = config->hw_counters,
+                               .hitm_event  = config->hitm_event,
+                               .inbox       = inbox,
+                               .reply_inbox = reply_inbox,
+                               .msg_sz      = msg_sz,
+                               .n_msgs      = n_msgs};
 
   /* Set affinity */
   cpu_set_t f_core = {0};
@@ -219,39 +1086,651 @@ static perf_results run_test(uint64_t const ibx_sz,
 
   /* Launch threads */
   if (1 == test) {
-    pthread_create(&consumer_th, &consumer_attr, consumer_fn_test_1,
-                   &consumer_struct);
-    pthread_create(&producer_th, &producer_attr, producer_fn_test_1,
-                   &producer_struct);
+    consumer_struct.fn = consumer_fn_test_1;
+    producer_struct.fn = producer_fn_test_1;
+  } else if (2 == test) {
+    consumer_struct.fn = consumer_fn_test_2;
+    producer_struct.fn = producer_fn_test_2;
+  } else {
+    consumer_struct.fn = ponger_fn_test_3;
+    producer_struct.fn = pinger_fn_test_3;
+  }
+  pthread_create(&consumer_th, &consumer_attr, run_counted, &consumer_struct);
+  pthread_create(&producer_th, &producer_attr, run_counted, &producer_struct);
+
+  /* Join them */
+  pthread_join(consumer_th, NULL);
+  pthread_join(producer_th, NULL);
+
+  /* Stop timer */
+  struct timespec toc = {0};
+  clock_gettime(CLOCK_MONOTONIC, &toc);
+
+  uint64_t const before =
+      ((uint64_t)tic.tv_sec * 1000000000UL) + (uint64_t)tic.tv_nsec;
+  uint64_t const after =
+      ((uint64_t)toc.tv_sec * 1000000000UL) + (uint64_t)toc.tv_nsec;
+
+  /* Cleanup */
+  pthread_attr_destroy(&producer_attr);
+  pthread_attr_destroy(&consumer_attr);
+  x9_free_inbox(inbox);
+
+  perf_results results = {.time_secs = (double)(after - before) / 1e9,
+                          .writer_hit_ratio = producer_struct.writer_hit_ratio,
+                          .reader_hit_ratio = consumer_struct.reader_hit_ratio};
+
+  results.writer_tsc_per_msg = tsc_cycles_per_msg(1, &producer_struct, n_msgs);
+  results.reader_tsc_per_msg = tsc_cycles_per_msg(1, &consumer_struct, n_msgs);
+  hw_counters_per_msg(1, &producer_struct, n_msgs, results.writer_hw);
+  hw_counters_per_msg(1, &consumer_struct, n_msgs, results.reader_hw);
+
+  if (3 == test) {
+    qsort(rtt_cycles, n_msgs, sizeof(uint64_t), cmp_u64);
+    results.rtt_min_ns = (double)rtt_cycles[0] * ns_per_cycle;
+    results.rtt_p50_ns =
+        (double)percentile(n_msgs, rtt_cycles, 50) * ns_per_cycle;
+    results.rtt_p99_ns =
+        (double)percentile(n_msgs, rtt_cycles, 99) * ns_per_cycle;
+    results.rtt_p999_ns =
+        (double)percentile(n_msgs, rtt_cycles, 99.9) * ns_per_cycle;
+    results.rtt_max_ns = (double)rtt_cycles[n_msgs - 1] * ns_per_cycle;
+    x9_free_inbox(reply_inbox);
+    free(rtt_cycles);
+  }
+  return results;
+}
+
+static perf_results run_scaling_test(uint64_t const           ibx_sz,
+                                     uint64_t const           msg_sz,
+                                     uint64_t const           n_msgs,
+                                     uint64_t const           n_producers,
+                                     uint64_t const           n_consumers,
+                                     perf_config const* const config) {
+  /* Create inbox */
+  x9_inbox* const inbox = x9_create_inbox(ibx_sz, "ibx_1", msg_sz);
 
+  /* Confirm that it's valid */
+  if (!(x9_inbox_is_valid(inbox))) {
+    abort_test("ERROR: x9_inbox is invalid");
+  }
+
+  uint64_t const n_threads = n_producers + n_consumers;
+
+  pthread_t*      threads = calloc(n_threads, sizeof(pthread_t));
+  th_struct*      structs = calloc(n_threads, sizeof(th_struct));
+  pthread_attr_t* attrs   = calloc(n_threads, sizeof(pthread_attr_t));
+  double*         shares  = calloc(n_threads, sizeof(double));
+  if ((NULL == threads) || (NULL == structs) || (NULL == attrs) ||
+      (NULL == shares)) {
+    abort_test("ERROR: failed to allocate threads");
+  }
+
+  _Atomic(uint64_t) total_msgs_read = 0;
+
+  /* Producers come first, and split 'n_msgs' between them */
+  for (uint64_t k = 0; k != n_threads; ++k) {
+    bool const    is_producer = k < n_producers;
+    int64_t const core =
+        is_producer ? config->producers_cores->data[k]
+                    : config->consumers_cores->data[k - n_producers];
+
+    cpu_set_t cpu = {0};
+    CPU_ZERO(&cpu);
+    CPU_SET((uint64_t)core, &cpu);
+    pthread_attr_init(&attrs[k]);
+    pthread_attr_setaffinity_np(&attrs[k], sizeof(cpu_set_t), &cpu);
+
+    structs[k] = (th_struct){.fn = is_producer ? producer_fn_test_4
+                                               : consumer_fn_test_4,
+                             .count_hw        = config->hw_counters,
+                             .hitm_event      = config->hitm_event,
+                             .inbox           = inbox,
+                             .msg_sz          = msg_sz,
+                             .n_msgs          = n_msgs,
+                             .total_msgs_read = &total_msgs_read};
+    if (is_producer) {
+      structs[k].n_msgs =
+          (n_msgs / n_producers) + ((k < (n_msgs % n_producers)) ? 1 : 0);
+    }
+  }
+
+  /* Start timer */
+  struct timespec tic = {0};
+  clock_gettime(CLOCK_MONOTONIC, &tic);
+
+  /* Launch threads */
+  for (uint64_t k = n_producers; k != n_threads; ++k) {
+    pthread_create(&threads[k], &attrs[k], run_counted, &structs[k]);
+  }
+  for (uint64_t k = 0; k != n_producers; ++k) {
+    pthread_create(&threads[k], &attrs[k], run_counted, &structs[k]);
+  }
+
+  /* Join producers, then stop the consumers */
+  for (uint64_t k = 0; k != n_producers; ++k) {
+    pthread_join(threads[k], NULL);
+  }
+
+  uint8_t* const poison_pill = calloc(msg_sz, sizeof(uint8_t));
+  if (NULL == poison_pill) { abort_test("ERROR: failed to allocate msg"); }
+  for (uint64_t k = 0; k != n_consumers; ++k) {
+    x9_write_to_inbox_spin(inbox, msg_sz, poison_pill);
+  }
+
+  for (uint64_t k = n_producers; k != n_threads; ++k) {
+    pthread_join(threads[k], NULL);
+  }
+
+  /* Stop timer */
+  struct timespec toc = {0};
+  clock_gettime(CLOCK_MONOTONIC, &toc);
+
+  perf_results results = {.time_secs = elapsed_secs(&tic, &toc),
+                          .writer_cas_failure_ratio = -1,
+                          .reader_cas_failure_ratio = -1};
+
+  /* Producers: msgs/sec of each one, consumers: share of msgs read */
+  uint64_t msgs_read = 0;
+  for (uint64_t k = 0; k != n_threads; ++k) {
+    if (k < n_producers) {
+      shares[k] = (double)structs[k].n_msgs / structs[k].time_secs;
+    } else {
+      shares[k] = (double)structs[k].msgs_read;
+      msgs_read += structs[k].msgs_read;
+    }
+  }
+  if (msgs_read != n_msgs) { abort_test("ERROR: messages were lost"); }
+
+  results.writer_tsc_per_msg =
+      tsc_cycles_per_msg(n_producers, structs, n_msgs);
+  results.reader_tsc_per_msg =
+      tsc_cycles_per_msg(n_consumers, structs + n_producers, n_msgs);
+  hw_counters_per_msg(n_producers, structs, n_msgs, results.writer_hw);
+  hw_counters_per_msg(n_consumers, structs + n_producers, n_msgs,
+                      results.reader_hw);
+
+  results.writer_fairness = fairness_index(n_producers, shares);
+  results.reader_fairness = fairness_index(n_consumers, shares + n_producers);
+
+  x9_inbox_counters counters = {0};
+  if (x9_inbox_stats(inbox, &counters)) {
+    results.writer_cas_failure_ratio =
+        (double)counters.write_cas_failures / (double)counters.writes;
+    results.reader_cas_failure_ratio =
+        (double)counters.read_cas_failures / (double)counters.reads;
+  }
+
+  /* Cleanup */
+  for (uint64_t k = 0; k != n_threads; ++k) {
+    pthread_attr_destroy(&attrs[k]);
+  }
+  free(poison_pill);
+  free(shares);
+  free(attrs);
+  free(structs);
+  free(threads);
+  x9_free_inbox(inbox);
+
+  return results;
+}
+
+/* '--test 5' broadcasts to 'fan' consumers, '--test 6' fans in 'fan'
+ * producers and '--test 7' chains 'fan' inboxes between 'fan' + 1 stages. */
+static perf_results run_node_test(uint64_t const           ibx_sz,
+                                  uint64_t const           msg_sz,
+                                  uint64_t const           n_msgs,
+                                  uint64_t const           fan,
+                                  double const             ns_per_cycle,
+                                  perf_config const* const config) {
+  /* Create inboxes */
+  x9_inbox* inboxes[MAX_NODE_INBOXES] = {0};
+  for (uint64_t k = 0; k != fan; ++k) {
+    char name[16] = {0};
+    snprintf(name, sizeof(name), "ibx_%lu", k);
+    inboxes[k] = x9_create_inbox(ibx_sz, name, msg_sz);
+    if (!(x9_inbox_is_valid(inboxes[k]))) {
+      abort_test("ERROR: x9_inbox is invalid");
+    }
+  }
+
+  /* Only the first 'fan' inboxes are attached */
+  x9_node* node = NULL;
+  if (7 != config->test) {
+    node = x9_create_node("node", fan, inboxes[0], inboxes[1], inboxes[2],
+                          inboxes[3], inboxes[4], inboxes[5], inboxes[6],
+                          inboxes[7]);
+    if (!(x9_node_is_valid(node))) { abort_test("ERROR: x9_node is invalid"); }
+  }
+
+  /* Threads that only write come first */
+  uint64_t const n_threads = fan + 1;
+  uint64_t const n_writers = (6 == config->test) ? fan : 1;
+  uint64_t const n_samples = (5 == config->test) ? fan * n_msgs : n_msgs;
+
+  pthread_t*      threads    = calloc(n_threads, sizeof(pthread_t));
+  th_struct*      structs    = calloc(n_threads, sizeof(th_struct));
+  pthread_attr_t* attrs      = calloc(n_threads, sizeof(pthread_attr_t));
+  uint64_t*       e2e_cycles = calloc(n_samples, sizeof(uint64_t));
+  if ((NULL == threads) || (NULL == structs) || (NULL == attrs) ||
+      (NULL == e2e_cycles)) {
+    abort_test("ERROR: failed to allocate threads");
+  }
+
+  for (uint64_t k = 0; k != n_threads; ++k) {
+    th_struct* const s = &structs[k];
+    *s                 = (th_struct){.count_hw   = config->hw_counters,
+                                     .hitm_event = config->hitm_event,
+                                     .node       = node,
+                                     .n_inboxes  = fan,
+                                     .msg_sz     = msg_sz,
+                                     .n_msgs     = n_msgs};
+
+    int64_t core = 0;
+    if (5 == config->test) {
+      if (!k) {
+        core  = config->producers_cores->data[0];
+        s->fn = producer_fn_test_5;
+      } else {
+        core          = config->consumers_cores->data[k - 1];
+        s->fn         = consumer_fn_test_5;
+        s->inbox      = inboxes[k - 1];
+        s->e2e_cycles = e2e_cycles + ((k - 1) * n_msgs);
+      }
+    } else if (6 == config->test) {
+      if (k != fan) {
+        core      = config->producers_cores->data[k];
+        s->fn     = producer_fn_test_6;
+        s->inbox  = inboxes[k];
+        s->n_msgs = (n_msgs / fan) + ((k < (n_msgs % fan)) ? 1 : 0);
+      } else {
+        core          = config->consumers_cores->data[0];
+        s->fn         = consumer_fn_test_6;
+        s->e2e_cycles = e2e_cycles;
+      }
+    } else {
+      core = config->stages_cores->data[k];
+      if (!k) {
+        s->fn    = producer_fn_test_7;
+        s->inbox = inboxes[0];
+      } else if (k != fan) {
+        s->fn         = relay_fn_test_7;
+        s->inbox      = inboxes[k - 1];
+        s->next_inbox = inboxes[k];
+      } else {
+        s->fn         = consumer_fn_test_5;
+        s->inbox      = inboxes[k - 1];
+        s->e2e_cycles = e2e_cycles;
+      }
+    }
+
+    cpu_set_t cpu = {0};
+    CPU_ZERO(&cpu);
+    CPU_SET((uint64_t)core, &cpu);
+    pthread_attr_init(&attrs[k]);
+    pthread_attr_setaffinity_np(&attrs[k], sizeof(cpu_set_t), &cpu);
+  }
+
+  /* Start timer */
+  struct timespec tic = {0};
+  clock_gettime(CLOCK_MONOTONIC, &tic);
+
+  /* Launch threads */
+  for (uint64_t k = n_writers; k != n_threads; ++k) {
+    pthread_create(&threads[k], &attrs[k], run_counted, &structs[k]);
+  }
+  for (uint64_t k = 0; k != n_writers; ++k) {
+    pthread_create(&threads[k], &attrs[k], run_counted, &structs[k]);
+  }
+
+  /* Join them */
+  for (uint64_t k = 0; k != n_threads; ++k) { pthread_join(threads[k], NULL); }
+
+  /* Stop timer */
+  struct timespec toc = {0};
+  clock_gettime(CLOCK_MONOTONIC, &toc);
+
+  perf_results results = {.time_secs = elapsed_secs(&tic, &toc)};
+  e2e_percentiles(n_samples, e2e_cycles, ns_per_cycle, &results);
+  hw_counters_per_msg(n_writers, structs, n_msgs, results.writer_hw);
+  hw_counters_per_msg(n_threads - n_writers, structs + n_writers, n_msgs,
+                      results.reader_hw);
+
+  /* Cleanup */
+  for (uint64_t k = 0; k != n_threads; ++k) {
+    pthread_attr_destroy(&attrs[k]);
+  }
+  free(e2e_cycles);
+  free(attrs);
+  free(structs);
+  free(threads);
+  if (NULL != node) {
+    x9_free_node_and_attached_inboxes(node);
   } else {
-    pthread_create(&consumer_th, &consumer_attr, consumer_fn_test_2,
-                   &consumer_struct);
-    pthread_create(&producer_th, &producer_attr, producer_fn_test_2,
-                   &producer_struct);
+    for (uint64_t k = 0; k != fan; ++k) { x9_free_inbox(inboxes[k]); }
   }
 
+  return results;
+}
+
+/* '--test 8' at an 'offered_rate' (msgs per second), with the gaps of
+ * '--gaps_file' (or '--trace_file') scaled to it, if given. */
+static perf_results run_open_loop_test(uint64_t const           ibx_sz,
+                                       uint64_t const           msg_sz,
+                                       uint64_t const           n_msgs,
+                                       uint64_t const           first_core,
+                                       uint64_t const           second_core,
+                                       double const             offered_rate,
+                                       double const             ns_per_cycle,
+                                       perf_config const* const config) {
+  /* Create inbox */
+  x9_inbox* const inbox = x9_create_inbox(ibx_sz, "ibx_1", msg_sz);
+
+  /* Confirm that it's valid */
+  if (!(x9_inbox_is_valid(inbox))) {
+    abort_test("ERROR: x9_inbox is invalid");
+  }
+
+  /* Schedule, in TSC cycles between msgs */
+  double const   gap_ns = 1e9 / offered_rate;
+  uint64_t const n_gaps = config->gaps_ns ? config->n_gaps : 1;
+  double* const  gaps   = calloc(n_gaps, sizeof(double));
+  if (NULL == gaps) { abort_test("ERROR: failed to allocate 'gaps'"); }
+  for (uint64_t k = 0; k != n_gaps; ++k) {
+    gaps[k] = config->gaps_ns
+                  ? config->gaps_ns[k] * (gap_ns / config->mean_gap_ns)
+                  : gap_ns;
+    gaps[k] /= ns_per_cycle;
+  }
+
+  uint64_t* const e2e_cycles = calloc(n_msgs, sizeof(uint64_t));
+  if (NULL == e2e_cycles) {
+    abort_test("ERROR: failed to allocate 'e2e_cycles'");
+  }
+
+  /* Producer */
+  pthread_t      producer_th   = {0};
+  pthread_attr_t producer_attr = {0};
+  pthread_attr_init(&producer_attr);
+  th_struct producer_struct = {.fn         = producer_fn_test_8,
+                               .count_hw   = config->hw_counters,
+                               .hitm_event = config->hitm_event,
+                               .inbox      = inbox,
+                               .gap_cycles = gaps,
+                               .n_gaps     = n_gaps,
+                               .trace_msgs = config->trace_msgs,
+                               .msg_sz     = msg_sz,
+                               .n_msgs     = n_msgs};
+
+  /* Consumer */
+  pthread_t      consumer_th   = {0};
+  pthread_attr_t consumer_attr = {0};
+  pthread_attr_init(&consumer_attr);
+  th_struct consumer_struct = {.fn         = config->trace_msgs
+                                                 ? consumer_fn_replay
+                                                 : consumer_fn_test_5,
+                               .count_hw   = config->hw_counters,
+                               .hitm_event = config->hitm_event,
+                               .inbox      = inbox,
+                               .e2e_cycles = e2e_cycles,
+                               .msg_sz     = msg_sz,
+                               .n_msgs     = n_msgs};
+
+  /* Set affinity */
+  cpu_set_t f_core = {0};
+  CPU_ZERO(&f_core);
+  CPU_SET(first_core, &f_core);
+
+  cpu_set_t s_core = {0};
+  CPU_ZERO(&s_core);
+  CPU_SET(second_core, &s_core);
+
+  pthread_attr_setaffinity_np(&producer_attr, sizeof(cpu_set_t), &f_core);
+  pthread_attr_setaffinity_np(&consumer_attr, sizeof(cpu_set_t), &s_core);
+
+  /* Start timer */
+  struct timespec tic = {0};
+  clock_gettime(CLOCK_MONOTONIC, &tic);
+
+  /* Launch threads */
+  pthread_create(&consumer_th, &consumer_attr, run_counted, &consumer_struct);
+  pthread_create(&producer_th, &producer_attr, run_counted, &producer_struct);
+
   /* Join them */
   pthread_join(consumer_th, NULL);
   pthread_join(producer_th, NULL);
 
-  /* Stop timer */
-  struct timespec toc = {0};
-  clock_gettime(CLOCK_MONOTONIC, &toc);
+  /* Stop timer */
+  struct timespec toc = {0};
+  clock_gettime(CLOCK_MONOTONIC, &toc);
+
+  perf_results results = {
+      .time_secs         = elapsed_secs(&tic, &toc),
+      .writer_late_ratio = (double)producer_struct.late_msgs / (double)n_msgs};
+  e2e_percentiles(n_msgs, e2e_cycles, ns_per_cycle, &results);
+  hw_counters_per_msg(1, &producer_struct, n_msgs, results.writer_hw);
+  hw_counters_per_msg(1, &consumer_struct, n_msgs, results.reader_hw);
+
+  /* Cleanup */
+  pthread_attr_destroy(&producer_attr);
+  pthread_attr_destroy(&consumer_attr);
+  free(e2e_cycles);
+  free(gaps);
+  x9_free_inbox(inbox);
+
+  return results;
+}
+
+/* '--test 9', the same producers and consumers as '--test 4' (using stamped
+ * msgs), writing to and reading from any of the 'queues'. */
+static perf_results run_comparison_test(uint64_t const           ibx_sz,
+                                        uint64_t const           msg_sz,
+                                        uint64_t const           n_msgs,
+                                        uint64_t const           n_producers,
+                                        uint64_t const           n_consumers,
+                                        queue_ops const* const   ops,
+                                        double const             ns_per_cycle,
+                                        perf_config const* const config) {
+  void* const queue = ops->create(ibx_sz, msg_sz);
+  if (NULL == queue) { abort_test("ERROR: failed to create queue"); }
+
+  uint64_t const n_threads = n_producers + n_consumers;
+
+  pthread_t*      threads = calloc(n_threads, sizeof(pthread_t));
+  th_struct*      structs = calloc(n_threads, sizeof(th_struct));
+  pthread_attr_t* attrs   = calloc(n_threads, sizeof(pthread_attr_t));
+  /* Each consumer can read up to 'n_msgs' */
+  uint64_t* e2e_cycles = calloc(n_consumers * n_msgs, sizeof(uint64_t));
+  if ((NULL == threads) || (NULL == structs) || (NULL == attrs) ||
+      (NULL == e2e_cycles)) {
+    abort_test("ERROR: failed to allocate threads");
+  }
+
+  _Atomic(uint64_t) total_msgs_read = 0;
+
+  /* Producers come first, and split 'n_msgs' between them */
+  for (uint64_t k = 0; k != n_threads; ++k) {
+    bool const    is_producer = k < n_producers;
+    int64_t const core =
+        is_producer ? config->producers_cores->data[k]
+                    : config->consumers_cores->data[k - n_producers];
+
+    cpu_set_t cpu = {0};
+    CPU_ZERO(&cpu);
+    CPU_SET((uint64_t)core, &cpu);
+    pthread_attr_init(&attrs[k]);
+    pthread_attr_setaffinity_np(&attrs[k], sizeof(cpu_set_t), &cpu);
+
+    structs[k] = (th_struct){.fn = is_producer ? producer_fn_test_9
+                                               : consumer_fn_test_9,
+                             .count_hw        = config->hw_counters,
+                             .hitm_event      = config->hitm_event,
+                             .ops             = ops,
+                             .queue           = queue,
+                             .shared          = n_consumers > 1,
+                             .msg_sz          = msg_sz,
+                             .n_msgs          = n_msgs,
+                             .total_msgs_read = &total_msgs_read};
+    if (is_producer) {
+      structs[k].n_msgs =
+          (n_msgs / n_producers) + ((k < (n_msgs % n_producers)) ? 1 : 0);
+    } else {
+      structs[k].e2e_cycles = e2e_cycles + ((k - n_producers) * n_msgs);
+    }
+  }
+
+  /* Start timer */
+  struct timespec tic = {0};
+  clock_gettime(CLOCK_MONOTONIC, &tic);
+
+  /* Launch threads */
+  for (uint64_t k = n_producers; k != n_threads; ++k) {
+    pthread_create(&threads[k], &attrs[k], run_counted, &structs[k]);
+  }
+  for (uint64_t k = 0; k != n_producers; ++k) {
+    pthread_create(&threads[k], &attrs[k], run_counted, &structs[k]);
+  }
+
+  /* Join producers, then stop the consumers */
+  for (uint64_t k = 0; k != n_producers; ++k) {
+    pthread_join(threads[k], NULL);
+  }
+
+  uint8_t* const poison_pill = calloc(msg_sz, sizeof(uint8_t));
+  if (NULL == poison_pill) { abort_test("ERROR: failed to allocate msg"); }
+  for (uint64_t k = 0; k != n_consumers; ++k) {
+    ops->write(queue, msg_sz, poison_pill);
+  }
+
+  for (uint64_t k = n_producers; k != n_threads; ++k) {
+    pthread_join(threads[k], NULL);
+  }
+
+  /* Stop timer */
+  struct timespec toc = {0};
+  clock_gettime(CLOCK_MONOTONIC, &toc);
+
+  /* Latencies of all consumers, one after the other */
+  uint64_t msgs_read = 0;
+  for (uint64_t k = n_producers; k != n_threads; ++k) {
+    memmove(e2e_cycles + msgs_read, structs[k].e2e_cycles,
+            structs[k].msgs_read * sizeof(uint64_t));
+    msgs_read += structs[k].msgs_read;
+  }
+  if (msgs_read != n_msgs) { abort_test("ERROR: messages were lost"); }
+
+  perf_results results = {.time_secs = elapsed_secs(&tic, &toc)};
+  e2e_percentiles(n_msgs, e2e_cycles, ns_per_cycle, &results);
+  hw_counters_per_msg(n_producers, structs, n_msgs, results.writer_hw);
+  hw_counters_per_msg(n_consumers, structs + n_producers, n_msgs,
+                      results.reader_hw);
+
+  /* Cleanup */
+  for (uint64_t k = 0; k != n_threads; ++k) {
+    pthread_attr_destroy(&attrs[k]);
+  }
+  free(poison_pill);
+  free(e2e_cycles);
+  free(attrs);
+  free(structs);
+  free(threads);
+  ops->free(queue);
+
+  return results;
+}
+
+/* Reads one inter-arrival gap (in nanoseconds) per line, lines that are not
+ * a number are skipped. */
+static void read_gaps_file(char const* const path, perf_config* const config) {
+  FILE* const f = fopen(path, "r");
+  if (NULL == f) { abort_test("ERROR: failed to open '--gaps_file'"); }
+
+  uint64_t size = 1024;
+  double*  gaps = calloc(size, sizeof(double));
+  if (NULL == gaps) { abort_test("ERROR: failed to allocate 'gaps'"); }
+
+  uint64_t n         = 0;
+  double   sum       = 0;
+  char     line[128] = {0};
+  while (fgets(line, sizeof(line), f)) {
+    char*        end = NULL;
+    double const gap = strtod(line, &end);
+    if ((end == line) || (gap < 0)) { continue; }
+    if (n == size) {
+      size *= 2;
+      gaps = realloc(gaps, size * sizeof(double));
+      if (NULL == gaps) { abort_test("ERROR: realloc failed."); }
+    }
+    gaps[n++] = gap;
+    sum += gap;
+  }
+  fclose(f);
+
+  if (!(sum > 0)) {
+    abort_test("ERROR: '--gaps_file' requires at least one gap > 0");
+  }
+  config->gaps_ns     = gaps;
+  config->n_gaps      = n;
+  config->mean_gap_ns = sum / (double)n;
+}
+
+/* Reads a trace written by 'x9_trace_inbox' (see 'x9_trace_header'), and
+ * keeps its msgs and the gaps between them (in nanoseconds of the host that
+ * recorded it), which '--test 8' replays. */
+static void read_trace_file(char const* const path, perf_config* const config) {
+  FILE* const f = fopen(path, "rb");
+  if (NULL == f) { abort_test("ERROR: failed to open '--trace_file'"); }
+
+  x9_trace_header header = {0};
+  if ((1 != fread(&header, sizeof(x9_trace_header), 1, f)) ||
+      memcmp(header.magic, X9_TRACE_MAGIC, sizeof(X9_TRACE_MAGIC)) ||
+      (X9_TRACE_VERSION != header.version) || !header.msg_sz ||
+      !(header.ns_per_cycle > 0)) {
+    abort_test("ERROR: '--trace_file' is not a x9 trace");
+  }
+
+  /* 'n_msgs' is only filled when the trace was stopped */
+  uint64_t const record_sz = sizeof(uint64_t) + header.msg_sz;
+  if (fseek(f, 0, SEEK_END)) { abort_test("ERROR: failed to read trace"); }
+  uint64_t const n =
+      ((uint64_t)ftell(f) - sizeof(x9_trace_header)) / record_sz;
+  if (fseek(f, sizeof(x9_trace_header), SEEK_SET)) {
+    abort_test("ERROR: failed to read trace");
+  }
 
-  uint64_t const before =
-      ((uint64_t)tic.tv_sec * 1000000000UL) + (uint64_t)tic.tv_nsec;
-  uint64_t const after =
-      ((uint64_t)toc.tv_sec * 1000000000UL) + (uint64_t)toc.tv_nsec;
+  double*  gaps = calloc(n ? n : 1, sizeof(double));
+  uint8_t* msgs = calloc(n ? n : 1, header.msg_sz);
+  if ((NULL == gaps) || (NULL == msgs)) {
+    abort_test("ERROR: failed to allocate trace");
+  }
 
-  /* Cleanup */
-  pthread_attr_destroy(&producer_attr);
-  pthread_attr_destroy(&consumer_attr);
-  x9_free_inbox(inbox);
+  double   sum      = 0;
+  uint64_t prev_tsc = 0;
+  for (uint64_t k = 0; k != n; ++k) {
+    uint64_t tsc = 0;
+    if ((1 != fread(&tsc, sizeof(uint64_t), 1, f)) ||
+        (1 != fread(&msgs[k * header.msg_sz], header.msg_sz, 1, f))) {
+      abort_test("ERROR: failed to read trace");
+    }
+    /* Writers on different cores may record slightly out of order */
+    if (k && (tsc > prev_tsc)) {
+      gaps[k] = (double)(tsc - prev_tsc) * header.ns_per_cycle;
+    }
+    if (tsc > prev_tsc) { prev_tsc = tsc; }
+    sum += gaps[k];
+  }
+  fclose(f);
 
-  return (perf_results){.time_secs        = (double)(after - before) / 1e9,
-                        .writer_hit_ratio = producer_struct.writer_hit_ratio,
-                        .reader_hit_ratio = consumer_struct.reader_hit_ratio};
+  if (!(sum > 0)) {
+    abort_test(
+        "ERROR: '--trace_file' requires at least two msgs published at "
+        "different times");
+  }
+  config->gaps_ns      = gaps;
+  config->n_gaps       = n;
+  config->mean_gap_ns  = sum / (double)n;
+  config->trace_msgs   = msgs;
+  config->trace_msg_sz = header.msg_sz;
 }
 
 static void parse_array_arguments(char* restrict const args,
@@ -271,11 +1750,44 @@ static void parse_array_arguments(char* restrict const args,
   }
 }
 
+/* Same as 'parse_array_arguments' for fractional values, e.g. '--speedups
+ * 0.5,1.5', which are written to a new array. Returns their number. */
+static uint64_t parse_double_array_arguments(char* restrict const args,
+                                             double** const write_to) {
+  char*             args_start = args;
+  char const* const args_end   = args + strlen(args);
+
+  uint64_t n = 1;
+  for (char const* c = args; c != args_end; ++c) { n += (',' == *c); }
+  double* const values = calloc(n, sizeof(double));
+  if (NULL == values) { abort_test("ERROR: failed to allocate 'values'"); }
+
+  uint64_t used = 0;
+  for (; args_start < args_end;) {
+    char* begin = args_start;
+    char* end   = args_start;
+    for (; end != args_end; ++end) {
+      if (',' == *end) { break; }
+    }
+    args_start     = end + 1;
+    values[used++] = strtod(begin, &end);
+  }
+  *write_to = values;
+  return used;
+}
+
+/* Tests 4 to 7 and 9 take the cores of each thread instead of
+ * '--run_in_cores' */
+static bool uses_core_lists(perf_config const* const config) {
+  return ((config->test >= 4) && (config->test <= 7)) || (9 == config->test);
+}
+
 static perf_config* parse_command_line_args(int argc, char** argv) {
   perf_config* config = calloc(1, sizeof(perf_config));
   if (NULL == config) {
     abort_test("ERROR: failed to allocate 'perf_config'");
   }
+  config->format = TABLE;
 
   for (;;) {
     int                  option_idx     = 0;
@@ -286,6 +1798,18 @@ static perf_config* parse_command_line_args(int argc, char** argv) {
         {"n_its", required_argument, 0, 0},
         {"run_in_cores", required_argument, 0, 0},
         {"test", required_argument, 0, 0},
+        {"producers", required_argument, 0, 0},
+        {"consumers", required_argument, 0, 0},
+        {"stages", required_argument, 0, 0},
+        {"rates", required_argument, 0, 0},
+        {"gaps_file", required_argument, 0, 0},
+        {"trace_file", required_argument, 0, 0},
+        {"speedups", required_argument, 0, 0},
+        {"format", required_argument, 0, 0},
+        {"hw_counters", no_argument, 0, 0},
+        {"sweep_topology", no_argument, 0, 0},
+        {"sweep_msgs_szs", no_argument, 0, 0},
+        {"hitm_event", required_argument, 0, 0},
         {0, 0, 0, 0}
 
     };
@@ -356,6 +1880,98 @@ static perf_config* parse_command_line_args(int argc, char** argv) {
           }
         }
 
+        if (ARG("producers") || ARG("consumers") || ARG("stages")) {
+          vector* const cores = vector_init(8);
+          parse_array_arguments(optarg, cores);
+
+          int64_t const n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+          for (uint64_t k = 0; k != cores->used; ++k) {
+            if ((cores->data[k] < 0) || (cores->data[k] >= n_cores)) {
+              char abort_msg[128] = {0};
+              sprintf(abort_msg,
+                      "ERROR: '--producers', '--consumers' and '--stages' "
+                      "values must be between 0 and %ld",
+                      n_cores - 1);
+              abort_test(abort_msg);
+            }
+          }
+
+          if (ARG("producers")) {
+            config->producers_cores = cores;
+          } else if (ARG("consumers")) {
+            config->consumers_cores = cores;
+          } else {
+            config->stages_cores = cores;
+          }
+        }
+
+        if (ARG("rates")) {
+          config->rates = vector_init(8);
+          parse_array_arguments(optarg, config->rates);
+
+          for (uint64_t k = 0; k != config->rates->used; ++k) {
+            if (!(config->rates->data[k] > 0)) {
+              abort_test("ERROR: '--rates' values must be > 0");
+            }
+          }
+        }
+
+        if (ARG("speedups")) {
+          free(config->speedups);
+          config->n_speedups =
+              parse_double_array_arguments(optarg, &config->speedups);
+
+          for (uint64_t k = 0; k != config->n_speedups; ++k) {
+            if (!(config->speedups[k] > 0)) {
+              abort_test("ERROR: '--speedups' values must be > 0");
+            }
+          }
+        }
+
+        if (ARG("gaps_file") || ARG("trace_file")) {
+          if (config->gaps_ns) {
+            abort_test(
+                "ERROR: '--gaps_file' and '--trace_file' can not be used "
+                "together.");
+          }
+          if (ARG("gaps_file")) {
+            read_gaps_file(optarg, config);
+          } else {
+            read_trace_file(optarg, config);
+          }
+        }
+
+        if (ARG("format")) {
+          if (!strcmp(optarg, "table")) {
+            config->format = TABLE;
+          } else if (!strcmp(optarg, "csv")) {
+            config->format = CSV;
+          } else if (!strcmp(optarg, "json")) {
+            config->format = JSON;
+          } else {
+            abort_test(
+                "ERROR: '--format' value must be either 'table', 'csv' or "
+                "'json'");
+          }
+        }
+
+        if (ARG("hw_counters")) { config->hw_counters = true; }
+
+        if (ARG("sweep_topology")) { config->sweep_topology = true; }
+
+        if (ARG("sweep_msgs_szs")) { config->sweep_msgs_sizes = true; }
+
+        if (ARG("hitm_event")) {
+          char*          end = NULL;
+          uint64_t const n   = strtoull(optarg, &end, 0);
+          if (!n || *end) {
+            abort_test("ERROR: '--hitm_event' value must be a raw event");
+          }
+          config->hitm_event  = n;
+          config->hw_counters = true;
+        }
+
         if (ARG("n_msgs")) {
           int64_t const n = atoll(optarg);
           if (!(n > 0)) { abort_test("ERROR: '--n_msgs' value must be > 0"); }
@@ -370,24 +1986,115 @@ static perf_config* parse_command_line_args(int argc, char** argv) {
 
         if (ARG("test")) {
           int64_t n = atoll(optarg);
-          if (!((n > 0) && (n < 3))) {
-            abort_test("ERROR: '--test' value must be either '1' or '2'");
+          if (!((n > 0) && (n < 10))) {
+            abort_test("ERROR: '--test' value must be between '1' and '9'");
           }
           config->test = n;
         }
     }
   }
 
+  /* The msgs of a trace set the msg size, and are replayed with their first
+   * 8 bytes overwritten with the TSC stamp */
+  if (config->trace_msgs) {
+    if (config->msgs_sizes || config->sweep_msgs_sizes) {
+      abort_test(
+          "ERROR: '--trace_file' can not be used with '--msgs_szs' or "
+          "'--sweep_msgs_szs'.");
+    }
+    config->msgs_sizes = vector_init(2);
+    vector_insert(config->msgs_sizes, (int64_t)config->trace_msg_sz);
+  }
+
+  /* Powers of 2 from 8B (the smallest msg of tests 5 to 9) to 16KB */
+  if (config->sweep_msgs_sizes) {
+    if (config->msgs_sizes) {
+      abort_test(
+          "ERROR: '--sweep_msgs_szs' can not be used with '--msgs_szs'.");
+    }
+    config->msgs_sizes = vector_init(16);
+    for (int64_t n = 8; n <= (16 * 1024); n *= 2) {
+      vector_insert(config->msgs_sizes, n);
+    }
+  }
+
   if (!config->test || !config->inboxes_sizes || !config->msgs_sizes ||
-      !config->n_messages || !config->n_iterations || !config->run_in_cores) {
+      !config->n_messages || !config->n_iterations) {
+    abort_test("ERROR: missing command line arguments.");
+  }
+
+  if ((config->test >= 4) && config->sweep_topology) {
+    abort_test("ERROR: '--sweep_topology' can only be used with tests 1 to 3");
+  }
+
+  /* Msgs of tests 5 to 9 carry the TSC of when they were (meant to be) sent */
+  for (uint64_t k = 0; k != config->msgs_sizes->used; ++k) {
+    if ((config->test >= 5) &&
+        (config->msgs_sizes->data[k] < (int64_t)sizeof(uint64_t))) {
+      abort_test("ERROR: tests 5 to 9 require '--msgs_szs' values >= 8");
+    }
+  }
+
+  if ((8 == config->test) && !config->rates && !config->gaps_ns) {
+    abort_test(
+        "ERROR: '--test 8' requires '--rates', '--gaps_file' or "
+        "'--trace_file'.");
+  }
+
+  if (config->speedups && (config->rates || !config->gaps_ns)) {
+    abort_test(
+        "ERROR: '--speedups' requires '--gaps_file' or '--trace_file', and "
+        "can not be used with '--rates'.");
+  }
+
+  if (uses_core_lists(config)) {
+    if (7 == config->test) {
+      if (!config->stages_cores || (config->stages_cores->used < 2) ||
+          (config->stages_cores->used > (MAX_NODE_INBOXES + 1))) {
+        abort_test("ERROR: '--test 7' requires '--stages' with 2 to 9 cores.");
+      }
+    } else if (!config->producers_cores || !config->consumers_cores) {
+      abort_test(
+          "ERROR: tests 4 to 6 and 9 require '--producers' and "
+          "'--consumers'.");
+    }
+    if ((5 == config->test) &&
+        ((config->producers_cores->used != 1) ||
+         (config->consumers_cores->used > MAX_NODE_INBOXES))) {
+      abort_test(
+          "ERROR: '--test 5' requires one '--producers' core and up to 8 "
+          "'--consumers' cores.");
+    }
+    if ((6 == config->test) &&
+        ((config->consumers_cores->used != 1) ||
+         (config->producers_cores->used > MAX_NODE_INBOXES))) {
+      abort_test(
+          "ERROR: '--test 6' requires up to 8 '--producers' cores and one "
+          "'--consumers' core.");
+    }
+    /* The reference queues index their slots with a mask */
+    for (uint64_t k = 0; k != config->inboxes_sizes->used; ++k) {
+      int64_t const n = config->inboxes_sizes->data[k];
+      if ((9 == config->test) && (n & (n - 1))) {
+        abort_test("ERROR: '--test 9' requires '--inboxes_szs' powers of 2");
+      }
+    }
+    return config;
+  }
+
+  /* Cores are chosen from the topology, and are never equal */
+  if (config->sweep_topology) { return config; }
+
+  if (!config->run_in_cores) {
     abort_test("ERROR: missing command line arguments.");
   }
 
-  if (1 == config->test) {
+  if ((1 == config->test) || (3 == config->test) || (8 == config->test)) {
     if (config->run_in_cores->data[0] == config->run_in_cores->data[1]) {
       abort_test(
-          "ERROR: for '--test 1' the values of '--run_in_cores' can not be "
-          "equal because there's no sched_yield())'");
+          "ERROR: for '--test 1', '--test 3' and '--test 8' the values of "
+          "'--run_in_cores' can not be equal because there's no "
+          "sched_yield())'");
     }
   }
   return config;
@@ -396,53 +2103,716 @@ static perf_config* parse_command_line_args(int argc, char** argv) {
 static void free_perf_config(perf_config* config) {
   vector_free(config->inboxes_sizes);
   vector_free(config->msgs_sizes);
-  vector_free(config->run_in_cores);
+  if (config->run_in_cores) { vector_free(config->run_in_cores); }
+  if (config->producers_cores) { vector_free(config->producers_cores); }
+  if (config->consumers_cores) { vector_free(config->consumers_cores); }
+  if (config->stages_cores) { vector_free(config->stages_cores); }
+  if (config->rates) { vector_free(config->rates); }
+  free(config->speedups);
+  free(config->gaps_ns);
+  free(config->trace_msgs);
   free(config);
 }
 
+static int cmp(const void* a, const void* b) {
+  return (*(const double*)a > *(const double*)b)   ? 1
+         : (*(const double*)a < *(const double*)b) ? -1
+                                                   : 0;
+}
+
+static double calculate_median(uint64_t const sz, double* const arr) {
+  qsort(arr, sz, sizeof(double), cmp);
+  return ((sz % 2) == 0) ? ((arr[sz / 2 - 1] + arr[sz / 2]) / 2) : arr[sz / 2];
+}
+
+static void print_escaped(output_format const format, char const* str) {
+  if (CSV == format) {
+    putchar('"');
+    for (; *str; ++str) {
+      if ('"' == *str) { putchar('"'); }
+      putchar(*str);
+    }
+    putchar('"');
+  } else {
+    putchar('"');
+    for (; *str; ++str) {
+      if (('"' == *str) || ('\\' == *str)) {
+        printf("\\%c", *str);
+      } else if ((unsigned char)*str < 0x20) {
+        printf("\\u%04x", *str);
+      } else {
+        putchar(*str);
+      }
+    }
+    putchar('"');
+  }
+}
+
+static void print_cores(output_format const  format,
+                        uint64_t const       n,
+                        int64_t const* const cores) {
+  if (JSON == format) { putchar('['); }
+  for (uint64_t k = 0; k != n; ++k) {
+    if (k) { putchar((JSON == format) ? ',' : ';'); }
+    printf("%ld", cores[k]);
+  }
+  if (JSON == format) { putchar(']'); }
+}
+
+static void print_table_cell(metric_id const m, double const value) {
+  int const width = (int)strlen(metric_descs[m].header);
+  switch (metric_descs[m].kind) {
+    case SECONDS:
+      value > 1 ? printf("%*.2f", width, value) : printf("%*.4f", width, value);
+      break;
+    case MILLIONS:
+      printf("%*.2fM", width - 1, value / 1e6);
+      break;
+    case GIGABYTES:
+      printf("%*.2f", width, value / 1e9);
+      break;
+    case PERCENTAGE:
+      printf("%*.2f%%", width - 1, value * 100);
+      break;
+    case NANOSECONDS:
+      printf("%*.0f", width, value);
+      break;
+    case RATIO:
+      value < 0 ? printf("%*s", width, "n/a") : printf("%*.3f", width, value);
+      break;
+  }
+}
+
+static bool read_sys_file(char const* const path,
+                          char* const       buf,
+                          int const         sz) {
+  FILE* const f = fopen(path, "r");
+  if (NULL == f) { return false; }
+  bool const ok = (NULL != fgets(buf, sz, f));
+  fclose(f);
+  if (ok) { buf[strcspn(buf, "\n")] = '\0'; }
+  return ok;
+}
+
+/* Parses lists as in '/sys/devices/system/cpu/online', e.g. "0-3,8,10-11" */
+static void parse_cpu_list(char const* list, cpu_set_t* const set) {
+  CPU_ZERO(set);
+  for (;;) {
+    char*      end   = NULL;
+    long const first = strtol(list, &end, 10);
+    if (end == list) { break; }
+    long last = first;
+    if ('-' == *end) { last = strtol(end + 1, &end, 10); }
+    for (long cpu = first; (cpu <= last) && (cpu < CPU_SETSIZE); ++cpu) {
+      CPU_SET((uint64_t)cpu, set);
+    }
+    if (',' != *end) { break; }
+    list = end + 1;
+  }
+}
+
+static void read_cpu_topology(int64_t const cpu, cpu_topology* const topo) {
+  char path[128] = {0};
+  char buf[256]  = {0};
+
+  topo->package = -1;
+  snprintf(path, sizeof(path),
+           "/sys/devices/system/cpu/cpu%ld/topology/physical_package_id", cpu);
+  if (read_sys_file(path, buf, sizeof(buf))) { topo->package = atoll(buf); }
+
+  CPU_ZERO(&topo->smt);
+  snprintf(path, sizeof(path),
+           "/sys/devices/system/cpu/cpu%ld/topology/thread_siblings_list",
+           cpu);
+  if (read_sys_file(path, buf, sizeof(buf))) {
+    parse_cpu_list(buf, &topo->smt);
+  }
+
+  CPU_ZERO(&topo->l2);
+  CPU_ZERO(&topo->l3);
+  for (uint64_t idx = 0;; ++idx) {
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%ld/cache/index%lu/level", cpu, idx);
+    if (!read_sys_file(path, buf, sizeof(buf))) { break; }
+    int64_t const level = atoll(buf);
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%ld/cache/index%lu/type", cpu, idx);
+    if (!read_sys_file(path, buf, sizeof(buf)) ||
+        !strcmp(buf, "Instruction")) {
+      continue;
+    }
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%ld/cache/index%lu/shared_cpu_list",
+             cpu, idx);
+    if (!read_sys_file(path, buf, sizeof(buf))) { continue; }
+    if (2 == level) { parse_cpu_list(buf, &topo->l2); }
+    if (3 == level) { parse_cpu_list(buf, &topo->l3); }
+  }
+}
+
+static core_relation relation_of(cpu_topology const* const a,
+                                 int64_t const             b_cpu,
+                                 cpu_topology const* const b) {
+  if (CPU_ISSET((uint64_t)b_cpu, &a->smt)) { return SMT_SIBLINGS; }
+  if (CPU_ISSET((uint64_t)b_cpu, &a->l2)) { return SHARED_L2; }
+  if (CPU_ISSET((uint64_t)b_cpu, &a->l3)) { return SHARED_L3; }
+  if (a->package == b->package) { return SAME_PACKAGE; }
+  return CROSS_SOCKET;
+}
+
+/* Picks one pair of online cores of each relation found, avoiding core 0
+ * (which usually handles more interrupts) when possible.
+ * Returns the number of 'placements' (N_RELATIONS long) filled. */
+static uint64_t pick_topology_placements(placement* const placements) {
+  char      buf[256] = {0};
+  cpu_set_t online   = {0};
+  if (!read_sys_file("/sys/devices/system/cpu/online", buf, sizeof(buf))) {
+    abort_test("ERROR: failed to read '/sys/devices/system/cpu/online'");
+  }
+  parse_cpu_list(buf, &online);
+
+  cpu_topology* const topo = calloc(CPU_SETSIZE, sizeof(cpu_topology));
+  if (NULL == topo) { abort_test("ERROR: failed to allocate 'topo'"); }
+  for (int64_t cpu = 0; cpu != CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET((uint64_t)cpu, &online)) {
+      read_cpu_topology(cpu, &topo[cpu]);
+    }
+  }
+
+  bool found[N_RELATIONS] = {0};
+  for (int64_t first = 1; first >= 0; --first) {
+    for (int64_t a = first; a != CPU_SETSIZE; ++a) {
+      if (!CPU_ISSET((uint64_t)a, &online)) { continue; }
+      for (int64_t b = a + 1; b != CPU_SETSIZE; ++b) {
+        if (!CPU_ISSET((uint64_t)b, &online)) { continue; }
+        core_relation const r = relation_of(&topo[a], b, &topo[b]);
+        if (!found[r]) {
+          found[r]      = true;
+          placements[r] = (placement){.relation = relation_names[r],
+                                      .cores    = {a, b}};
+        }
+      }
+    }
+  }
+  free(topo);
+
+  /* Closest first */
+  uint64_t n = 0;
+  for (uint64_t r = 0; r != N_RELATIONS; ++r) {
+    if (found[r]) { placements[n++] = placements[r]; }
+  }
+  if (!n) {
+    abort_test("ERROR: '--sweep_topology' requires at least two online cores");
+  }
+  return n;
+}
+
+static void read_host_info(int64_t const core, host_info* const host) {
+  snprintf(host->cpu_model, sizeof(host->cpu_model), "unknown");
+  snprintf(host->governor, sizeof(host->governor), "unknown");
+  snprintf(host->kernel, sizeof(host->kernel), "unknown");
+
+  char  line[256] = {0};
+  FILE* f         = fopen("/proc/cpuinfo", "r");
+  if (NULL != f) {
+    while (fgets(line, sizeof(line), f)) {
+      char const* const colon = strchr(line, ':');
+      if (!strncmp(line, "model name", 10) && (NULL != colon)) {
+        snprintf(host->cpu_model, sizeof(host->cpu_model), "%s", colon + 2);
+        host->cpu_model[strcspn(host->cpu_model, "\n")] = '\0';
+        break;
+      }
+    }
+    fclose(f);
+  }
+
+  /* Governor of the core the (first) writer runs in */
+  char path[128] = {0};
+  snprintf(path, sizeof(path),
+           "/sys/devices/system/cpu/cpu%ld/cpufreq/scaling_governor", core);
+  read_sys_file(path, host->governor, sizeof(host->governor));
+
+  struct utsname uts = {0};
+  if (!uname(&uts)) {
+    snprintf(host->kernel, sizeof(host->kernel), "%s %s", uts.sysname,
+             uts.release);
+  }
+
+  host->boundaries[PAGE] = (uint64_t)sysconf(_SC_PAGESIZE);
+
+  char buf[32] = {0};
+  for (uint64_t idx = 0;; ++idx) {
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%ld/cache/index%lu/level", core, idx);
+    if (!read_sys_file(path, buf, sizeof(buf))) { break; }
+    int64_t const level = atoll(buf);
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%ld/cache/index%lu/type", core, idx);
+    if (!read_sys_file(path, buf, sizeof(buf)) ||
+        !strcmp(buf, "Instruction")) {
+      continue;
+    }
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%ld/cache/index%lu/"
+             "coherency_line_size",
+             core, idx);
+    if ((1 == level) && read_sys_file(path, buf, sizeof(buf))) {
+      host->boundaries[CACHE_LINE] = (uint64_t)atoll(buf);
+    }
+
+    /* e.g. "48K" */
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%ld/cache/index%lu/size", core, idx);
+    if (!read_sys_file(path, buf, sizeof(buf))) { continue; }
+    char*    unit = NULL;
+    uint64_t sz   = strtoull(buf, &unit, 10);
+    if ('K' == *unit) { sz *= 1024; }
+    if ('M' == *unit) { sz *= 1024 * 1024; }
+    if (1 == level) { host->boundaries[L1D] = sz; }
+    if (2 == level) { host->boundaries[L2] = sz; }
+  }
+  if (!host->boundaries[CACHE_LINE]) { host->boundaries[CACHE_LINE] = 64; }
+}
+
+/* Bit 'b' is set when a slot ('CACHE_LINE', 'PAGE'), or all the slots of the
+ * inbox ('L1D', 'L2'), of 'row' span more than 'boundaries[b]' bytes. */
+static uint64_t exceeded_boundaries(host_info const* const host,
+                                    perf_row const* const  row) {
+  uint64_t exceeded = 0;
+  for (uint64_t b = 0; b != N_BOUNDARIES; ++b) {
+    uint64_t const bytes =
+        (b < L1D) ? row->slot_sz : (row->slot_sz * row->ibx_sz);
+    if (host->boundaries[b] && (bytes > host->boundaries[b])) {
+      exceeded |= UINT64_C(1) << b;
+    }
+  }
+  return exceeded;
+}
+
+/* Fills 'metrics' (N_METRICS long) with the ones reported by the test. */
+static uint64_t test_metrics(perf_config const* const config,
+                             metric_id* const         metrics) {
+  static metric_id const test_1[] = {TIME_SECS, MSGS_PER_SEC, BYTES_PER_SEC,
+                                     WRITER_TSC_PER_MSG, READER_TSC_PER_MSG};
+  static metric_id const test_2[] = {
+      TIME_SECS,          MSGS_PER_SEC,       BYTES_PER_SEC,
+      WRITER_TSC_PER_MSG, READER_TSC_PER_MSG, WRITER_HIT_RATIO,
+      READER_HIT_RATIO};
+  static metric_id const test_3[] = {RTT_MIN_NS, RTT_P50_NS, RTT_P99_NS,
+                                     RTT_P999_NS, RTT_MAX_NS};
+  static metric_id const test_4[] = {TIME_SECS,
+                                     MSGS_PER_SEC,
+                                     BYTES_PER_SEC,
+                                     WRITER_TSC_PER_MSG,
+                                     READER_TSC_PER_MSG,
+                                     WRITER_FAIRNESS,
+                                     READER_FAIRNESS,
+                                     WRITER_CAS_FAILURE_RATIO,
+                                     READER_CAS_FAILURE_RATIO};
+  static metric_id const e2e_tests[] = {
+      TIME_SECS,  MSGS_PER_SEC, BYTES_PER_SEC, E2E_P50_NS,
+      E2E_P99_NS, E2E_P999_NS,  E2E_MAX_NS};
+  static metric_id const test_8[] = {
+      MSGS_PER_SEC, BYTES_PER_SEC, WRITER_LATE_RATIO, E2E_P50_NS,
+      E2E_P90_NS,   E2E_P99_NS,    E2E_P999_NS,       E2E_P9999_NS,
+      E2E_MAX_NS};
+
+  metric_id const* test_specific = NULL;
+  uint64_t         n             = 0;
+  switch (config->test) {
+    case 1:
+      test_specific = test_1;
+      n             = sizeof(test_1) / sizeof(*test_1);
+      break;
+    case 2:
+      test_specific = test_2;
+      n             = sizeof(test_2) / sizeof(*test_2);
+      break;
+    case 3:
+      test_specific = test_3;
+      n             = sizeof(test_3) / sizeof(*test_3);
+      break;
+    case 4:
+      test_specific = test_4;
+      n             = sizeof(test_4) / sizeof(*test_4);
+      break;
+    case 8:
+      test_specific = test_8;
+      n             = sizeof(test_8) / sizeof(*test_8);
+      break;
+    default:
+      test_specific = e2e_tests;
+      n             = sizeof(e2e_tests) / sizeof(*e2e_tests);
+  }
+  memcpy(metrics, test_specific, n * sizeof(metric_id));
+
+  /* Latency is measured with '--test 3' next to the throughput */
+  if (config->sweep_topology && (3 != config->test)) {
+    metrics[n++] = RTT_P50_NS;
+    metrics[n++] = RTT_P99_NS;
+  }
+
+  if (config->hw_counters) {
+    for (uint64_t k = WRITER_CYCLES_PER_MSG; k <= READER_HITM_PER_MSG; ++k) {
+      metrics[n++] = (metric_id)k;
+    }
+  }
+  return n;
+}
+
+static double metric_value(perf_results const* const results,
+                           metric_id const           m,
+                           uint64_t const            n_msgs,
+                           uint64_t const            msg_sz) {
+  switch (m) {
+    case TIME_SECS:
+      return results->time_secs;
+    case MSGS_PER_SEC:
+      return (double)n_msgs / results->time_secs;
+    case BYTES_PER_SEC:
+      return (double)(n_msgs * msg_sz) / results->time_secs;
+    case WRITER_HIT_RATIO:
+      return results->writer_hit_ratio;
+    case READER_HIT_RATIO:
+      return results->reader_hit_ratio;
+    case WRITER_TSC_PER_MSG:
+      return results->writer_tsc_per_msg;
+    case READER_TSC_PER_MSG:
+      return results->reader_tsc_per_msg;
+    case RTT_MIN_NS:
+      return results->rtt_min_ns;
+    case RTT_P50_NS:
+      return results->rtt_p50_ns;
+    case RTT_P99_NS:
+      return results->rtt_p99_ns;
+    case RTT_P999_NS:
+      return results->rtt_p999_ns;
+    case RTT_MAX_NS:
+      return results->rtt_max_ns;
+    case E2E_P50_NS:
+      return results->e2e_p50_ns;
+    case E2E_P90_NS:
+      return results->e2e_p90_ns;
+    case E2E_P99_NS:
+      return results->e2e_p99_ns;
+    case E2E_P999_NS:
+      return results->e2e_p999_ns;
+    case E2E_P9999_NS:
+      return results->e2e_p9999_ns;
+    case E2E_MAX_NS:
+      return results->e2e_max_ns;
+    case WRITER_LATE_RATIO:
+      return results->writer_late_ratio;
+    case WRITER_FAIRNESS:
+      return results->writer_fairness;
+    case READER_FAIRNESS:
+      return results->reader_fairness;
+    case WRITER_CAS_FAILURE_RATIO:
+      return results->writer_cas_failure_ratio;
+    case READER_CAS_FAILURE_RATIO:
+      return results->reader_cas_failure_ratio;
+    case WRITER_CYCLES_PER_MSG:
+    case WRITER_INSTRUCTIONS_PER_MSG:
+    case WRITER_L1D_MISSES_PER_MSG:
+    case WRITER_LLC_MISSES_PER_MSG:
+    case WRITER_HITM_PER_MSG:
+      return results->writer_hw[m - WRITER_CYCLES_PER_MSG];
+    case READER_CYCLES_PER_MSG:
+    case READER_INSTRUCTIONS_PER_MSG:
+    case READER_L1D_MISSES_PER_MSG:
+    case READER_LLC_MISSES_PER_MSG:
+    case READER_HITM_PER_MSG:
+      return results->reader_hw[m - READER_CYCLES_PER_MSG];
+    default:
+      return 0;
+  }
+}
+
+/* Header of the column listing the exceeded boundaries, as wide as all of
+ * their labels */
+#define EXCEEDS "Exceeds       "
+
 static void print_to_stdout(perf_config const* const config,
                             stdout_output const      what_to_print) {
-  char const* const i_sz     = "Inbox size";
-  char const* const sep      = " | ";
-  char const* const m_sz     = "Msg size";
-  char const* const time     = "Time (secs)";
-  char const* const m_sec    = "Msgs/second";
-  char const* const prod_hit = "Writer hit ratio";
-  char const* const cons_hit = "Reader hit ratio";
+  char const* const sep = " | ";
 
-  uint64_t const test_1_sep_len = strlen(i_sz) + strlen(m_sz) + strlen(time) +
-                                  strlen(m_sec) + (3 * strlen(sep));
+  metric_id      metrics[N_METRICS] = {0};
+  uint64_t const n_metrics          = test_metrics(config, metrics);
 
-  uint64_t const test_2_sep_len = strlen(i_sz) + strlen(m_sz) + strlen(time) +
-                                  strlen(m_sec) + strlen(prod_hit) +
-                                  strlen(cons_hit) + (5 * strlen(sep));
+  uint64_t sep_len = strlen("Inbox size") + strlen(sep) + strlen("Msg size");
+  if (config->sweep_msgs_sizes) {
+    sep_len += (2 * strlen(sep)) + strlen("Slot size") + strlen(EXCEEDS);
+  }
+  if (config->sweep_topology) {
+    sep_len += (2 * strlen(sep)) + strlen("Relation    ") + strlen("Cores  ");
+  }
+  if (4 == config->test) {
+    sep_len += (2 * strlen(sep)) + strlen("Producers") + strlen("Consumers");
+  } else if ((5 == config->test) || (6 == config->test)) {
+    sep_len += strlen(sep) + strlen("Producers");
+  } else if (7 == config->test) {
+    sep_len += strlen(sep) + strlen("Stages");
+  } else if (8 == config->test) {
+    sep_len += strlen(sep) + strlen("Offered load");
+  } else if (9 == config->test) {
+    sep_len += (2 * strlen(sep)) + strlen("Pattern") + strlen("Queue        ");
+  }
+  for (uint64_t k = 0; k != n_metrics; ++k) {
+    sep_len += strlen(sep) + strlen(metric_descs[metrics[k]].header);
+  }
 
   if (HEADER == what_to_print) {
-    if (1 == config->test) {
-      printf("\n%s%s%s%s%s%s%s\n", i_sz, sep, m_sz, sep, time, sep, m_sec);
+    printf("\nInbox size%sMsg size", sep);
+    if (config->sweep_msgs_sizes) { printf("%sSlot size%s" EXCEEDS, sep, sep); }
+    if (config->sweep_topology) { printf("%sRelation    %sCores  ", sep, sep); }
+    if (4 == config->test) { printf("%sProducers%sConsumers", sep, sep); }
+    if (5 == config->test) { printf("%sConsumers", sep); }
+    if (6 == config->test) { printf("%sProducers", sep); }
+    if (7 == config->test) { printf("%sStages", sep); }
+    if (8 == config->test) { printf("%sOffered load", sep); }
+    if (9 == config->test) { printf("%sPattern%sQueue        ", sep, sep); }
+    for (uint64_t k = 0; k != n_metrics; ++k) {
+      printf("%s%s", sep, metric_descs[metrics[k]].header);
+    }
+    puts("");
+  }
+  for (uint64_t k = 0; k != sep_len; ++k) { fputs("-", stdout); }
+  puts("");
+}
+
+static void emit_header(perf_config const* const config,
+                        host_info const* const   host) {
+  if (TABLE == config->format) {
+    print_to_stdout(config, HEADER);
+  } else if (CSV == config->format) {
+    puts(
+        "test,inbox_size,msg_size,relation,writer_cores,reader_cores,n_msgs,"
+        "n_its,offered_msgs_per_sec,queue,slot_size,exceeds,metric,median,"
+        "values,cpu_model,governor,invariant_tsc,tsc_ghz,compiler,cflags,"
+        "kernel");
+  } else {
+    printf("{\"host\": {\"cpu_model\": ");
+    print_escaped(JSON, host->cpu_model);
+    printf(", \"governor\": ");
+    print_escaped(JSON, host->governor);
+    printf(", \"invariant_tsc\": %s, \"tsc_ghz\": %.6f",
+           host->invariant_tsc ? "true" : "false", host->tsc_ghz);
+    printf(", \"compiler\": ");
+    print_escaped(JSON, __VERSION__);
+    printf(", \"cflags\": ");
+    print_escaped(JSON, X9_PROF_CFLAGS);
+    printf(", \"kernel\": ");
+    print_escaped(JSON, host->kernel);
+    printf("},\n \"results\": [");
+  }
+}
 
+/* Labels (table), keys separated by ';' (csv) or an array of keys (json) of
+ * the boundaries set in 'exceeded'. */
+static void print_boundaries(output_format const format,
+                             uint64_t const      exceeded) {
+  char     buf[sizeof(EXCEEDS)] = {0};
+  uint64_t n                    = 0;
+  if (JSON == format) { putchar('['); }
+  for (uint64_t b = 0; b != N_BOUNDARIES; ++b) {
+    if (!(exceeded & (UINT64_C(1) << b))) { continue; }
+    if (TABLE == format) {
+      n += (uint64_t)snprintf(buf + n, sizeof(buf) - n, "%s%s", n ? "," : "",
+                              boundary_descs[b].label);
+    } else if (CSV == format) {
+      printf("%s%s", n++ ? ";" : "", boundary_descs[b].key);
     } else {
-      printf("\n%s%s%s%s%s%s%s%s%s%s%s\n", i_sz, sep, m_sz, sep, time, sep,
-             m_sec, sep, prod_hit, sep, cons_hit);
+      printf("%s\"%s\"", n++ ? ", " : "", boundary_descs[b].key);
     }
   }
-  if (1 == config->test) {
-    for (uint64_t k = 0; k != test_1_sep_len; ++k) { fputs("-", stdout); }
-  } else {
-    for (uint64_t k = 0; k != test_2_sep_len; ++k) { fputs("-", stdout); }
+  if (TABLE == format) { printf("%-*s", (int)strlen(EXCEEDS), buf); }
+  if (JSON == format) { putchar(']'); }
+}
+
+/* Producers and consumers of a '--test 9' row */
+static char const* access_pattern(perf_row const* const row) {
+  if (1 == row->n_writers) { return (1 == row->n_readers) ? "SPSC" : "SPMC"; }
+  return (1 == row->n_readers) ? "MPSC" : "MPMC";
+}
+
+static void emit_row(perf_config const* const config,
+                     host_info const* const   host,
+                     perf_row const* const    row) {
+  static uint64_t n_rows = 0;
+
+  metric_id      metrics[N_METRICS] = {0};
+  uint64_t const n_metrics          = test_metrics(config, metrics);
+  uint64_t const   n_its     = (uint64_t)config->n_iterations;
+
+  /* 'calculate_median' sorts, and the raw values are kept in order */
+  double* const sorted = calloc(n_its, sizeof(double));
+  if (NULL == sorted) { abort_test("ERROR: failed to allocate 'sorted'"); }
+
+  uint64_t const exceeded = exceeded_boundaries(host, row);
+
+  if (TABLE == config->format) {
+    printf("%10lu | %8lu", row->ibx_sz, row->msg_sz);
+    if (config->sweep_msgs_sizes) {
+      printf(" | %9lu | ", row->slot_sz);
+      print_boundaries(TABLE, exceeded);
+    }
+    if (row->relation) {
+      printf(" | %-12s | %3ld,%-3ld", row->relation, row->writer_cores[0],
+             row->reader_cores[0]);
+    }
+    if (4 == config->test) {
+      printf(" | %9lu | %9lu", row->n_writers, row->n_readers);
+    }
+    if (5 == config->test) { printf(" | %9lu", row->n_readers); }
+    if (6 == config->test) { printf(" | %9lu", row->n_writers); }
+    if (7 == config->test) { printf(" | %6lu", row->n_writers + 1); }
+    if (8 == config->test) { printf(" | %11.2fM", row->offered_rate / 1e6); }
+    if (9 == config->test) {
+      printf(" | %-7s | %-13s", access_pattern(row), row->queue);
+    }
+  } else if (JSON == config->format) {
+    printf("%s\n  {\"test\": %ld, \"inbox_size\": %lu, \"msg_size\": %lu, ",
+           n_rows ? "," : "", config->test, row->ibx_sz, row->msg_sz);
+    printf("\"relation\": ");
+    row->relation ? print_escaped(JSON, row->relation) : (void)printf("null");
+    printf(", \"writer_cores\": ");
+    print_cores(JSON, row->n_writers, row->writer_cores);
+    printf(", \"reader_cores\": ");
+    print_cores(JSON, row->n_readers, row->reader_cores);
+    printf(", \"n_msgs\": %ld, \"n_its\": %ld, \"offered_msgs_per_sec\": ",
+           config->n_messages, config->n_iterations);
+    (8 == config->test) ? printf("%.9g", row->offered_rate)
+                        : printf("null");
+    printf(", \"queue\": ");
+    row->queue ? print_escaped(JSON, row->queue) : (void)printf("null");
+    printf(", \"slot_size\": %lu, \"exceeds\": ", row->slot_sz);
+    print_boundaries(JSON, exceeded);
+    printf(", \"metrics\": {");
   }
-  puts("");
+
+  for (uint64_t k = 0; k != n_metrics; ++k) {
+    metric_id const m = metrics[k];
+    memcpy(sorted, row->values[m], n_its * sizeof(double));
+    double const median = calculate_median(n_its, sorted);
+    /* Metrics that were not available are negative */
+    bool const na = (RATIO == metric_descs[m].kind) && (median < 0);
+
+    if (TABLE == config->format) {
+      fputs(" | ", stdout);
+      print_table_cell(m, median);
+    } else if (CSV == config->format) {
+      printf("%ld,%lu,%lu,", config->test, row->ibx_sz, row->msg_sz);
+      if (row->relation) { print_escaped(CSV, row->relation); }
+      putchar(',');
+      print_cores(CSV, row->n_writers, row->writer_cores);
+      putchar(',');
+      print_cores(CSV, row->n_readers, row->reader_cores);
+      printf(",%ld,%ld,", config->n_messages, config->n_iterations);
+      if (8 == config->test) { printf("%.9g", row->offered_rate); }
+      putchar(',');
+      if (row->queue) { print_escaped(CSV, row->queue); }
+      printf(",%lu,", row->slot_sz);
+      print_boundaries(CSV, exceeded);
+      printf(",%s,", metric_descs[m].key);
+      if (!na) {
+        printf("%.9g,", median);
+        for (uint64_t it = 0; it != n_its; ++it) {
+          printf("%s%.9g", it ? ";" : "", row->values[m][it]);
+        }
+      } else {
+        putchar(',');
+      }
+      putchar(',');
+      print_escaped(CSV, host->cpu_model);
+      putchar(',');
+      print_escaped(CSV, host->governor);
+      printf(",%s,%.6f,", host->invariant_tsc ? "true" : "false",
+             host->tsc_ghz);
+      print_escaped(CSV, __VERSION__);
+      putchar(',');
+      print_escaped(CSV, X9_PROF_CFLAGS);
+      putchar(',');
+      print_escaped(CSV, host->kernel);
+      puts("");
+    } else {
+      printf("%s\"%s\": ", k ? ", " : "", metric_descs[m].key);
+      if (!na) {
+        printf("{\"median\": %.9g, \"values\": [", median);
+        for (uint64_t it = 0; it != n_its; ++it) {
+          printf("%s%.9g", it ? ", " : "", row->values[m][it]);
+        }
+        printf("]}");
+      } else {
+        printf("null");
+      }
+    }
+  }
+
+  if (TABLE == config->format) {
+    puts("");
+  } else if (JSON == config->format) {
+    printf("}}");
+  }
+  fflush(stdout);
+  ++n_rows;
+  free(sorted);
 }
 
-static int cmp(const void* a, const void* b) {
-  return (*(const double*)a > *(const double*)b)   ? 1
-         : (*(const double*)a < *(const double*)b) ? -1
-                                                   : 0;
+static void emit_separator(perf_config const* const config) {
+  if (TABLE == config->format) { print_to_stdout(config, SEPARATOR); }
 }
 
-static double calculate_median(uint64_t const sz, double* const arr) {
-  qsort(arr, sz, sizeof(double), cmp);
-  return ((sz % 2) == 0) ? ((arr[sz / 2 - 1] + arr[sz / 2]) / 2) : arr[sz / 2];
+static void emit_footer(perf_config const* const config) {
+  if (TABLE == config->format) {
+    puts("");
+  } else if (JSON == config->format) {
+    puts("\n]}");
+  }
+}
+
+/* Results move with frequency scaling unless the cores in use run with the
+ * 'performance' governor. */
+static void warn_about_governors(perf_config const* const config,
+                                 placement const* const   placements,
+                                 uint64_t const           n_placements) {
+  cpu_set_t used = {0};
+  CPU_ZERO(&used);
+  if (7 == config->test) {
+    for (uint64_t k = 0; k != config->stages_cores->used; ++k) {
+      CPU_SET((uint64_t)config->stages_cores->data[k], &used);
+    }
+  } else if (uses_core_lists(config)) {
+    for (uint64_t k = 0; k != config->producers_cores->used; ++k) {
+      CPU_SET((uint64_t)config->producers_cores->data[k], &used);
+    }
+    for (uint64_t k = 0; k != config->consumers_cores->used; ++k) {
+      CPU_SET((uint64_t)config->consumers_cores->data[k], &used);
+    }
+  } else {
+    for (uint64_t k = 0; k != n_placements; ++k) {
+      CPU_SET((uint64_t)placements[k].cores[0], &used);
+      CPU_SET((uint64_t)placements[k].cores[1], &used);
+    }
+  }
+
+  for (int64_t cpu = 0; cpu != CPU_SETSIZE; ++cpu) {
+    if (!CPU_ISSET((uint64_t)cpu, &used)) { continue; }
+    char path[128]    = {0};
+    char governor[32] = {0};
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%ld/cpufreq/scaling_governor", cpu);
+    if (read_sys_file(path, governor, sizeof(governor)) &&
+        strcmp(governor, "performance")) {
+      fprintf(stderr,
+              "WARNING: core %ld uses the '%s' frequency governor instead of "
+              "'performance', results will move with frequency scaling.\n",
+              cpu, governor);
+    }
+  }
 }
 
 int main(int argc, char** argv) {
@@ -451,74 +2821,194 @@ int main(int argc, char** argv) {
 
   perf_config* config = parse_command_line_args(argc, argv);
 
-  print_to_stdout(config, HEADER);
-
-  double* time_secs = calloc((uint64_t)config->n_iterations, sizeof(double));
-  if (NULL == time_secs) {
-    abort_test("ERROR: failed to allocate 'time_secs'");
+  /* Tests 4 to 7 and 9 run the producers and consumers in their own cores */
+  placement placements[N_RELATIONS] = {0};
+  uint64_t  n_placements            = 1;
+  if (config->sweep_topology) {
+    n_placements = pick_topology_placements(placements);
+  } else if (!uses_core_lists(config)) {
+    placements[0].cores[0] = config->run_in_cores->data[0];
+    placements[0].cores[1] = config->run_in_cores->data[1];
   }
 
-  double* writer_hit_ratio =
-      calloc((uint64_t)config->n_iterations, sizeof(double));
-  if (NULL == writer_hit_ratio) {
-    abort_test("ERROR: failed to allocate 'writer_hit_ratio'");
+  int64_t first_core = placements[0].cores[0];
+  if (7 == config->test) {
+    first_core = config->stages_cores->data[0];
+  } else if (uses_core_lists(config)) {
+    first_core = config->producers_cores->data[0];
   }
 
-  double* reader_hit_ratio =
-      calloc((uint64_t)config->n_iterations, sizeof(double));
-  if (NULL == reader_hit_ratio) {
-    abort_test("ERROR: failed to allocate 'reader_hit_ratio'");
+  host_info host = {0};
+  read_host_info(first_core, &host);
+
+  if (config->hw_counters) {
+    int const fd =
+        hw_counter_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    if (fd < 0) {
+      fprintf(stderr,
+              "WARNING: perf_event_open failed (%s), hardware counters are "
+              "not available (see /proc/sys/kernel/perf_event_paranoid).\n",
+              strerror(errno));
+    } else {
+      close(fd);
+    }
   }
 
-  for (uint64_t k = 0; k != config->inboxes_sizes->used; ++k) {
-    if (config->inboxes_sizes->data[k]) {
-      for (uint64_t j = 0; j != config->msgs_sizes->used; ++j) {
-        if (config->msgs_sizes->data[j]) {
-          for (uint64_t it = 0; it != (uint64_t)config->n_iterations; ++it) {
-            perf_results results =
-                run_test((uint64_t)config->inboxes_sizes->data[k],
-                         (uint64_t)config->msgs_sizes->data[j],
-                         (uint64_t)config->n_messages,
-                         (uint64_t)config->run_in_cores->data[0],
-                         (uint64_t)config->run_in_cores->data[1],
-                         (uint64_t)config->test);
-
-            time_secs[it]        = results.time_secs;
-            writer_hit_ratio[it] = results.writer_hit_ratio;
-            reader_hit_ratio[it] = results.reader_hit_ratio;
-          }
+  /* Cycles per msg and round-trip times are measured with the TSC */
+  x9_calibrate_tsc();
+  double const ns_per_cycle = x9_ns_per_cycle();
+  host.tsc_ghz              = 1 / ns_per_cycle;
+  host.invariant_tsc        = tsc_is_invariant();
+  if (!host.invariant_tsc) {
+    fprintf(stderr,
+            "WARNING: the TSC is not invariant, its rate changes with the "
+            "frequency of the cores and cycles can't be compared between "
+            "hosts.\n");
+  }
+  warn_about_governors(config, placements, n_placements);
 
-          double const median_secs =
-              calculate_median((uint64_t)config->n_iterations, time_secs);
+  uint64_t const n_its = (uint64_t)config->n_iterations;
 
-          printf("%10ld | ", config->inboxes_sizes->data[k]);
-          printf("%8ld | ", config->msgs_sizes->data[j]);
-          median_secs > 1 ? printf("%*.2f | ", 11, median_secs)
-                          : printf("%*.4f | ", 11, median_secs);
-          printf("%*.2fM", 10,
-                 ((double)config->n_messages / median_secs) / 1e6);
+  perf_row row = {0};
+  for (uint64_t m = 0; m != N_METRICS; ++m) {
+    row.values[m] = calloc(n_its, sizeof(double));
+    if (NULL == row.values[m]) {
+      abort_test("ERROR: failed to allocate 'row.values'");
+    }
+  }
 
-          if (2 == config->test) {
-            double const median_writer_hit = calculate_median(
-                (uint64_t)config->n_iterations, writer_hit_ratio);
+  /* '--test 4' sweeps all the producers x consumers combinations, tests 5 to
+   * 7 the number of consumers, producers or inboxes between stages, '--test 9'
+   * one and all producers x one and all consumers, and the other tests run
+   * one writer and one reader in each placement */
+  uint64_t max_writers = 1;
+  uint64_t max_readers = 1;
+  if ((4 == config->test) || (6 == config->test) || (9 == config->test)) {
+    max_writers = config->producers_cores->used;
+  }
+  if ((4 == config->test) || (5 == config->test) || (9 == config->test)) {
+    max_readers = config->consumers_cores->used;
+  }
+  if (7 == config->test) { max_writers = config->stages_cores->used - 1; }
+
+  /* Offered loads of '--test 8' (the gaps of '--gaps_file' or
+   * '--trace_file' are replayed as they are, or '--speedups' times faster,
+   * when no '--rates' are given), and queues of '--test 9' */
+  uint64_t n_variants = 1;
+  if (8 == config->test) {
+    n_variants = config->rates      ? config->rates->used
+                 : config->speedups ? config->n_speedups
+                                    : 1;
+  } else if (9 == config->test) {
+    n_variants = N_QUEUES;
+  }
 
-            double const median_reader_hit = calculate_median(
-                (uint64_t)config->n_iterations, reader_hit_ratio);
+  emit_header(config, &host);
 
-            printf(" |%*.2f%% | ", 16, median_writer_hit * 100);
-            printf("%*.2f%%", 15, median_reader_hit * 100);
+  for (uint64_t k = 0; k != config->inboxes_sizes->used; ++k) {
+    for (uint64_t j = 0; j != config->msgs_sizes->used; ++j) {
+      /* The header of each slot depends on how x9.c was compiled */
+      x9_inbox* const probe =
+          x9_create_inbox((uint64_t)config->inboxes_sizes->data[k], "probe",
+                          (uint64_t)config->msgs_sizes->data[j]);
+      if (!(x9_inbox_is_valid(probe))) {
+        abort_test("ERROR: x9_inbox is invalid");
+      }
+      uint64_t const slot_sz = x9_inbox_slot_sz(probe);
+      x9_free_inbox(probe);
+
+      for (uint64_t t = 0; t != n_placements; ++t) {
+        for (uint64_t p = 1; p <= max_writers; ++p) {
+          for (uint64_t c = 1; c <= max_readers; ++c) {
+            for (uint64_t v = 0; v != n_variants; ++v) {
+              placement const* const place = &placements[t];
+              queue_ops const* const ops   = &queues[v % N_QUEUES];
+              if ((9 == config->test) &&
+                  (((p != 1) && (p != max_writers)) ||
+                   ((c != 1) && (c != max_readers)) ||
+                   (ops->spsc_only && ((p > 1) || (c > 1))))) {
+                continue;
+              }
+
+              row.relation     = place->relation;
+              row.ibx_sz       = (uint64_t)config->inboxes_sizes->data[k];
+              row.msg_sz       = (uint64_t)config->msgs_sizes->data[j];
+              row.slot_sz      = slot_sz;
+              row.n_writers    = p;
+              row.n_readers    = c;
+              row.writer_cores = &place->cores[0];
+              row.reader_cores = &place->cores[1];
+              if (8 == config->test) {
+                row.offered_rate =
+                    config->rates ? (double)config->rates->data[v]
+                    : config->speedups
+                        ? config->speedups[v] * 1e9 /
+                              config->mean_gap_ns
+                        : 1e9 / config->mean_gap_ns;
+              }
+              if (9 == config->test) { row.queue = ops->name; }
+              if (7 == config->test) {
+                /* Every stage but the last writes, and all but the first
+                 * read */
+                row.n_readers    = p;
+                row.writer_cores = config->stages_cores->data;
+                row.reader_cores = config->stages_cores->data + 1;
+              } else if (uses_core_lists(config)) {
+                row.writer_cores = config->producers_cores->data;
+                row.reader_cores = config->consumers_cores->data;
+              }
+
+              for (uint64_t it = 0; it != n_its; ++it) {
+                uint64_t const n_msgs  = (uint64_t)config->n_messages;
+                perf_results   results = {0};
+                if (4 == config->test) {
+                  results = run_scaling_test(row.ibx_sz, row.msg_sz, n_msgs,
+                                             p, c, config);
+                } else if (9 == config->test) {
+                  results = run_comparison_test(row.ibx_sz, row.msg_sz, n_msgs,
+                                                p, c, ops, ns_per_cycle,
+                                                config);
+                } else if (uses_core_lists(config)) {
+                  results = run_node_test(row.ibx_sz, row.msg_sz, n_msgs,
+                                          (5 == config->test) ? c : p,
+                                          ns_per_cycle, config);
+                } else if (8 == config->test) {
+                  results = run_open_loop_test(
+                      row.ibx_sz, row.msg_sz, n_msgs,
+                      (uint64_t)place->cores[0], (uint64_t)place->cores[1],
+                      row.offered_rate, ns_per_cycle, config);
+                } else {
+                  results = run_test(
+                      row.ibx_sz, row.msg_sz, n_msgs,
+                      (uint64_t)place->cores[0], (uint64_t)place->cores[1],
+                      (uint64_t)config->test, ns_per_cycle, config);
+                }
+
+                if (config->sweep_topology && (3 != config->test)) {
+                  perf_results const latency = run_test(
+                      row.ibx_sz, row.msg_sz, n_msgs,
+                      (uint64_t)place->cores[0], (uint64_t)place->cores[1],
+                      3, ns_per_cycle, config);
+                  results.rtt_p50_ns = latency.rtt_p50_ns;
+                  results.rtt_p99_ns = latency.rtt_p99_ns;
+                }
+
+                for (uint64_t m = 0; m != N_METRICS; ++m) {
+                  row.values[m][it] =
+                      metric_value(&results, (metric_id)m, n_msgs, row.msg_sz);
+                }
+              }
+              emit_row(config, &host, &row);
+            }
           }
         }
-        puts("");
       }
-      print_to_stdout(config, SEPARATOR);
     }
+    emit_separator(config);
   }
 
-  puts("");
-  free(time_secs);
-  free(writer_hit_ratio);
-  free(reader_hit_ratio);
+  emit_footer(config);
+  for (uint64_t m = 0; m != N_METRICS; ++m) { free(row.values[m]); }
   free_perf_config(config);
   return EXIT_SUCCESS;
 }
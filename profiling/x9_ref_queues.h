@@ -0,0 +1,260 @@
+/* x9_ref_queues.h:
+ *
+ *  Reference queues that 'x9_profiler.c' ('--test 9') compares 'x9_inbox'
+ *  against, using the same harness for all of them:
+ *
+ *   - mutex_queue:   a ring buffer protected by a mutex, where writers and
+ *                    readers block on condition variables when it is full or
+ *                    empty.
+ *   - lamport_queue: Lamport's single producer single consumer ring buffer,
+ *                    where each side owns (and is the only one to write) one
+ *                    of the indexes.
+ *   - vyukov_queue:  Vyukov's bounded multiple producer multiple consumer
+ *                    ring buffer, where each slot has a sequence number that
+ *                    tells writers and readers whose turn it is.
+ *
+ *  As 'x9_inbox', they copy 'msg_sz' bytes in and out of their slots, and
+ *  writers (readers) wait until there's a free slot (a msg) to write (read).
+ *  'sz' must be a power of 2.
+ *  Functions take the queue as 'void*', so that the profiler can call all of
+ *  them through the same function pointers.
+ */
+
+#pragma once
+
+#include <pthread.h>   /* pthread_mutex_*, pthread_cond_* */
+#include <stdatomic.h> /* atomic_* */
+#include <stdint.h>    /* uint8_t, uint64_t, int64_t */
+#include <stdlib.h>    /* aligned_alloc, calloc, free */
+#include <string.h>    /* memcpy, memset */
+#include <x86intrin.h> /* _mm_pause */
+
+#define REF_CL_SIZE       64
+#define REF_ALIGN_TO_CL() __attribute__((__aligned__(REF_CL_SIZE)))
+
+/* --- Mutex + condition variables --- */
+
+typedef struct {
+  pthread_mutex_t mtx;
+  pthread_cond_t  not_empty;
+  pthread_cond_t  not_full;
+  uint64_t        sz;
+  uint64_t        msg_sz;
+  uint64_t        read_idx;
+  uint64_t        write_idx;
+  uint8_t*        slots;
+} mutex_queue;
+
+static void* mutex_queue_create(uint64_t const sz, uint64_t const msg_sz) {
+  mutex_queue* const q = calloc(1, sizeof(mutex_queue));
+  if (NULL == q) { return NULL; }
+  q->slots = calloc(sz, msg_sz);
+  if (NULL == q->slots) {
+    free(q);
+    return NULL;
+  }
+  pthread_mutex_init(&q->mtx, NULL);
+  pthread_cond_init(&q->not_empty, NULL);
+  pthread_cond_init(&q->not_full, NULL);
+  q->sz     = sz;
+  q->msg_sz = msg_sz;
+  return q;
+}
+
+static void mutex_queue_write(void* const          queue,
+                              uint64_t const       msg_sz,
+                              void const* restrict msg) {
+  mutex_queue* const q = (mutex_queue*)queue;
+
+  pthread_mutex_lock(&q->mtx);
+  while ((q->write_idx - q->read_idx) == q->sz) {
+    pthread_cond_wait(&q->not_full, &q->mtx);
+  }
+  memcpy(&q->slots[(q->write_idx & (q->sz - 1)) * q->msg_sz], msg, msg_sz);
+  ++q->write_idx;
+  pthread_cond_signal(&q->not_empty);
+  pthread_mutex_unlock(&q->mtx);
+}
+
+static void mutex_queue_read(void* const     queue,
+                             uint64_t const  msg_sz,
+                             void* restrict outparam) {
+  mutex_queue* const q = (mutex_queue*)queue;
+
+  pthread_mutex_lock(&q->mtx);
+  while (q->write_idx == q->read_idx) {
+    pthread_cond_wait(&q->not_empty, &q->mtx);
+  }
+  memcpy(outparam, &q->slots[(q->read_idx & (q->sz - 1)) * q->msg_sz],
+         msg_sz);
+  ++q->read_idx;
+  pthread_cond_signal(&q->not_full);
+  pthread_mutex_unlock(&q->mtx);
+}
+
+static void mutex_queue_free(void* const queue) {
+  mutex_queue* const q = (mutex_queue*)queue;
+  pthread_cond_destroy(&q->not_full);
+  pthread_cond_destroy(&q->not_empty);
+  pthread_mutex_destroy(&q->mtx);
+  free(q->slots);
+  free(q);
+}
+
+/* --- Lamport SPSC --- */
+
+/* Each index is only written by one side, hence on separate cache lines. */
+typedef struct {
+  _Atomic(uint64_t) read_idx  REF_ALIGN_TO_CL();
+  _Atomic(uint64_t) write_idx REF_ALIGN_TO_CL();
+  uint64_t sz                 REF_ALIGN_TO_CL();
+  uint64_t                    msg_sz;
+  uint8_t*                    slots;
+} lamport_queue;
+
+static void* lamport_queue_create(uint64_t const sz, uint64_t const msg_sz) {
+  lamport_queue* const q = aligned_alloc(REF_CL_SIZE, sizeof(lamport_queue));
+  if (NULL == q) { return NULL; }
+  memset(q, 0, sizeof(lamport_queue));
+  q->slots = calloc(sz, msg_sz);
+  if (NULL == q->slots) {
+    free(q);
+    return NULL;
+  }
+  q->sz     = sz;
+  q->msg_sz = msg_sz;
+  return q;
+}
+
+static void lamport_queue_write(void* const          queue,
+                                uint64_t const       msg_sz,
+                                void const* restrict msg) {
+  lamport_queue* const q = (lamport_queue*)queue;
+
+  uint64_t const idx = atomic_load_explicit(&q->write_idx, __ATOMIC_RELAXED);
+  while ((idx - atomic_load_explicit(&q->read_idx, __ATOMIC_ACQUIRE)) ==
+         q->sz) {
+    _mm_pause();
+  }
+  memcpy(&q->slots[(idx & (q->sz - 1)) * q->msg_sz], msg, msg_sz);
+  atomic_store_explicit(&q->write_idx, idx + 1, __ATOMIC_RELEASE);
+}
+
+static void lamport_queue_read(void* const     queue,
+                               uint64_t const  msg_sz,
+                               void* restrict outparam) {
+  lamport_queue* const q = (lamport_queue*)queue;
+
+  uint64_t const idx = atomic_load_explicit(&q->read_idx, __ATOMIC_RELAXED);
+  while (atomic_load_explicit(&q->write_idx, __ATOMIC_ACQUIRE) == idx) {
+    _mm_pause();
+  }
+  memcpy(outparam, &q->slots[(idx & (q->sz - 1)) * q->msg_sz], msg_sz);
+  atomic_store_explicit(&q->read_idx, idx + 1, __ATOMIC_RELEASE);
+}
+
+static void lamport_queue_free(void* const queue) {
+  lamport_queue* const q = (lamport_queue*)queue;
+  free(q->slots);
+  free(q);
+}
+
+/* --- Vyukov MPMC --- */
+
+typedef struct {
+  _Atomic(uint64_t) read_idx  REF_ALIGN_TO_CL();
+  _Atomic(uint64_t) write_idx REF_ALIGN_TO_CL();
+  uint64_t sz                 REF_ALIGN_TO_CL();
+  uint64_t                    msg_sz;
+  uint64_t                    slot_sz; /* Sequence number + msg, 8B aligned */
+  uint8_t*                    slots;
+} vyukov_queue;
+
+static inline _Atomic(uint64_t)* vyukov_seq_ptr(vyukov_queue const* const q,
+                                                uint64_t const idx) {
+  return (_Atomic(uint64_t)*)&q->slots[(idx & (q->sz - 1)) * q->slot_sz];
+}
+
+static void* vyukov_queue_create(uint64_t const sz, uint64_t const msg_sz) {
+  vyukov_queue* const q = aligned_alloc(REF_CL_SIZE, sizeof(vyukov_queue));
+  if (NULL == q) { return NULL; }
+  memset(q, 0, sizeof(vyukov_queue));
+  q->slot_sz = sizeof(uint64_t) + ((msg_sz + 7) & ~UINT64_C(7));
+  q->slots   = calloc(sz, q->slot_sz);
+  if (NULL == q->slots) {
+    free(q);
+    return NULL;
+  }
+  q->sz     = sz;
+  q->msg_sz = msg_sz;
+
+  /* Slot 'k' is free for the writer of position 'k' */
+  for (uint64_t k = 0; k != sz; ++k) {
+    atomic_init(vyukov_seq_ptr(q, k), k);
+  }
+  return q;
+}
+
+static void vyukov_queue_write(void* const          queue,
+                               uint64_t const       msg_sz,
+                               void const* restrict msg) {
+  vyukov_queue* const q = (vyukov_queue*)queue;
+
+  _Atomic(uint64_t)* seq = NULL;
+
+  uint64_t pos = atomic_load_explicit(&q->write_idx, __ATOMIC_RELAXED);
+  for (;;) {
+    seq                = vyukov_seq_ptr(q, pos);
+    int64_t const diff =
+        (int64_t)(atomic_load_explicit(seq, __ATOMIC_ACQUIRE) - pos);
+    if (!diff) {
+      /* On failure 'pos' is updated */
+      if (atomic_compare_exchange_weak_explicit(&q->write_idx, &pos, pos + 1,
+                                                __ATOMIC_RELAXED,
+                                                __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else {
+      /* Full (< 0), or another writer took 'pos' */
+      if (diff < 0) { _mm_pause(); }
+      pos = atomic_load_explicit(&q->write_idx, __ATOMIC_RELAXED);
+    }
+  }
+  memcpy((uint8_t*)seq + sizeof(uint64_t), msg, msg_sz);
+  atomic_store_explicit(seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+static void vyukov_queue_read(void* const     queue,
+                              uint64_t const  msg_sz,
+                              void* restrict outparam) {
+  vyukov_queue* const q = (vyukov_queue*)queue;
+
+  _Atomic(uint64_t)* seq = NULL;
+
+  uint64_t pos = atomic_load_explicit(&q->read_idx, __ATOMIC_RELAXED);
+  for (;;) {
+    seq                = vyukov_seq_ptr(q, pos);
+    int64_t const diff =
+        (int64_t)(atomic_load_explicit(seq, __ATOMIC_ACQUIRE) - (pos + 1));
+    if (!diff) {
+      if (atomic_compare_exchange_weak_explicit(&q->read_idx, &pos, pos + 1,
+                                                __ATOMIC_RELAXED,
+                                                __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else {
+      /* Empty (< 0), or another reader took 'pos' */
+      if (diff < 0) { _mm_pause(); }
+      pos = atomic_load_explicit(&q->read_idx, __ATOMIC_RELAXED);
+    }
+  }
+  memcpy(outparam, (uint8_t*)seq + sizeof(uint64_t), msg_sz);
+  /* Free for the writer of the next lap */
+  atomic_store_explicit(seq, pos + q->sz, __ATOMIC_RELEASE);
+}
+
+static void vyukov_queue_free(void* const queue) {
+  vyukov_queue* const q = (vyukov_queue*)queue;
+  free(q->slots);
+  free(q);
+}
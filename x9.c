@@ -32,21 +32,29 @@
 
 #pragma GCC diagnostic ignored "-Wpadded"
 
+#define _GNU_SOURCE /* cpu_*, pthread_attr_setaffinity_np */
+
 #include "x9.h"
+#include "x9_inline.h"
 
 #include <assert.h>    /* assert */
-#include <immintrin.h> /* _mm_pause */
+#include <fcntl.h>     /* open, posix_fallocate */
+#include <immintrin.h> /* _mm_pause, __rdtsc */
+#include <inttypes.h>  /* PRIu64 */
+#include <limits.h>    /* PATH_MAX */
+#include <pthread.h>   /* pthread_t, pthread functions */
+#include <sched.h>     /* cpu_set_t, CPU_* */
 #include <stdarg.h>    /* va_* */
 #include <stdatomic.h> /* atomic_* */
 #include <stdbool.h>   /* bool */
-#include <stdio.h>     /* printf */
+#include <stdio.h>     /* fopen, printf, remove, snprintf */
 #include <stdlib.h>    /* aligned_alloc, calloc */
 #include <string.h>    /* strcmp */
 #include <string.h>    /* memcpy */
-
-/* CPU cache line size */
-#define X9_CL_SIZE       64
-#define X9_ALIGN_TO_CL() __attribute__((__aligned__(X9_CL_SIZE)))
+#include <sys/mman.h>  /* mmap, msync, munmap */
+#include <sys/stat.h>  /* fstat */
+#include <time.h>      /* clock_gettime, nanosleep */
+#include <unistd.h>    /* access, close, sysconf, unlink */
 
 #ifdef X9_DEBUG
 static void x9_print_error_msg(char const* const error_msg) {
@@ -58,52 +66,280 @@ static void x9_print_error_msg(char const* const error_msg) {
 
 /* --- Internal types --- */
 
+/* An inbox of a x9_node with a handler, which 'x9_node_run' dispatches to. */
+typedef struct {
+  x9_inbox*     inbox;
+  x9_handler_fn fn;
+  void*         ctx;
+} x9_handler;
+
+typedef struct x9_node_internal {
+  x9_inbox**  inboxes;
+  uint64_t    n_inboxes;
+  char*       name;
+  /* Only the inboxes with a handler, so that 'x9_node_run' doesn't have to
+   * skip the others. */
+  x9_handler* handlers;
+  uint64_t    n_handlers;
+  /* Handler 'x9_node_run' starts with, moved by one on every call. */
+  uint64_t    cursor;
+} x9_node;
+
+/* Maximum number of lanes of a x9_prio_inbox (one bit per lane in
+ * 'lanes_mask'). */
+#define X9_PRIO_INBOX_MAX_LANES 64
+
+typedef struct x9_prio_inbox_internal {
+  _Atomic(uint64_t) lanes_mask X9_ALIGN_TO_CL();
+  x9_inbox** lanes             X9_ALIGN_TO_CL();
+  uint64_t                     n_lanes;
+  char*                        name;
+  char                         pad[40];
+} x9_prio_inbox;
+
+/* States of a x9_conflating_inbox slot key. */
+#define X9_KEY_EMPTY   0
+#define X9_KEY_CLAIMED 1
+#define X9_KEY_READY   2
+
+typedef struct {
+  uint64_t         key;
+  _Atomic(uint8_t) state;
+  _Atomic(bool)    locked;
+  _Atomic(bool)    pending;
+  char const       pad[5];
+} x9_key_header;
+
+typedef struct x9_conflating_inbox_internal {
+  _Atomic(uint64_t) n_keys_used X9_ALIGN_TO_CL();
+  x9_inbox* ready               X9_ALIGN_TO_CL();
+  void*                         slots;
+  uint64_t                      n_slots;
+  uint64_t                      shift;
+  uint64_t                      n_keys;
+  uint64_t                      msg_sz;
+  char*                         name;
+  char                          pad[8];
+} x9_conflating_inbox;
+
+/* A x9_inbox of a x9_elastic_inbox, 'next' is set (once) by the writer when
+ * it moves to a new segment. */
+typedef struct x9_segment {
+  x9_inbox*                   inbox;
+  _Atomic(struct x9_segment*) next;
+} x9_segment;
+
+typedef struct x9_elastic_inbox_internal {
+  /* Only used by the writer */
+  x9_segment* write_seg X9_ALIGN_TO_CL();
+  uint64_t              lap_writes;
+  /* Only used by the reader */
+  x9_segment* read_seg  X9_ALIGN_TO_CL();
+  _Atomic(uint64_t) sz  X9_ALIGN_TO_CL();
+  uint64_t              min_sz;
+  uint64_t              max_sz;
+  uint64_t              msg_sz;
+  char*                 name;
+  char                  pad[24];
+} x9_elastic_inbox;
+
+/* Slots of a x9_lossy_inbox start with 'seq', which is 2 * (position + 1)
+ * once the message written at 'position' is complete, and odd while it is
+ * being written. Messages are copied in 8 byte words, which are atomic so
+ * that a reader racing with the writer is well defined. */
 typedef struct {
-  _Atomic(bool) slot_has_data;
-  _Atomic(bool) msg_written;
-  _Atomic(bool) shared;
-  char const    pad[5];
-} x9_msg_header;
-
-typedef struct x9_inbox_internal {
-  _Atomic(uint64_t) read_idx  X9_ALIGN_TO_CL();
+  _Atomic(uint64_t) seq;
+} x9_lossy_header;
+
+typedef struct x9_lossy_inbox_internal {
   _Atomic(uint64_t) write_idx X9_ALIGN_TO_CL();
+  /* Only used by the reader */
+  uint64_t read_idx           X9_ALIGN_TO_CL();
+  _Atomic(uint64_t)           dropped;
   uint64_t sz                 X9_ALIGN_TO_CL();
-  uint64_t                    msg_sz;
   uint64_t                    constant;
-  void*                       msgs;
+  uint64_t                    msg_sz;
+  uint64_t                    slot_sz;
+  void*                       slots;
   char*                       name;
-  char                        pad[24];
-} x9_inbox;
+  char                        pad[16];
+} x9_lossy_inbox;
 
-typedef struct x9_node_internal {
-  x9_inbox** inboxes;
-  uint64_t   n_inboxes;
-  char*      name;
-} x9_node;
+/* What a x9_executor worker inbox receives, 64 bytes with the x9_msg_header
+ * (without 'X9_LATENCY'). */
+typedef struct {
+  x9_task_fn fn;
+  char       args[X9_TASK_ARGS_SZ];
+} x9_task;
+
+typedef struct x9_worker {
+  /* Read by every worker, when stealing */
+  x9_inbox* inbox                    X9_ALIGN_TO_CL();
+  struct x9_executor_internal*       executor;
+  uint64_t                           idx;
+  pthread_t                          th;
+  /* Only written by the worker itself */
+  _Atomic(uint64_t) run              X9_ALIGN_TO_CL();
+  _Atomic(uint64_t)                  stolen;
+} x9_worker;
+
+typedef struct x9_executor_internal {
+  _Atomic(bool) stop   X9_ALIGN_TO_CL();
+  /* Only used by the submitter */
+  uint64_t next        X9_ALIGN_TO_CL();
+  x9_worker* workers   X9_ALIGN_TO_CL();
+  uint64_t             n_workers;
+  char*                name;
+  char                 pad[40];
+} x9_executor;
+
+typedef struct x9_stage {
+  /* Only written by the thread running the stage */
+  _Atomic(uint64_t) msgs X9_ALIGN_TO_CL();
+  x9_inbox*                input;
+  x9_inbox**               outputs;
+  uint64_t                 n_outputs;
+  x9_stage_fn              fn;
+  void*                    ctx;
+  uint64_t                 thread;
+  char*                    name;
+} x9_stage;
+
+typedef struct {
+  x9_stage**                stages;
+  uint64_t                  n_stages;
+  struct x9_graph_internal* graph;
+  pthread_t                 th;
+} x9_graph_thread;
+
+typedef struct x9_graph_internal {
+  _Atomic(bool) stop         X9_ALIGN_TO_CL();
+  x9_stage** stages          X9_ALIGN_TO_CL();
+  uint64_t                   n_stages;
+  x9_graph_thread*           threads;
+  uint64_t                   n_threads;
+  uint64_t*                  cores;
+  uint64_t                   batch;
+  char*                      name;
+  /* Written by the thread that starts and stops the 'graph', and read by
+   * 'x9_graph_stage_stats' from any thread */
+  _Atomic(bool)              running;
+  _Atomic(uint64_t)          started_ns;
+  _Atomic(uint64_t)          stopped_ns;
+} x9_graph;
+
+/* Prefix of the requests of a x9_channel. */
+typedef struct {
+  uint64_t id;
+} x9_call_header;
+
+/* Entry of the table of pending calls of a x9_channel, followed by the
+ * reply. Entries start on a cache line, which the reply shares with
+ * 'replied'. */
+typedef struct {
+  _Atomic(uint64_t) replied; /* Id of the last call replied to */
+  uint64_t          id;      /* Only used by the client, 0 if free */
+} x9_call_entry;
+
+typedef struct x9_channel_internal {
+  /* Only used by the client */
+  uint64_t next_id    X9_ALIGN_TO_CL();
+  void*               call; /* Where requests are prefixed by their id */
+  x9_inbox* requests  X9_ALIGN_TO_CL();
+  void*               entries;
+  uint64_t            sz;
+  uint64_t            constant;
+  uint64_t            entry_sz;
+  uint64_t            req_sz;
+  uint64_t            reply_sz;
+  char*               name;
+} x9_channel;
+
+/* Context of 'x9_serve_call'. */
+typedef struct {
+  x9_channel* chan;
+  x9_serve_fn fn;
+  void*       ctx;
+} x9_serve_ctx;
+
+/* Messages of a x9_journal are prefixed by their sequence number plus 1,
+ * written after the message, hence 0 (the files are zero filled) or any
+ * other value means that it was not (completely) written. */
+typedef struct {
+  _Atomic(uint64_t) seq;
+} x9_journal_header;
+
+typedef struct x9_journal_internal {
+  /* Only written by the writer */
+  _Atomic(uint64_t) write_seq X9_ALIGN_TO_CL();
+  char*                       write_base; /* Segment being written */
+  uint64_t                    write_seg;
+  uint64_t                    write_pos;  /* Within the segment */
+  /* Only written by the background thread */
+  _Atomic(uint64_t) synced    X9_ALIGN_TO_CL();
+  uint64_t                    n_mapped;
+  _Atomic(bool) stop          X9_ALIGN_TO_CL();
+  _Atomic(char*)* segs        X9_ALIGN_TO_CL();
+  uint64_t                    seg_sz;
+  uint64_t                    max_segs;
+  uint64_t                    msg_sz;
+  uint64_t                    record_sz;
+  uint64_t                    sync_interval_ms;
+  char*                       path;
+  pthread_t                   th;
+} x9_journal;
+
+typedef struct x9_journal_cursor_internal {
+  x9_journal* journal;
+  uint64_t    seq;
+  char*       base; /* Segment being read, NULL until it is mapped */
+  uint64_t    seg;
+  uint64_t    pos;  /* Within the segment */
+} x9_journal_cursor;
+
+/* Times a writer tries to claim a slot of the buffer of a x9_trace, when
+ * other writers claimed it first, before dropping the message from the
+ * trace. */
+#define X9_TRACE_RETRIES 4
+
+typedef struct x9_trace_internal {
+  /* Written by writers */
+  _Atomic(uint64_t) dropped X9_ALIGN_TO_CL();
+  /* Written by the background thread */
+  _Atomic(uint64_t) n_msgs  X9_ALIGN_TO_CL();
+  _Atomic(bool) stop        X9_ALIGN_TO_CL();
+  x9_inbox* buf             X9_ALIGN_TO_CL();
+  x9_inbox*                 inbox;
+  uint64_t                  msg_sz;
+  uint64_t                  record_sz; /* TSC + msg */
+  char*                     record;    /* Only used by the background thread */
+  FILE*                     file;
+  pthread_t                 th;
+} x9_trace;
 
 /* --- Internal functions --- */
 
+/* Slot of the 'inbox' that its (ever increasing) index 'idx' points to. */
+static inline uint64_t x9_slot_idx(x9_inbox const* const inbox,
+                                   uint64_t const        idx) {
+  return x9_fastmod(idx, inbox->constant, inbox->sz);
+}
+
 static inline uint64_t x9_load_idx(x9_inbox* const inbox,
                                    bool const      read_idx) {
-  /* From paper: Faster Remainder by Direct Computation, Lemire et al */
-  register uint64_t const low_bits =
-      inbox->constant *
-      (read_idx ? atomic_load_explicit(&inbox->read_idx, __ATOMIC_RELAXED)
-                : atomic_load_explicit(&inbox->write_idx, __ATOMIC_RELAXED));
-  return ((__uint128_t)low_bits * inbox->sz) >> 64;
+  return x9_slot_idx(
+      inbox,
+      read_idx ? atomic_load_explicit(&inbox->read_idx, __ATOMIC_RELAXED)
+               : atomic_load_explicit(&inbox->write_idx, __ATOMIC_RELAXED));
 }
 
 static inline uint64_t x9_increment_idx(x9_inbox* const inbox,
                                         bool const      read_idx) {
-  /* From paper: Faster Remainder by Direct Computation, Lemire et al */
-  register uint64_t const low_bits =
-      inbox->constant *
-      (read_idx
-           ? atomic_fetch_add_explicit(&inbox->read_idx, 1, __ATOMIC_RELAXED)
-           : atomic_fetch_add_explicit(&inbox->write_idx, 1,
-                                       __ATOMIC_RELAXED));
-  return ((__uint128_t)low_bits * inbox->sz) >> 64;
+  return x9_slot_idx(
+      inbox,
+      read_idx
+          ? atomic_fetch_add_explicit(&inbox->read_idx, 1, __ATOMIC_RELAXED)
+          : atomic_fetch_add_explicit(&inbox->write_idx, 1, __ATOMIC_RELAXED));
 }
 
 static inline void* x9_header_ptr(x9_inbox const* const inbox,
@@ -111,8 +347,132 @@ static inline void* x9_header_ptr(x9_inbox const* const inbox,
   return &((char*)inbox->msgs)[idx * (inbox->msg_sz + sizeof(x9_msg_header))];
 }
 
+#ifdef X9_LATENCY
+/* Highest value (in TSC cycles) that falls in bucket 'idx'. */
+static inline uint64_t x9_lat_bucket_max(uint64_t const idx) {
+  if (idx < X9_LAT_SUB) { return idx; }
+  uint64_t const shift = (idx >> X9_LAT_SUB_BITS) - 1;
+  uint64_t const base  = (idx & (X9_LAT_SUB - 1)) + X9_LAT_SUB;
+  return ((base + 1) << shift) - 1;
+}
+
+#endif
+
+#ifdef X9_TRACE
+/* Copies the 'msg' and the current TSC to a free slot of the buffer of the
+ * 'trace', without waiting for one.
+ * Writers claim the write index itself, and only while it is less than
+ * 'sz' ahead of the read index, that is, while the slot it points to was
+ * already read by the background thread. Hence concurrent writers never
+ * claim the same slot, and every claimed slot is written, otherwise the
+ * background thread would stop at it. Only contention on the index is
+ * retried, a full buffer drops the message right away. */
+static void x9_trace_record(x9_trace* const trace,
+                            void const* restrict const msg) {
+  x9_inbox* const buf = trace->buf;
+  for (uint64_t k = 0; k != X9_TRACE_RETRIES; ++k) {
+    /* Loaded first, so that it can't be ahead of 'w'. */
+    uint64_t const r = atomic_load_explicit(&buf->read_idx, __ATOMIC_ACQUIRE);
+    uint64_t       w = atomic_load_explicit(&buf->write_idx, __ATOMIC_RELAXED);
+    if ((w - r) >= buf->sz) { break; }
+    if (!atomic_compare_exchange_strong_explicit(&buf->write_idx, &w, w + 1,
+                                                 __ATOMIC_RELAXED,
+                                                 __ATOMIC_RELAXED)) {
+      continue;
+    }
+    x9_msg_header* const header = x9_header_ptr(buf, x9_slot_idx(buf, w));
+    char* const          record = (char*)header + sizeof(x9_msg_header);
+    uint64_t const       tsc    = __rdtsc();
+    memcpy(record, &tsc, sizeof(uint64_t));
+    memcpy(record + sizeof(uint64_t), msg, trace->msg_sz);
+    atomic_store_explicit(&header->slot_has_data, true, __ATOMIC_RELAXED);
+    atomic_store_explicit(&header->msg_written, true, __ATOMIC_RELEASE);
+    return;
+  }
+  atomic_fetch_add_explicit(&trace->dropped, 1, __ATOMIC_RELAXED);
+}
+
+/* 'trace_refs' is taken before loading the trace again, so that
+ * 'x9_trace_stop', which clears it first, waits for this writer. */
+void x9_trace_msg_slow(x9_inbox* const inbox, void const* restrict const msg) {
+  atomic_fetch_add_explicit(&inbox->trace_refs, 1, __ATOMIC_SEQ_CST);
+  x9_trace* const trace = atomic_load_explicit(&inbox->trace, __ATOMIC_SEQ_CST);
+  if (NULL != trace) { x9_trace_record(trace, msg); }
+  atomic_fetch_sub_explicit(&inbox->trace_refs, 1, __ATOMIC_RELEASE);
+}
+#endif
+
+/* Nanoseconds per TSC cycle, 0 until 'x9_calibrate_tsc' is called. */
+static _Atomic(double) x9_tsc_ns_per_cycle = 0;
+
+static inline bool x9_inbox_has_unread_msg(x9_inbox* const inbox) {
+  register uint64_t const       idx    = x9_load_idx(inbox, true);
+  register x9_msg_header* const header = x9_header_ptr(inbox, idx);
+  return atomic_load_explicit(&header->msg_written, __ATOMIC_ACQUIRE);
+}
+
+static inline x9_key_header* x9_key_header_ptr(
+    x9_conflating_inbox const* const inbox, uint64_t const idx) {
+  return (x9_key_header*)&(
+      (char*)inbox->slots)[idx * (inbox->msg_sz + sizeof(x9_key_header))];
+}
+
+static inline void x9_lock_key(x9_key_header* const header) {
+  for (;;) {
+    bool f = false;
+    if (atomic_compare_exchange_weak_explicit(&header->locked, &f, true,
+                                              __ATOMIC_ACQUIRE,
+                                              __ATOMIC_RELAXED)) {
+      return;
+    }
+    _mm_pause();
+  }
+}
+
+/* Returns the index of the slot owned by 'key', claiming an empty one if the
+ * 'key' was never written before, or UINT64_MAX if all 'n_keys' slots are
+ * owned by other keys. */
+static uint64_t x9_find_key_slot(x9_conflating_inbox* const inbox,
+                                 uint64_t const             key) {
+  /* Fibonacci hashing, 'n_slots' is a power of 2 */
+  register uint64_t idx = (key * UINT64_C(0x9E3779B97F4A7C15)) >> inbox->shift;
+
+  for (;;) {
+    x9_key_header* const header = x9_key_header_ptr(inbox, idx);
+    uint8_t state = atomic_load_explicit(&header->state, __ATOMIC_ACQUIRE);
+
+    if (X9_KEY_EMPTY == state) {
+      if (atomic_fetch_add_explicit(&inbox->n_keys_used, 1,
+                                    __ATOMIC_RELAXED) >= inbox->n_keys) {
+        atomic_fetch_sub_explicit(&inbox->n_keys_used, 1, __ATOMIC_RELAXED);
+        return UINT64_MAX;
+      }
+      if (atomic_compare_exchange_strong_explicit(
+              &header->state, &state, X9_KEY_CLAIMED, __ATOMIC_ACQUIRE,
+              __ATOMIC_ACQUIRE)) {
+        header->key = key;
+        atomic_store_explicit(&header->state, X9_KEY_READY, __ATOMIC_RELEASE);
+        return idx;
+      }
+      /* Lost the race for this slot, check who won it. */
+      atomic_fetch_sub_explicit(&inbox->n_keys_used, 1, __ATOMIC_RELAXED);
+      continue;
+    }
+
+    if (X9_KEY_CLAIMED == state) {
+      _mm_pause();
+      continue;
+    }
+
+    if (key == header->key) { return idx; }
+    idx = (idx + 1) & (inbox->n_slots - 1);
+  }
+}
+
 /* --- Public functions --- */
 
+void X9_LAYOUT(void) {}
+
 x9_inbox* x9_create_inbox(uint64_t const sz,
                           char const* restrict const name,
                           uint64_t const msg_sz) {
@@ -130,7 +490,13 @@ x9_inbox* x9_create_inbox(uint64_t const sz,
   void* msgs = calloc(sz, msg_sz + sizeof(x9_msg_header));
   if (NULL == msgs) { goto inbox_msgs_allocation_failed; }
 
-  inbox->constant = UINT64_C(0xFFFFFFFFFFFFFFFF) / sz + 1;
+#ifdef X9_LATENCY
+  _Atomic(uint64_t)* latency = calloc(X9_LAT_BUCKETS, sizeof(uint64_t));
+  if (NULL == latency) { goto inbox_latency_allocation_failed; }
+  inbox->latency = latency;
+#endif
+
+  inbox->constant = X9_FASTMOD_CONSTANT(sz);
   inbox->name     = ibx_name;
   inbox->msgs     = msgs;
   inbox->sz       = sz;
@@ -163,6 +529,17 @@ inbox_msgs_allocation_failed:
   free(ibx_name);
   free(inbox);
   return NULL;
+
+#ifdef X9_LATENCY
+inbox_latency_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("INBOX_LATENCY_ALLOCATION_FAILED");
+#endif
+  free(msgs);
+  free(ibx_name);
+  free(inbox);
+  return NULL;
+#endif
 }
 
 bool x9_inbox_is_valid(x9_inbox const* const inbox) {
@@ -175,6 +552,9 @@ bool x9_inbox_name_is(x9_inbox const* const inbox,
 }
 
 void x9_free_inbox(x9_inbox* const inbox) {
+#ifdef X9_LATENCY
+  free(inbox->latency);
+#endif
   free(inbox->msgs);
   free(inbox->name);
   free(inbox);
@@ -278,6 +658,7 @@ bool x9_node_name_is(x9_node const* const node,
 }
 
 void x9_free_node(x9_node* const node) {
+  free(node->handlers);
   free(node->name);
   free(node->inboxes);
   free(node);
@@ -296,36 +677,161 @@ void x9_free_node_and_attached_inboxes(x9_node* const node) {
 bool x9_write_to_inbox(x9_inbox* const inbox,
                        uint64_t const  msg_sz,
                        void const* restrict const msg) {
-  bool                          f      = false;
-  register uint64_t const       idx    = x9_load_idx(inbox, false);
-  register x9_msg_header* const header = x9_header_ptr(inbox, idx);
-
-  if (atomic_compare_exchange_strong_explicit(&header->slot_has_data, &f, true,
-                                              __ATOMIC_ACQUIRE,
-                                              __ATOMIC_RELAXED)) {
-    memcpy((char*)header + sizeof(x9_msg_header), msg, msg_sz);
-    atomic_fetch_add_explicit(&inbox->write_idx, 1, __ATOMIC_RELEASE);
-    atomic_store_explicit(&header->msg_written, true, __ATOMIC_RELEASE);
-    return true;
-  }
-  return false;
+  return x9_write_to_inbox_inline(inbox, x9_shape_of(inbox), msg_sz, msg);
 }
 
 void x9_write_to_inbox_spin(x9_inbox* const inbox,
                             uint64_t const  msg_sz,
                             void const* restrict const msg) {
-  for (;;) {
-    bool                          f      = false;
-    register uint64_t const       idx    = x9_increment_idx(inbox, false);
-    register x9_msg_header* const header = x9_header_ptr(inbox, idx);
-    if (atomic_compare_exchange_weak_explicit(&header->slot_has_data, &f, true,
-                                              __ATOMIC_ACQUIRE,
+  x9_write_to_inbox_spin_inline(inbox, x9_shape_of(inbox), msg_sz, msg);
+}
+
+uint64_t x9_inbox_sz(x9_inbox const* const inbox) { return inbox->sz; }
+
+uint64_t x9_inbox_slot_sz(x9_inbox const* const inbox) {
+  return inbox->msg_sz + sizeof(x9_msg_header);
+}
+
+uint64_t x9_inbox_depth_approx(x9_inbox* const inbox) {
+  /* Read 'read_idx' first, so that a concurrent read can only make the
+   * result larger than the real depth, never wrap it around. */
+  uint64_t const r = atomic_load_explicit(&inbox->read_idx, __ATOMIC_RELAXED);
+  uint64_t const w = atomic_load_explicit(&inbox->write_idx, __ATOMIC_RELAXED);
+
+  /* The spinning functions increment the indexes before a message is
+   * written/read, so 'w - r' can be outside of [0, sz]. */
+  uint64_t const depth = (w > r) ? ((w - r) < inbox->sz ? (w - r) : inbox->sz)
+                                 : 0;
+
+  uint64_t hwm = atomic_load_explicit(&inbox->depth_hwm, __ATOMIC_RELAXED);
+  while (depth > hwm) {
+    if (atomic_compare_exchange_weak_explicit(&inbox->depth_hwm, &hwm, depth,
+                                              __ATOMIC_RELAXED,
                                               __ATOMIC_RELAXED)) {
-      memcpy((char*)header + sizeof(x9_msg_header), msg, msg_sz);
-      atomic_store_explicit(&header->msg_written, true, __ATOMIC_RELEASE);
       break;
     }
   }
+  return depth;
+}
+
+uint64_t x9_inbox_depth_hwm(x9_inbox const* const inbox) {
+  return atomic_load_explicit(&inbox->depth_hwm, __ATOMIC_RELAXED);
+}
+
+uint64_t x9_inbox_reset_depth_hwm(x9_inbox* const inbox) {
+  return atomic_exchange_explicit(&inbox->depth_hwm, 0, __ATOMIC_RELAXED);
+}
+
+void x9_calibrate_tsc(void) {
+  struct timespec tic = {0};
+  struct timespec toc = {0};
+  struct timespec nap = {.tv_nsec = 50000000};
+
+  clock_gettime(CLOCK_MONOTONIC, &tic);
+  uint64_t const tsc_tic = __rdtsc();
+  nanosleep(&nap, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &toc);
+  uint64_t const tsc_toc = __rdtsc();
+
+  double const ns = ((double)(toc.tv_sec - tic.tv_sec) * 1e9) +
+                    (double)(toc.tv_nsec - tic.tv_nsec);
+  atomic_store(&x9_tsc_ns_per_cycle, ns / (double)(tsc_toc - tsc_tic));
+}
+
+double x9_ns_per_cycle(void) { return atomic_load(&x9_tsc_ns_per_cycle); }
+
+uint64_t x9_inbox_latency_count(x9_inbox const* const inbox) {
+  uint64_t count = 0;
+#ifdef X9_LATENCY
+  for (uint64_t k = 0; k != X9_LAT_BUCKETS; ++k) {
+    count += atomic_load_explicit(&inbox->latency[k], __ATOMIC_RELAXED);
+  }
+#else
+  (void)inbox;
+#endif
+  return count;
+}
+
+void x9_inbox_latency_percentiles_ns(x9_inbox const* const inbox,
+                                     uint64_t const        n,
+                                     double const* restrict const percentiles,
+                                     double* restrict const outparam) {
+  for (uint64_t j = 0; j != n; ++j) { outparam[j] = 0; }
+#ifdef X9_LATENCY
+  double const ns_per_cycle = atomic_load(&x9_tsc_ns_per_cycle);
+  if (0 == ns_per_cycle) { return; }
+
+  /* Readers keep recording while this runs, hence the walk below may see
+   * more latencies than were counted, which only makes it stop earlier. */
+  uint64_t const count = x9_inbox_latency_count(inbox);
+  if (!count) { return; }
+
+  uint64_t seen = 0;
+  uint64_t j    = 0;
+  for (uint64_t k = 0; (k != X9_LAT_BUCKETS) && (j != n); ++k) {
+    seen += atomic_load_explicit(&inbox->latency[k], __ATOMIC_RELAXED);
+    /* 'percentiles' are sorted, so all the ones within this bucket are
+     * resolved before moving to the next. */
+    for (; j != n; ++j) {
+      double const p = (percentiles[j] < 0)     ? 0
+                       : (percentiles[j] > 100) ? 100
+                                                : percentiles[j];
+      uint64_t target = (uint64_t)((p / 100.0) * (double)count + 0.5);
+      if (!target) { target = 1; }
+      if (seen < target) { break; }
+      outparam[j] = (double)x9_lat_bucket_max(k) * ns_per_cycle;
+    }
+  }
+#else
+  (void)inbox;
+  (void)percentiles;
+#endif
+}
+
+double x9_inbox_latency_percentile_ns(x9_inbox const* const inbox,
+                                      double const          percentile) {
+  double result = 0;
+  x9_inbox_latency_percentiles_ns(inbox, 1, &percentile, &result);
+  return result;
+}
+
+void x9_inbox_latency_reset(x9_inbox* const inbox) {
+#ifdef X9_LATENCY
+  for (uint64_t k = 0; k != X9_LAT_BUCKETS; ++k) {
+    atomic_store_explicit(&inbox->latency[k], 0, __ATOMIC_RELAXED);
+  }
+#else
+  (void)inbox;
+#endif
+}
+
+bool x9_inbox_stats(x9_inbox const* const             inbox,
+                    x9_inbox_counters* restrict const outparam) {
+#ifdef X9_STATS
+  x9_producer_stats const* const p = &inbox->producer_stats;
+  x9_consumer_stats const* const c = &inbox->consumer_stats;
+
+  *outparam = (x9_inbox_counters){
+      .writes = atomic_load_explicit(&p->writes, __ATOMIC_RELAXED),
+      .write_failures =
+          atomic_load_explicit(&p->write_failures, __ATOMIC_RELAXED),
+      .write_cas_failures =
+          atomic_load_explicit(&p->write_cas_failures, __ATOMIC_RELAXED),
+      .write_spins = atomic_load_explicit(&p->write_spins, __ATOMIC_RELAXED),
+      .full_events = atomic_load_explicit(&p->full_events, __ATOMIC_RELAXED),
+      .reads       = atomic_load_explicit(&c->reads, __ATOMIC_RELAXED),
+      .read_failures =
+          atomic_load_explicit(&c->read_failures, __ATOMIC_RELAXED),
+      .read_cas_failures =
+          atomic_load_explicit(&c->read_cas_failures, __ATOMIC_RELAXED),
+      .read_spins   = atomic_load_explicit(&c->read_spins, __ATOMIC_RELAXED),
+      .empty_events = atomic_load_explicit(&c->empty_events, __ATOMIC_RELAXED)};
+  return true;
+#else
+  (void)inbox;
+  memset(outparam, 0, sizeof(x9_inbox_counters));
+  return false;
+#endif
 }
 
 void x9_broadcast_msg_to_all_node_inboxes(x9_node const* const node,
@@ -339,86 +845,2228 @@ void x9_broadcast_msg_to_all_node_inboxes(x9_node const* const node,
 bool x9_read_from_inbox(x9_inbox* const inbox,
                         uint64_t const  msg_sz,
                         void* restrict const outparam) {
-  register uint64_t const       idx    = x9_load_idx(inbox, true);
-  register x9_msg_header* const header = x9_header_ptr(inbox, idx);
-
-  if (atomic_load_explicit(&header->slot_has_data, __ATOMIC_RELAXED)) {
-    if (atomic_load_explicit(&header->msg_written, __ATOMIC_ACQUIRE)) {
-      memcpy(outparam, (char*)header + sizeof(x9_msg_header), msg_sz);
-      atomic_store_explicit(&header->msg_written, false, __ATOMIC_RELAXED);
-      atomic_store_explicit(&header->slot_has_data, false, __ATOMIC_RELEASE);
-      atomic_fetch_add_explicit(&inbox->read_idx, 1, __ATOMIC_RELEASE);
-      return true;
-    }
-  }
-  return false;
+  return x9_read_from_inbox_inline(inbox, x9_shape_of(inbox), msg_sz,
+                                   outparam);
 }
 
 void x9_read_from_inbox_spin(x9_inbox* const inbox,
                              uint64_t const  msg_sz,
                              void* restrict const outparam) {
-  register uint64_t const       idx    = x9_increment_idx(inbox, true);
-  register x9_msg_header* const header = x9_header_ptr(inbox, idx);
-
-  for (;;) {
-    _mm_pause();
-    if (atomic_load_explicit(&header->slot_has_data, __ATOMIC_RELAXED)) {
-      if (atomic_load_explicit(&header->msg_written, __ATOMIC_ACQUIRE)) {
-        memcpy(outparam, (char*)header + sizeof(x9_msg_header), msg_sz);
-        atomic_store_explicit(&header->msg_written, false, __ATOMIC_RELAXED);
-        atomic_store_explicit(&header->slot_has_data, false, __ATOMIC_RELEASE);
-        return;
-      }
-    }
-  }
+  x9_read_from_inbox_spin_inline(inbox, x9_shape_of(inbox), msg_sz, outparam);
 }
 
 bool x9_read_from_shared_inbox(x9_inbox* const inbox,
                                uint64_t const  msg_sz,
                                void* restrict const outparam) {
-  bool                          f      = false;
-  register uint64_t const       idx    = x9_load_idx(inbox, true);
-  register x9_msg_header* const header = x9_header_ptr(inbox, idx);
+  return x9_read_from_shared_inbox_inline(inbox, x9_shape_of(inbox), msg_sz,
+                                          outparam);
+}
 
-  if (atomic_compare_exchange_strong_explicit(
-          &header->shared, &f, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
-    if (atomic_load_explicit(&header->slot_has_data, __ATOMIC_RELAXED)) {
-      if (atomic_load_explicit(&header->msg_written, __ATOMIC_ACQUIRE)) {
-        memcpy(outparam, (char*)header + sizeof(x9_msg_header), msg_sz);
-        atomic_fetch_add_explicit(&inbox->read_idx, 1, __ATOMIC_RELEASE);
-        atomic_store_explicit(&header->msg_written, false, __ATOMIC_RELAXED);
-        atomic_store_explicit(&header->slot_has_data, false, __ATOMIC_RELEASE);
-        atomic_store_explicit(&header->shared, false, __ATOMIC_RELEASE);
-        return true;
-      }
+void x9_read_from_shared_inbox_spin(x9_inbox* const inbox,
+                                    uint64_t const  msg_sz,
+                                    void* restrict const outparam) {
+  x9_read_from_shared_inbox_spin_inline(inbox, x9_shape_of(inbox), msg_sz,
+                                        outparam);
+}
+
+bool x9_node_register_handler(x9_node* const      node,
+                              x9_inbox* const     inbox,
+                              x9_handler_fn const fn,
+                              void* const         ctx) {
+  bool attached = false;
+  for (uint64_t k = 0; k != node->n_inboxes; ++k) {
+    if (inbox == node->inboxes[k]) { attached = true; }
+  }
+  if (!attached) { goto node_does_not_contain_inbox; }
+
+  for (uint64_t k = 0; k != node->n_handlers; ++k) {
+    if (inbox == node->handlers[k].inbox) {
+      node->handlers[k].fn  = fn;
+      node->handlers[k].ctx = ctx;
+      return true;
     }
-    atomic_store_explicit(&header->shared, false, __ATOMIC_RELEASE);
   }
+
+  /* At most one per inbox */
+  if (NULL == node->handlers) {
+    node->handlers = calloc(node->n_inboxes, sizeof(x9_handler));
+    if (NULL == node->handlers) { goto node_handlers_allocation_failed; }
+  }
+  node->handlers[node->n_handlers++] =
+      (x9_handler){.inbox = inbox, .fn = fn, .ctx = ctx};
+  return true;
+
+node_does_not_contain_inbox:
+#ifdef X9_DEBUG
+  x9_print_error_msg("NODE_DOES_NOT_CONTAIN_INBOX");
+#endif
+  return false;
+
+node_handlers_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("NODE_HANDLERS_ALLOCATION_FAILED");
+#endif
   return false;
 }
 
-void x9_read_from_shared_inbox_spin(x9_inbox* const inbox,
-                                    uint64_t const  msg_sz,
-                                    void* restrict const outparam) {
-  for (;;) {
-    bool                          f      = false;
-    register uint64_t const       idx    = x9_increment_idx(inbox, true);
+/* Calls 'fn' with each message of the 'inbox' that is ready, in place,
+ * until 'budget' messages were handled or there are none left, and returns
+ * their number.
+ * Single reader, hence the read index is kept locally and only published
+ * once for the whole batch. */
+static uint64_t x9_drain_inbox(x9_inbox* const     inbox,
+                               uint64_t const      budget,
+                               x9_handler_fn const fn,
+                               void* const         ctx) {
+  uint64_t const read_idx =
+      atomic_load_explicit(&inbox->read_idx, __ATOMIC_RELAXED);
+  register uint64_t idx = x9_load_idx(inbox, true);
+  uint64_t          n   = 0;
+
+  for (; n != budget; ++n) {
     register x9_msg_header* const header = x9_header_ptr(inbox, idx);
+    if (!atomic_load_explicit(&header->slot_has_data, __ATOMIC_RELAXED)) {
+      X9_STATS_INC(inbox, consumer_stats, empty_events);
+      break;
+    }
+    if (!atomic_load_explicit(&header->msg_written, __ATOMIC_ACQUIRE)) { break; }
+    x9_record_latency(inbox, header);
+    fn((char*)header + sizeof(x9_msg_header), ctx);
+    atomic_store_explicit(&header->msg_written, false, __ATOMIC_RELAXED);
+    atomic_store_explicit(&header->slot_has_data, false, __ATOMIC_RELEASE);
+    idx = (idx + 1 == inbox->sz) ? 0 : idx + 1;
+  }
 
-    if (atomic_compare_exchange_strong_explicit(
-            &header->shared, &f, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
-      if (atomic_load_explicit(&header->slot_has_data, __ATOMIC_RELAXED)) {
-        if (atomic_load_explicit(&header->msg_written, __ATOMIC_ACQUIRE)) {
-          memcpy(outparam, (char*)header + sizeof(x9_msg_header), msg_sz);
-          atomic_store_explicit(&header->msg_written, false, __ATOMIC_RELAXED);
-          atomic_store_explicit(&header->slot_has_data, false,
-                                __ATOMIC_RELEASE);
-          atomic_store_explicit(&header->shared, false, __ATOMIC_RELEASE);
-          return;
-        }
-      }
-      atomic_store_explicit(&header->shared, false, __ATOMIC_RELEASE);
+  if (n) {
+    atomic_store_explicit(&inbox->read_idx, read_idx + n, __ATOMIC_RELEASE);
+    X9_STATS_ADD(inbox, consumer_stats, reads, n);
+  }
+  return n;
+}
+
+uint64_t x9_node_run(x9_node* const node, uint64_t const budget) {
+  uint64_t const n_handlers = node->n_handlers;
+  if (!n_handlers) { return 0; }
+
+  /* Rotating the first handler keeps a continuously fed inbox from starving
+   * the ones registered after it. */
+  uint64_t const first = node->cursor;
+  node->cursor         = (first + 1 == n_handlers) ? 0 : first + 1;
+
+  uint64_t n = 0;
+  for (;;) {
+    uint64_t const start = n;
+    for (uint64_t j = 0; (j != n_handlers) && (n != budget); ++j) {
+      uint64_t const k = (first + j < n_handlers) ? (first + j)
+                                                  : (first + j - n_handlers);
+      x9_handler const* const h = &node->handlers[k];
+      n += x9_drain_inbox(h->inbox, budget - n, h->fn, h->ctx);
     }
+    /* Out of budget, or nothing was ready in a whole round. */
+    if ((n == budget) || (n == start)) { return n; }
+  }
+}
+
+x9_prio_inbox* x9_create_prio_inbox(uint64_t const n_lanes,
+                                    uint64_t const sz,
+                                    char const* restrict const name,
+                                    uint64_t const msg_sz) {
+  if (!((n_lanes > 0) && (n_lanes <= X9_PRIO_INBOX_MAX_LANES))) {
+    goto prio_inbox_incorrect_number_of_lanes;
+  }
+
+  x9_prio_inbox* inbox = aligned_alloc(X9_CL_SIZE, sizeof(x9_prio_inbox));
+  if (NULL == inbox) { goto prio_inbox_allocation_failed; }
+  memset(inbox, 0, sizeof(x9_prio_inbox));
+
+  uint64_t const name_len = strlen(name);
+  char*          ibx_name = calloc(name_len + 1, sizeof(char));
+  if (NULL == ibx_name) { goto prio_inbox_name_allocation_failed; }
+  memcpy(ibx_name, name, name_len);
+  inbox->name = ibx_name;
+
+  x9_inbox** lanes = calloc(n_lanes, sizeof(x9_inbox*));
+  if (NULL == lanes) { goto prio_inbox_lanes_allocation_failed; }
+  inbox->lanes   = lanes;
+  inbox->n_lanes = n_lanes;
+
+  for (uint64_t k = 0; k != n_lanes; ++k) {
+    lanes[k] = x9_create_inbox(sz, name, msg_sz);
+    if (!x9_inbox_is_valid(lanes[k])) { goto prio_inbox_lane_invalid; }
+  }
+  return inbox;
+
+prio_inbox_incorrect_number_of_lanes:
+#ifdef X9_DEBUG
+  x9_print_error_msg("PRIO_INBOX_INCORRECT_NUMBER_OF_LANES");
+#endif
+  return NULL;
+
+prio_inbox_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("PRIO_INBOX_ALLOCATION_FAILED");
+#endif
+  return NULL;
+
+prio_inbox_name_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("PRIO_INBOX_NAME_ALLOCATION_FAILED");
+#endif
+  free(inbox);
+  return NULL;
+
+prio_inbox_lanes_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("PRIO_INBOX_LANES_ALLOCATION_FAILED");
+#endif
+  free(ibx_name);
+  free(inbox);
+  return NULL;
+
+prio_inbox_lane_invalid:
+#ifdef X9_DEBUG
+  x9_print_error_msg("PRIO_INBOX_LANE_INVALID");
+#endif
+  for (uint64_t k = 0; k != n_lanes; ++k) {
+    if (NULL != lanes[k]) { x9_free_inbox(lanes[k]); }
+  }
+  free(lanes);
+  free(ibx_name);
+  free(inbox);
+  return NULL;
+}
+
+bool x9_prio_inbox_is_valid(x9_prio_inbox const* const inbox) {
+  return !(NULL == inbox);
+}
+
+bool x9_prio_inbox_name_is(x9_prio_inbox const* const inbox,
+                           char const* restrict const cmp) {
+  return !strcmp(inbox->name, cmp) ? true : false;
+}
+
+void x9_free_prio_inbox(x9_prio_inbox* const inbox) {
+  for (uint64_t k = 0; k != inbox->n_lanes; ++k) {
+    x9_free_inbox(inbox->lanes[k]);
   }
+  free(inbox->lanes);
+  free(inbox->name);
+  free(inbox);
+}
+
+/* Loads the 'lanes_mask' of the 'inbox', ordered after the message the
+ * writer just published (a store followed by a load needs a full barrier).
+ * ThreadSanitizer does not support fences (gcc refuses them with -Wtsan),
+ * hence it gets a read-modify-write instead, which also pairs with the one
+ * that clears the bit in the reader. */
+static inline uint64_t x9_lanes_mask_after_write(
+    x9_prio_inbox* const inbox) {
+#ifdef __SANITIZE_THREAD__
+  return atomic_fetch_or_explicit(&inbox->lanes_mask, 0, __ATOMIC_SEQ_CST);
+#else
+  atomic_thread_fence(__ATOMIC_SEQ_CST);
+  return atomic_load_explicit(&inbox->lanes_mask, __ATOMIC_RELAXED);
+#endif
 }
 
+bool x9_write_to_prio_inbox(x9_prio_inbox* const inbox,
+                            uint64_t const       lane,
+                            uint64_t const       msg_sz,
+                            void const* restrict const msg) {
+  assert(lane < inbox->n_lanes);
+  if (x9_write_to_inbox(inbox->lanes[lane], msg_sz, msg)) {
+    /* Pairs with the clear and re-check of the reader, so that it can't
+     * clear the lane bit without seeing this message. The shared line is
+     * only written when the bit is clear, which is rare under load. */
+    uint64_t const bit = UINT64_C(1) << lane;
+    if (!(x9_lanes_mask_after_write(inbox) & bit)) {
+      atomic_fetch_or_explicit(&inbox->lanes_mask, bit, __ATOMIC_SEQ_CST);
+    }
+    return true;
+  }
+  return false;
+}
+
+void x9_write_to_prio_inbox_spin(x9_prio_inbox* const inbox,
+                                 uint64_t const       lane,
+                                 uint64_t const       msg_sz,
+                                 void const* restrict const msg) {
+  /* Retries the non spinning write instead of using 'x9_write_to_inbox_spin',
+   * as the latter may skip occupied slots, which the reader (that only moves
+   * forward after a successful read) would then wait on. */
+  while (!x9_write_to_prio_inbox(inbox, lane, msg_sz, msg)) { _mm_pause(); }
+}
+
+bool x9_read_from_prio_inbox(x9_prio_inbox* const inbox,
+                             uint64_t const       msg_sz,
+                             void* restrict const outparam) {
+  register uint64_t mask =
+      atomic_load_explicit(&inbox->lanes_mask, __ATOMIC_ACQUIRE);
+
+  while (mask) {
+    /* Lane 0 is the most urgent one, hence the lowest set bit wins. */
+    register uint64_t const lane = (uint64_t)__builtin_ctzll(mask);
+    register uint64_t const bit  = UINT64_C(1) << lane;
+    x9_inbox* const         ibx  = inbox->lanes[lane];
+
+    if (x9_read_from_inbox(ibx, msg_sz, outparam)) { return true; }
+
+    /* The lane looks drained: clear its bit and check again, since a writer
+     * may have published between the failed read and the clear. */
+    atomic_fetch_and_explicit(&inbox->lanes_mask, ~bit, __ATOMIC_SEQ_CST);
+#ifndef __SANITIZE_THREAD__
+    atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+    if (x9_inbox_has_unread_msg(ibx)) {
+      atomic_fetch_or_explicit(&inbox->lanes_mask, bit, __ATOMIC_SEQ_CST);
+    }
+    mask = atomic_load_explicit(&inbox->lanes_mask, __ATOMIC_ACQUIRE);
+  }
+  return false;
+}
+
+void x9_read_from_prio_inbox_spin(x9_prio_inbox* const inbox,
+                                  uint64_t const       msg_sz,
+                                  void* restrict const outparam) {
+  for (;;) {
+    if (x9_read_from_prio_inbox(inbox, msg_sz, outparam)) { return; }
+    _mm_pause();
+  }
+}
+
+x9_conflating_inbox* x9_create_conflating_inbox(
+    uint64_t const n_keys, char const* restrict const name,
+    uint64_t const msg_sz) {
+  if (!(n_keys > 0)) { goto conflating_inbox_incorrect_number_of_keys; }
+
+  x9_conflating_inbox* inbox =
+      aligned_alloc(X9_CL_SIZE, sizeof(x9_conflating_inbox));
+  if (NULL == inbox) { goto conflating_inbox_allocation_failed; }
+  memset(inbox, 0, sizeof(x9_conflating_inbox));
+
+  uint64_t const name_len = strlen(name);
+  char*          ibx_name = calloc(name_len + 1, sizeof(char));
+  if (NULL == ibx_name) { goto conflating_inbox_name_allocation_failed; }
+  memcpy(ibx_name, name, name_len);
+
+  /* Keep the hash table at most half full. */
+  uint64_t n_slots = 2;
+  uint64_t shift   = 63;
+  while (n_slots < (2 * n_keys)) {
+    n_slots *= 2;
+    --shift;
+  }
+
+  void* slots = calloc(n_slots, msg_sz + sizeof(x9_key_header));
+  if (NULL == slots) { goto conflating_inbox_slots_allocation_failed; }
+
+  /* A key is at most once in 'ready', hence it can never be full and
+   * 'x9_write_to_inbox_spin' never skips a slot. */
+  x9_inbox* ready =
+      x9_create_inbox(n_keys + 1 + ((n_keys + 1) % 2), name, sizeof(uint64_t));
+  if (!x9_inbox_is_valid(ready)) { goto conflating_inbox_ready_invalid; }
+
+  inbox->ready   = ready;
+  inbox->slots   = slots;
+  inbox->n_slots = n_slots;
+  inbox->shift   = shift;
+  inbox->n_keys  = n_keys;
+  inbox->msg_sz  = msg_sz;
+  inbox->name    = ibx_name;
+  return inbox;
+
+conflating_inbox_incorrect_number_of_keys:
+#ifdef X9_DEBUG
+  x9_print_error_msg("CONFLATING_INBOX_INCORRECT_NUMBER_OF_KEYS");
+#endif
+  return NULL;
+
+conflating_inbox_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("CONFLATING_INBOX_ALLOCATION_FAILED");
+#endif
+  return NULL;
+
+conflating_inbox_name_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("CONFLATING_INBOX_NAME_ALLOCATION_FAILED");
+#endif
+  free(inbox);
+  return NULL;
+
+conflating_inbox_slots_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("CONFLATING_INBOX_SLOTS_ALLOCATION_FAILED");
+#endif
+  free(ibx_name);
+  free(inbox);
+  return NULL;
+
+conflating_inbox_ready_invalid:
+#ifdef X9_DEBUG
+  x9_print_error_msg("CONFLATING_INBOX_READY_INVALID");
+#endif
+  free(slots);
+  free(ibx_name);
+  free(inbox);
+  return NULL;
+}
+
+bool x9_conflating_inbox_is_valid(x9_conflating_inbox const* const inbox) {
+  return !(NULL == inbox);
+}
+
+bool x9_conflating_inbox_name_is(x9_conflating_inbox const* const inbox,
+                                 char const* restrict const cmp) {
+  return !strcmp(inbox->name, cmp) ? true : false;
+}
+
+void x9_free_conflating_inbox(x9_conflating_inbox* const inbox) {
+  x9_free_inbox(inbox->ready);
+  free(inbox->slots);
+  free(inbox->name);
+  free(inbox);
+}
+
+bool x9_write_to_conflating_inbox(x9_conflating_inbox* const inbox,
+                                  uint64_t const             key,
+                                  uint64_t const             msg_sz,
+                                  void const* restrict const msg) {
+  uint64_t const idx = x9_find_key_slot(inbox, key);
+  if (UINT64_MAX == idx) { return false; }
+
+  x9_key_header* const header = x9_key_header_ptr(inbox, idx);
+  x9_lock_key(header);
+  memcpy((char*)header + sizeof(x9_key_header), msg, msg_sz);
+  atomic_store_explicit(&header->locked, false, __ATOMIC_RELEASE);
+
+  /* Only the write that turns the key dirty queues it, later writes just
+   * overwrite the value until the reader picks it up. */
+  if (!atomic_exchange_explicit(&header->pending, true, __ATOMIC_ACQ_REL)) {
+    x9_write_to_inbox_spin(inbox->ready, sizeof(uint64_t), &idx);
+  }
+  return true;
+}
+
+bool x9_read_from_conflating_inbox(x9_conflating_inbox* const inbox,
+                                   uint64_t const             msg_sz,
+                                   uint64_t* restrict const   key,
+                                   void* restrict const       outparam) {
+  uint64_t idx = 0;
+  if (!x9_read_from_inbox(inbox->ready, sizeof(uint64_t), &idx)) {
+    return false;
+  }
+
+  x9_key_header* const header = x9_key_header_ptr(inbox, idx);
+  /* Clear 'pending' before copying, so that a write racing with the copy
+   * queues the key again instead of being lost. */
+  atomic_store_explicit(&header->pending, false, __ATOMIC_SEQ_CST);
+  x9_lock_key(header);
+  memcpy(outparam, (char*)header + sizeof(x9_key_header), msg_sz);
+  atomic_store_explicit(&header->locked, false, __ATOMIC_RELEASE);
+  *key = header->key;
+  return true;
+}
+
+void x9_read_from_conflating_inbox_spin(x9_conflating_inbox* const inbox,
+                                        uint64_t const             msg_sz,
+                                        uint64_t* restrict const   key,
+                                        void* restrict const       outparam) {
+  for (;;) {
+    if (x9_read_from_conflating_inbox(inbox, msg_sz, key, outparam)) {
+      return;
+    }
+    _mm_pause();
+  }
+}
+
+/* Creates a segment of 'sz' slots, NULL if it failed. */
+static x9_segment* x9_create_segment(x9_elastic_inbox const* const inbox,
+                                     uint64_t const                sz) {
+  x9_segment* const seg = calloc(1, sizeof(x9_segment));
+  if (NULL == seg) { return NULL; }
+  seg->inbox = x9_create_inbox(sz, inbox->name, inbox->msg_sz);
+  if (!x9_inbox_is_valid(seg->inbox)) {
+    free(seg);
+    return NULL;
+  }
+  return seg;
+}
+
+/* Called by the writer, which from then on writes to a new segment of 'sz'
+ * slots. Returns 'false' if it could not be created. */
+static bool x9_link_segment(x9_elastic_inbox* const inbox,
+                            uint64_t const          sz) {
+  x9_segment* const seg = x9_create_segment(inbox, sz);
+  if (NULL == seg) { return false; }
+  atomic_fetch_add_explicit(&inbox->sz, sz, __ATOMIC_RELAXED);
+  /* Every write to the current segment happens before the reader sees
+   * 'next', hence it knows the segment is drained once it reads it empty
+   * after that. */
+  atomic_store_explicit(&inbox->write_seg->next, seg, __ATOMIC_RELEASE);
+  inbox->write_seg  = seg;
+  inbox->lap_writes = 0;
+  return true;
+}
+
+/* Called by the writer every 'sz' writes to the segment 'ibx', moves to a
+ * segment half as large if 'ibx' is at most a quarter full. */
+static void x9_end_of_lap(x9_elastic_inbox* const inbox,
+                          x9_inbox* const         ibx) {
+  inbox->lap_writes = 0;
+  if (ibx->sz == inbox->min_sz) { return; }
+
+  uint64_t const read = atomic_load_explicit(&ibx->read_idx, __ATOMIC_RELAXED);
+  uint64_t const written =
+      atomic_load_explicit(&ibx->write_idx, __ATOMIC_RELAXED);
+  if ((written - read) > (ibx->sz / 4)) { return; }
+
+  uint64_t sz = (ibx->sz / 2) + ((ibx->sz / 2) % 2);
+  if (sz < inbox->min_sz) { sz = inbox->min_sz; }
+  /* Failing to shrink is harmless, the current segment is kept. */
+  x9_link_segment(inbox, sz);
+}
+
+x9_elastic_inbox* x9_create_elastic_inbox(uint64_t const min_sz,
+                                          uint64_t const max_sz,
+                                          char const* restrict const name,
+                                          uint64_t const msg_sz) {
+  if (!((min_sz > 0) && !(min_sz % 2) && (max_sz >= min_sz) &&
+        !(max_sz % 2))) {
+    goto elastic_inbox_incorrect_size;
+  }
+
+  x9_elastic_inbox* inbox =
+      aligned_alloc(X9_CL_SIZE, sizeof(x9_elastic_inbox));
+  if (NULL == inbox) { goto elastic_inbox_allocation_failed; }
+  memset(inbox, 0, sizeof(x9_elastic_inbox));
+
+  uint64_t const name_len = strlen(name);
+  char*          ibx_name = calloc(name_len + 1, sizeof(char));
+  if (NULL == ibx_name) { goto elastic_inbox_name_allocation_failed; }
+  memcpy(ibx_name, name, name_len);
+
+  inbox->min_sz = min_sz;
+  inbox->max_sz = max_sz;
+  inbox->msg_sz = msg_sz;
+  inbox->name   = ibx_name;
+
+  x9_segment* const seg = x9_create_segment(inbox, min_sz);
+  if (NULL == seg) { goto elastic_inbox_segment_invalid; }
+
+  inbox->write_seg = seg;
+  inbox->read_seg  = seg;
+  atomic_init(&inbox->sz, min_sz);
+  return inbox;
+
+elastic_inbox_incorrect_size:
+#ifdef X9_DEBUG
+  x9_print_error_msg("ELASTIC_INBOX_INCORRECT_SIZE");
+#endif
+  return NULL;
+
+elastic_inbox_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("ELASTIC_INBOX_ALLOCATION_FAILED");
+#endif
+  return NULL;
+
+elastic_inbox_name_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("ELASTIC_INBOX_NAME_ALLOCATION_FAILED");
+#endif
+  free(inbox);
+  return NULL;
+
+elastic_inbox_segment_invalid:
+#ifdef X9_DEBUG
+  x9_print_error_msg("ELASTIC_INBOX_SEGMENT_INVALID");
+#endif
+  free(ibx_name);
+  free(inbox);
+  return NULL;
+}
+
+bool x9_elastic_inbox_is_valid(x9_elastic_inbox const* const inbox) {
+  return !(NULL == inbox);
+}
+
+bool x9_elastic_inbox_name_is(x9_elastic_inbox const* const inbox,
+                              char const* restrict const cmp) {
+  return !strcmp(inbox->name, cmp) ? true : false;
+}
+
+void x9_free_elastic_inbox(x9_elastic_inbox* const inbox) {
+  x9_segment* seg = inbox->read_seg;
+  while (NULL != seg) {
+    x9_segment* const next =
+        atomic_load_explicit(&seg->next, __ATOMIC_RELAXED);
+    x9_free_inbox(seg->inbox);
+    free(seg);
+    seg = next;
+  }
+  free(inbox->name);
+  free(inbox);
+}
+
+uint64_t x9_elastic_inbox_sz(x9_elastic_inbox const* const inbox) {
+  return atomic_load_explicit(&inbox->sz, __ATOMIC_RELAXED);
+}
+
+bool x9_write_to_elastic_inbox(x9_elastic_inbox* const inbox,
+                               uint64_t const          msg_sz,
+                               void const* restrict const msg) {
+  x9_inbox* const ibx = inbox->write_seg->inbox;
+
+  if (x9_write_to_inbox(ibx, msg_sz, msg)) {
+    if (++inbox->lap_writes == ibx->sz) { x9_end_of_lap(inbox, ibx); }
+    return true;
+  }
+
+  if (ibx->sz == inbox->max_sz) { return false; }
+  uint64_t const sz =
+      ((2 * ibx->sz) > inbox->max_sz) ? inbox->max_sz : (2 * ibx->sz);
+  if (!x9_link_segment(inbox, sz)) { return false; }
+  /* Always succeeds, the new segment is empty. */
+  return x9_write_to_inbox(inbox->write_seg->inbox, msg_sz, msg);
+}
+
+void x9_write_to_elastic_inbox_spin(x9_elastic_inbox* const inbox,
+                                    uint64_t const          msg_sz,
+                                    void const* restrict const msg) {
+  while (!x9_write_to_elastic_inbox(inbox, msg_sz, msg)) { _mm_pause(); }
+}
+
+bool x9_read_from_elastic_inbox(x9_elastic_inbox* const inbox,
+                                uint64_t const          msg_sz,
+                                void* restrict const    outparam) {
+  for (;;) {
+    x9_segment* const seg = inbox->read_seg;
+    if (x9_read_from_inbox(seg->inbox, msg_sz, outparam)) { return true; }
+
+    x9_segment* const next =
+        atomic_load_explicit(&seg->next, __ATOMIC_ACQUIRE);
+    if (NULL == next) { return false; }
+
+    /* Messages written right before the writer moved on are visible now. */
+    if (x9_read_from_inbox(seg->inbox, msg_sz, outparam)) { return true; }
+
+    /* Drained, and the writer will never touch it again. */
+    inbox->read_seg = next;
+    atomic_fetch_sub_explicit(&inbox->sz, seg->inbox->sz, __ATOMIC_RELAXED);
+    x9_free_inbox(seg->inbox);
+    free(seg);
+  }
+}
+
+void x9_read_from_elastic_inbox_spin(x9_elastic_inbox* const inbox,
+                                     uint64_t const          msg_sz,
+                                     void* restrict const    outparam) {
+  for (;;) {
+    if (x9_read_from_elastic_inbox(inbox, msg_sz, outparam)) { return; }
+    _mm_pause();
+  }
+}
+
+static inline x9_lossy_header* x9_lossy_header_ptr(
+    x9_lossy_inbox const* const inbox, uint64_t const position) {
+  /* From paper: Faster Remainder by Direct Computation, Lemire et al */
+  register uint64_t const low_bits = inbox->constant * position;
+  register uint64_t const idx = ((__uint128_t)low_bits * inbox->sz) >> 64;
+  return (x9_lossy_header*)&((char*)inbox->slots)[idx * inbox->slot_sz];
+}
+
+static inline void x9_store_words(_Atomic(uint64_t)* const dst,
+                                  void const* restrict const src,
+                                  uint64_t const             sz) {
+  for (uint64_t k = 0; (8 * k) < sz; ++k) {
+    uint64_t word = 0;
+    memcpy(&word, (char const*)src + (8 * k), (sz - (8 * k)) < 8 ? sz % 8 : 8);
+    atomic_store_explicit(&dst[k], word, __ATOMIC_RELAXED);
+  }
+}
+
+static inline void x9_load_words(_Atomic(uint64_t)* const src,
+                                 void* restrict const     outparam,
+                                 uint64_t const           sz) {
+  for (uint64_t k = 0; (8 * k) < sz; ++k) {
+    uint64_t const word = atomic_load_explicit(&src[k], __ATOMIC_RELAXED);
+    memcpy((char*)outparam + (8 * k), &word,
+           (sz - (8 * k)) < 8 ? sz % 8 : 8);
+  }
+}
+
+x9_lossy_inbox* x9_create_lossy_inbox(uint64_t const sz,
+                                      char const* restrict const name,
+                                      uint64_t const msg_sz) {
+  if (!((sz > 0) && !(sz % 2))) { goto lossy_inbox_incorrect_size; }
+
+  x9_lossy_inbox* inbox = aligned_alloc(X9_CL_SIZE, sizeof(x9_lossy_inbox));
+  if (NULL == inbox) { goto lossy_inbox_allocation_failed; }
+  memset(inbox, 0, sizeof(x9_lossy_inbox));
+
+  uint64_t const name_len = strlen(name);
+  char*          ibx_name = calloc(name_len + 1, sizeof(char));
+  if (NULL == ibx_name) { goto lossy_inbox_name_allocation_failed; }
+  memcpy(ibx_name, name, name_len);
+
+  /* Header plus the msg rounded up to words */
+  uint64_t const slot_sz = sizeof(x9_lossy_header) + ((msg_sz + 7) & ~UINT64_C(7));
+  void*          slots   = calloc(sz, slot_sz);
+  if (NULL == slots) { goto lossy_inbox_slots_allocation_failed; }
+
+  inbox->constant = UINT64_C(0xFFFFFFFFFFFFFFFF) / sz + 1;
+  inbox->sz       = sz;
+  inbox->msg_sz   = msg_sz;
+  inbox->slot_sz  = slot_sz;
+  inbox->slots    = slots;
+  inbox->name     = ibx_name;
+  return inbox;
+
+lossy_inbox_incorrect_size:
+#ifdef X9_DEBUG
+  x9_print_error_msg("LOSSY_INBOX_INCORRECT_SIZE");
+#endif
+  return NULL;
+
+lossy_inbox_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("LOSSY_INBOX_ALLOCATION_FAILED");
+#endif
+  return NULL;
+
+lossy_inbox_name_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("LOSSY_INBOX_NAME_ALLOCATION_FAILED");
+#endif
+  free(inbox);
+  return NULL;
+
+lossy_inbox_slots_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("LOSSY_INBOX_SLOTS_ALLOCATION_FAILED");
+#endif
+  free(ibx_name);
+  free(inbox);
+  return NULL;
+}
+
+bool x9_lossy_inbox_is_valid(x9_lossy_inbox const* const inbox) {
+  return !(NULL == inbox);
+}
+
+bool x9_lossy_inbox_name_is(x9_lossy_inbox const* const inbox,
+                            char const* restrict const cmp) {
+  return !strcmp(inbox->name, cmp) ? true : false;
+}
+
+void x9_free_lossy_inbox(x9_lossy_inbox* const inbox) {
+  free(inbox->slots);
+  free(inbox->name);
+  free(inbox);
+}
+
+void x9_write_to_lossy_inbox(x9_lossy_inbox* const inbox,
+                             uint64_t const        msg_sz,
+                             void const* restrict const msg) {
+  register uint64_t const position =
+      atomic_load_explicit(&inbox->write_idx, __ATOMIC_RELAXED);
+  x9_lossy_header* const header = x9_lossy_header_ptr(inbox, position);
+
+  /* Odd while writing, and the words can't be reordered before it. */
+  atomic_store_explicit(&header->seq, (2 * position) + 1, __ATOMIC_RELAXED);
+  atomic_thread_fence(__ATOMIC_RELEASE);
+  x9_store_words((_Atomic(uint64_t)*)(header + 1), msg, msg_sz);
+  atomic_store_explicit(&header->seq, 2 * (position + 1), __ATOMIC_RELEASE);
+  atomic_store_explicit(&inbox->write_idx, position + 1, __ATOMIC_RELEASE);
+}
+
+bool x9_read_from_lossy_inbox(x9_lossy_inbox* const    inbox,
+                              uint64_t const           msg_sz,
+                              void* restrict const     outparam,
+                              uint64_t* restrict const dropped) {
+  uint64_t const start = inbox->read_idx;
+  bool           read  = false;
+
+  for (;;) {
+    uint64_t const written =
+        atomic_load_explicit(&inbox->write_idx, __ATOMIC_ACQUIRE);
+    if (inbox->read_idx == written) { break; }
+
+    /* Lapped by the writer, the oldest message left is 'sz' behind it. */
+    if ((written - inbox->read_idx) > inbox->sz) {
+      inbox->read_idx = written - inbox->sz;
+    }
+
+    x9_lossy_header* const header =
+        x9_lossy_header_ptr(inbox, inbox->read_idx);
+    uint64_t const expected = 2 * (inbox->read_idx + 1);
+    if (atomic_load_explicit(&header->seq, __ATOMIC_ACQUIRE) == expected) {
+      x9_load_words((_Atomic(uint64_t)*)(header + 1), outparam, msg_sz);
+      /* The words can't be reordered after the second check. */
+      atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (atomic_load_explicit(&header->seq, __ATOMIC_RELAXED) == expected) {
+        read = true;
+        break;
+      }
+    }
+    /* Being (or already) overwritten by a message 'sz' positions ahead. */
+    ++inbox->read_idx;
+  }
+
+  /* Every position skipped was a message dropped. */
+  *dropped = inbox->read_idx - start;
+  if (*dropped) {
+    atomic_fetch_add_explicit(&inbox->dropped, *dropped, __ATOMIC_RELAXED);
+  }
+  if (read) { ++inbox->read_idx; }
+  return read;
+}
+
+void x9_read_from_lossy_inbox_spin(x9_lossy_inbox* const    inbox,
+                                   uint64_t const           msg_sz,
+                                   void* restrict const     outparam,
+                                   uint64_t* restrict const dropped) {
+  uint64_t total = 0;
+  for (;;) {
+    bool const read =
+        x9_read_from_lossy_inbox(inbox, msg_sz, outparam, dropped);
+    total += *dropped;
+    if (read) { break; }
+    _mm_pause();
+  }
+  *dropped = total;
+}
+
+uint64_t x9_lossy_inbox_dropped(x9_lossy_inbox const* const inbox) {
+  return atomic_load_explicit(&inbox->dropped, __ATOMIC_RELAXED);
+}
+
+/* Starts thread 'k' of a x9_executor or x9_graph, pinned to 'cores[k]'
+ * unless 'cores' is NULL. Returns 'false' if it could not be started. */
+static bool x9_start_thread(pthread_t* const      th,
+                            uint64_t const* const cores,
+                            uint64_t const        k,
+                            void* (*fn)(void*),
+                            void* const args) {
+  pthread_attr_t attr = {0};
+  pthread_attr_init(&attr);
+  if (NULL != cores) {
+    cpu_set_t core = {0};
+    CPU_ZERO(&core);
+    CPU_SET(cores[k], &core);
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &core);
+  }
+  int const err = pthread_create(th, &attr, fn, args);
+  pthread_attr_destroy(&attr);
+  return !err;
+}
+
+/* Reads a task from the inbox of 'worker' or, if it is empty, steals one
+ * from its siblings (starting from the next one, so that thieves spread
+ * out), and runs it. Returns 'false' if all inboxes were empty. */
+static inline bool x9_run_next_task(x9_executor* const executor,
+                                    x9_worker* const   worker) {
+  x9_task task = {0};
+  uint64_t idx = worker->idx;
+
+  for (uint64_t k = 0; k != executor->n_workers; ++k) {
+    if (x9_read_from_shared_inbox(executor->workers[idx].inbox,
+                                  sizeof(x9_task), &task)) {
+      task.fn(task.args);
+      atomic_store_explicit(
+          &worker->run,
+          atomic_load_explicit(&worker->run, __ATOMIC_RELAXED) + 1,
+          __ATOMIC_RELAXED);
+      if (k) {
+        atomic_store_explicit(
+            &worker->stolen,
+            atomic_load_explicit(&worker->stolen, __ATOMIC_RELAXED) + 1,
+            __ATOMIC_RELAXED);
+      }
+      return true;
+    }
+    idx = (idx + 1 == executor->n_workers) ? 0 : idx + 1;
+  }
+  return false;
+}
+
+static void* x9_worker_fn(void* args) {
+  x9_worker* const   worker   = (x9_worker*)args;
+  x9_executor* const executor = worker->executor;
+
+  for (;;) {
+    /* Loaded before looking for tasks, so that every task submitted before
+     * 'stop' was set is found. */
+    bool const stop = atomic_load_explicit(&executor->stop, __ATOMIC_ACQUIRE);
+    if (x9_run_next_task(executor, worker)) { continue; }
+    if (stop) { break; }
+    _mm_pause();
+  }
+  return 0;
+}
+
+/* Stops and joins the first 'n' workers of the 'executor'. */
+static void x9_stop_workers(x9_executor* const executor, uint64_t const n) {
+  atomic_store_explicit(&executor->stop, true, __ATOMIC_RELEASE);
+  for (uint64_t k = 0; k != n; ++k) {
+    pthread_join(executor->workers[k].th, NULL);
+  }
+}
+
+/* Frees the inboxes of the first 'n' workers of the 'executor'. */
+static void x9_free_worker_inboxes(x9_executor* const executor,
+                                   uint64_t const     n) {
+  for (uint64_t k = 0; k != n; ++k) {
+    x9_free_inbox(executor->workers[k].inbox);
+  }
+}
+
+x9_executor* x9_create_executor(uint64_t const n_workers,
+                                uint64_t const* const cores,
+                                uint64_t const sz,
+                                char const* restrict const name) {
+  if (!(n_workers > 0)) { goto executor_incorrect_definition; }
+
+  uint64_t n_inboxes = 0;
+  uint64_t n_threads = 0;
+
+  x9_executor* executor = aligned_alloc(X9_CL_SIZE, sizeof(x9_executor));
+  if (NULL == executor) { goto executor_allocation_failed; }
+  memset(executor, 0, sizeof(x9_executor));
+
+  uint64_t const name_len  = strlen(name);
+  char*          exec_name = calloc(name_len + 1, sizeof(char));
+  if (NULL == exec_name) { goto executor_name_allocation_failed; }
+  memcpy(exec_name, name, name_len);
+
+  x9_worker* workers =
+      aligned_alloc(X9_CL_SIZE, n_workers * sizeof(x9_worker));
+  if (NULL == workers) { goto executor_workers_allocation_failed; }
+  memset(workers, 0, n_workers * sizeof(x9_worker));
+
+  executor->workers   = workers;
+  executor->n_workers = n_workers;
+  executor->name      = exec_name;
+
+  for (; n_inboxes != n_workers; ++n_inboxes) {
+    x9_inbox* const inbox = x9_create_inbox(sz, name, sizeof(x9_task));
+    if (!x9_inbox_is_valid(inbox)) { goto executor_inbox_invalid; }
+    workers[n_inboxes].inbox    = inbox;
+    workers[n_inboxes].executor = executor;
+    workers[n_inboxes].idx      = n_inboxes;
+  }
+
+  /* Only started once all inboxes exist, as any of them can be stolen
+   * from. */
+  for (; n_threads != n_workers; ++n_threads) {
+    if (!x9_start_thread(&workers[n_threads].th, cores, n_threads,
+                         x9_worker_fn, &workers[n_threads])) {
+      goto executor_thread_creation_failed;
+    }
+  }
+  return executor;
+
+executor_incorrect_definition:
+#ifdef X9_DEBUG
+  x9_print_error_msg("EXECUTOR_INCORRECT_DEFINITION");
+#endif
+  return NULL;
+
+executor_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("EXECUTOR_ALLOCATION_FAILED");
+#endif
+  return NULL;
+
+executor_name_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("EXECUTOR_NAME_ALLOCATION_FAILED");
+#endif
+  free(executor);
+  return NULL;
+
+executor_workers_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("EXECUTOR_WORKERS_ALLOCATION_FAILED");
+#endif
+  free(exec_name);
+  free(executor);
+  return NULL;
+
+executor_inbox_invalid:
+#ifdef X9_DEBUG
+  x9_print_error_msg("EXECUTOR_INBOX_INVALID");
+#endif
+  x9_free_worker_inboxes(executor, n_inboxes);
+  free(workers);
+  free(exec_name);
+  free(executor);
+  return NULL;
+
+executor_thread_creation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("EXECUTOR_THREAD_CREATION_FAILED");
+#endif
+  x9_stop_workers(executor, n_threads);
+  x9_free_worker_inboxes(executor, n_inboxes);
+  free(workers);
+  free(exec_name);
+  free(executor);
+  return NULL;
+}
+
+bool x9_executor_is_valid(x9_executor const* const executor) {
+  return !(NULL == executor);
+}
+
+bool x9_executor_name_is(x9_executor const* const executor,
+                         char const* restrict const cmp) {
+  return !strcmp(executor->name, cmp) ? true : false;
+}
+
+void x9_free_executor(x9_executor* const executor) {
+  x9_stop_workers(executor, executor->n_workers);
+  x9_free_worker_inboxes(executor, executor->n_workers);
+  free(executor->workers);
+  free(executor->name);
+  free(executor);
+}
+
+bool x9_executor_submit(x9_executor* const executor,
+                        x9_task_fn const   fn,
+                        uint64_t const     args_sz,
+                        void const* restrict const args) {
+  assert(args_sz <= X9_TASK_ARGS_SZ);
+  x9_task task = {.fn = fn};
+  if (args_sz) { memcpy(task.args, args, args_sz); }
+
+  for (uint64_t k = 0; k != executor->n_workers; ++k) {
+    x9_inbox* const inbox = executor->workers[executor->next].inbox;
+    executor->next =
+        (executor->next + 1 == executor->n_workers) ? 0 : executor->next + 1;
+    if (x9_write_to_inbox(inbox, sizeof(x9_task), &task)) { return true; }
+  }
+  return false;
+}
+
+void x9_executor_submit_spin(x9_executor* const executor,
+                             x9_task_fn const   fn,
+                             uint64_t const     args_sz,
+                             void const* restrict const args) {
+  while (!x9_executor_submit(executor, fn, args_sz, args)) { _mm_pause(); }
+}
+
+bool x9_executor_submit_to(x9_executor* const executor,
+                           uint64_t const     worker,
+                           x9_task_fn const   fn,
+                           uint64_t const     args_sz,
+                           void const* restrict const args) {
+  assert(worker < executor->n_workers);
+  assert(args_sz <= X9_TASK_ARGS_SZ);
+  x9_task task = {.fn = fn};
+  if (args_sz) { memcpy(task.args, args, args_sz); }
+
+  return x9_write_to_inbox(executor->workers[worker].inbox, sizeof(x9_task),
+                           &task);
+}
+
+uint64_t x9_executor_tasks_run(x9_executor const* const executor,
+                               uint64_t const           worker) {
+  return atomic_load_explicit(&executor->workers[worker].run,
+                              __ATOMIC_RELAXED);
+}
+
+uint64_t x9_executor_tasks_stolen(x9_executor const* const executor,
+                                  uint64_t const           worker) {
+  return atomic_load_explicit(&executor->workers[worker].stolen,
+                              __ATOMIC_RELAXED);
+}
+
+/* Returns how many messages, up to 'max', can be written to the 'inbox'
+ * without finding it full, or 0 if it can't tell. Exact when the calling
+ * thread is its only writer.
+ * Slots are freed in order, hence when the last of them is free, so are the
+ * ones before it. It is still checked, as spinning readers take their index
+ * before freeing their slot. */
+static inline uint64_t x9_inbox_free_slots(x9_inbox* const inbox,
+                                           uint64_t const  max) {
+  /* Read 'read_idx' first, so that the depth can only be over estimated */
+  uint64_t const r = atomic_load_explicit(&inbox->read_idx, __ATOMIC_RELAXED);
+  uint64_t const w = atomic_load_explicit(&inbox->write_idx, __ATOMIC_RELAXED);
+  uint64_t const depth = (w > r) ? (w - r) : 0;
+  if (depth >= inbox->sz) { return 0; }
+
+  uint64_t const n = ((inbox->sz - depth) < max) ? (inbox->sz - depth) : max;
+  register x9_msg_header* const header =
+      x9_header_ptr(inbox, x9_slot_idx(inbox, w + n - 1));
+  return atomic_load_explicit(&header->slot_has_data, __ATOMIC_ACQUIRE) ? 0
+                                                                         : n;
+}
+
+/* Calls the handler of the stage 'ctx' on a 'msg' read by 'x9_drain_inbox'
+ * from its input. */
+static void x9_stage_call(void const* const msg, void* const ctx) {
+  x9_stage* const stage = (x9_stage*)ctx;
+  stage->fn((void*)msg, stage->outputs, stage->ctx);
+}
+
+/* Handles up to 'batch' messages of the 'stage', fewer when its input runs
+ * empty or when one of its outputs can't take as many (each message may
+ * write one to every output). Returns how many. */
+static inline uint64_t x9_run_stage(x9_stage* const stage,
+                                    uint64_t const  batch) {
+  uint64_t budget = batch;
+  for (uint64_t k = 0; k != stage->n_outputs; ++k) {
+    budget = x9_inbox_free_slots(stage->outputs[k], budget);
+    if (!budget) { return 0; }
+  }
+
+  uint64_t const n = x9_drain_inbox(stage->input, budget, x9_stage_call, stage);
+  if (n) {
+    atomic_store_explicit(
+        &stage->msgs, atomic_load_explicit(&stage->msgs, __ATOMIC_RELAXED) + n,
+        __ATOMIC_RELAXED);
+  }
+  return n;
+}
+
+static void* x9_graph_thread_fn(void* args) {
+  x9_graph_thread* const th    = (x9_graph_thread*)args;
+  x9_graph* const        graph = th->graph;
+
+  for (;;) {
+    bool const stop = atomic_load_explicit(&graph->stop, __ATOMIC_ACQUIRE);
+    uint64_t   n    = 0;
+    for (uint64_t k = 0; k != th->n_stages; ++k) {
+      n += x9_run_stage(th->stages[k], graph->batch);
+    }
+    if (n) { continue; }
+    if (stop) { break; }
+    _mm_pause();
+  }
+  return 0;
+}
+
+static inline uint64_t x9_monotonic_ns(void) {
+  struct timespec now = {0};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * UINT64_C(1000000000)) + (uint64_t)now.tv_nsec;
+}
+
+/* Stops and joins the first 'n' threads of the 'graph'. */
+static void x9_stop_graph_threads(x9_graph* const graph, uint64_t const n) {
+  atomic_store_explicit(&graph->stop, true, __ATOMIC_RELEASE);
+  for (uint64_t k = 0; k != n; ++k) {
+    pthread_join(graph->threads[k].th, NULL);
+  }
+  atomic_store_explicit(&graph->stopped_ns, x9_monotonic_ns(),
+                        __ATOMIC_RELAXED);
+  atomic_store_explicit(&graph->running, false, __ATOMIC_RELEASE);
+}
+
+static void x9_free_stage(x9_stage* const stage) {
+  free(stage->outputs);
+  free(stage->name);
+  free(stage);
+}
+
+x9_graph* x9_create_graph(char const* restrict const name,
+                          uint64_t const n_threads,
+                          uint64_t const* const cores,
+                          uint64_t const batch) {
+  if (!((n_threads > 0) && (batch > 0))) { goto graph_incorrect_definition; }
+
+  x9_graph* graph = aligned_alloc(X9_CL_SIZE, sizeof(x9_graph));
+  if (NULL == graph) { goto graph_allocation_failed; }
+  memset(graph, 0, sizeof(x9_graph));
+
+  uint64_t const name_len   = strlen(name);
+  char*          graph_name = calloc(name_len + 1, sizeof(char));
+  if (NULL == graph_name) { goto graph_name_allocation_failed; }
+  memcpy(graph_name, name, name_len);
+
+  x9_graph_thread* threads = calloc(n_threads, sizeof(x9_graph_thread));
+  if (NULL == threads) { goto graph_threads_allocation_failed; }
+
+  uint64_t* graph_cores = NULL;
+  if (NULL != cores) {
+    graph_cores = calloc(n_threads, sizeof(uint64_t));
+    if (NULL == graph_cores) { goto graph_cores_allocation_failed; }
+    memcpy(graph_cores, cores, n_threads * sizeof(uint64_t));
+  }
+
+  for (uint64_t k = 0; k != n_threads; ++k) { threads[k].graph = graph; }
+  graph->threads   = threads;
+  graph->n_threads = n_threads;
+  graph->cores     = graph_cores;
+  graph->batch     = batch;
+  graph->name      = graph_name;
+  return graph;
+
+graph_incorrect_definition:
+#ifdef X9_DEBUG
+  x9_print_error_msg("GRAPH_INCORRECT_DEFINITION");
+#endif
+  return NULL;
+
+graph_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("GRAPH_ALLOCATION_FAILED");
+#endif
+  return NULL;
+
+graph_name_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("GRAPH_NAME_ALLOCATION_FAILED");
+#endif
+  free(graph);
+  return NULL;
+
+graph_threads_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("GRAPH_THREADS_ALLOCATION_FAILED");
+#endif
+  free(graph_name);
+  free(graph);
+  return NULL;
+
+graph_cores_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("GRAPH_CORES_ALLOCATION_FAILED");
+#endif
+  free(threads);
+  free(graph_name);
+  free(graph);
+  return NULL;
+}
+
+bool x9_graph_is_valid(x9_graph const* const graph) {
+  return !(NULL == graph);
+}
+
+bool x9_graph_name_is(x9_graph const* const graph,
+                      char const* restrict const cmp) {
+  return !strcmp(graph->name, cmp) ? true : false;
+}
+
+void x9_free_graph(x9_graph* const graph) {
+  x9_graph_stop(graph);
+  for (uint64_t k = 0; k != graph->n_stages; ++k) {
+    x9_free_stage(graph->stages[k]);
+  }
+  for (uint64_t k = 0; k != graph->n_threads; ++k) {
+    free(graph->threads[k].stages);
+  }
+  free(graph->stages);
+  free(graph->threads);
+  free(graph->cores);
+  free(graph->name);
+  free(graph);
+}
+
+bool x9_graph_add_stage(x9_graph* const graph,
+                        char const* restrict const name,
+                        uint64_t const    thread,
+                        x9_inbox* const   input,
+                        x9_stage_fn const fn,
+                        void* const       ctx,
+                        uint64_t const    n_outputs,
+                        ...) {
+  if (atomic_load_explicit(&graph->running, __ATOMIC_RELAXED) ||
+      !(thread < graph->n_threads)) {
+    goto graph_stage_incorrect_definition;
+  }
+
+  x9_stage* stage = aligned_alloc(X9_CL_SIZE, sizeof(x9_stage));
+  if (NULL == stage) { goto graph_stage_allocation_failed; }
+  memset(stage, 0, sizeof(x9_stage));
+
+  uint64_t const name_len   = strlen(name);
+  char*          stage_name = calloc(name_len + 1, sizeof(char));
+  if (NULL == stage_name) { goto graph_stage_name_allocation_failed; }
+  memcpy(stage_name, name, name_len);
+  stage->name = stage_name;
+
+  /* 'calloc(0, ...)' may return NULL */
+  stage->outputs = calloc(n_outputs ? n_outputs : 1, sizeof(x9_inbox*));
+  if (NULL == stage->outputs) { goto graph_stage_outputs_allocation_failed; }
+
+  va_list argp = {0};
+  va_start(argp, n_outputs);
+  for (uint64_t k = 0; k != n_outputs; ++k) {
+    stage->outputs[k] = va_arg(argp, x9_inbox*);
+  }
+  va_end(argp);
+
+  x9_stage** stages =
+      realloc(graph->stages, (graph->n_stages + 1) * sizeof(x9_stage*));
+  if (NULL == stages) { goto graph_stage_registration_failed; }
+  graph->stages = stages;
+
+  x9_graph_thread* const th = &graph->threads[thread];
+  x9_stage** thread_stages =
+      realloc(th->stages, (th->n_stages + 1) * sizeof(x9_stage*));
+  if (NULL == thread_stages) { goto graph_stage_registration_failed; }
+  th->stages = thread_stages;
+
+  stage->input     = input;
+  stage->n_outputs = n_outputs;
+  stage->fn        = fn;
+  stage->ctx       = ctx;
+  stage->thread    = thread;
+  graph->stages[graph->n_stages++] = stage;
+  th->stages[th->n_stages++]       = stage;
+  return true;
+
+graph_stage_incorrect_definition:
+#ifdef X9_DEBUG
+  x9_print_error_msg("GRAPH_STAGE_INCORRECT_DEFINITION");
+#endif
+  return false;
+
+graph_stage_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("GRAPH_STAGE_ALLOCATION_FAILED");
+#endif
+  return false;
+
+graph_stage_name_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("GRAPH_STAGE_NAME_ALLOCATION_FAILED");
+#endif
+  free(stage);
+  return false;
+
+graph_stage_outputs_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("GRAPH_STAGE_OUTPUTS_ALLOCATION_FAILED");
+#endif
+  x9_free_stage(stage);
+  return false;
+
+graph_stage_registration_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("GRAPH_STAGE_REGISTRATION_FAILED");
+#endif
+  x9_free_stage(stage);
+  return false;
+}
+
+bool x9_graph_start(x9_graph* const graph) {
+  if (atomic_load_explicit(&graph->running, __ATOMIC_RELAXED)) {
+    goto graph_already_running;
+  }
+
+  atomic_store_explicit(&graph->stop, false, __ATOMIC_RELAXED);
+  atomic_store_explicit(&graph->started_ns, x9_monotonic_ns(),
+                        __ATOMIC_RELAXED);
+  atomic_store_explicit(&graph->running, true, __ATOMIC_RELEASE);
+
+  for (uint64_t k = 0; k != graph->n_threads; ++k) {
+    if (!x9_start_thread(&graph->threads[k].th, graph->cores, k,
+                         x9_graph_thread_fn, &graph->threads[k])) {
+      x9_stop_graph_threads(graph, k);
+      goto graph_thread_creation_failed;
+    }
+  }
+  return true;
+
+graph_already_running:
+#ifdef X9_DEBUG
+  x9_print_error_msg("GRAPH_ALREADY_RUNNING");
+#endif
+  return false;
+
+graph_thread_creation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("GRAPH_THREAD_CREATION_FAILED");
+#endif
+  return false;
+}
+
+void x9_graph_stop(x9_graph* const graph) {
+  if (atomic_load_explicit(&graph->running, __ATOMIC_RELAXED)) {
+    x9_stop_graph_threads(graph, graph->n_threads);
+  }
+}
+
+bool x9_graph_stage_stats(x9_graph* const graph,
+                          char const* restrict const name,
+                          x9_stage_stats* restrict const outparam) {
+  for (uint64_t k = 0; k != graph->n_stages; ++k) {
+    x9_stage* const stage = graph->stages[k];
+    if (strcmp(stage->name, name)) { continue; }
+
+    /* 'stopped_ns' is written before 'running' is cleared. */
+    bool const running =
+        atomic_load_explicit(&graph->running, __ATOMIC_ACQUIRE);
+    uint64_t const now =
+        running ? x9_monotonic_ns()
+                : atomic_load_explicit(&graph->stopped_ns, __ATOMIC_RELAXED);
+    uint64_t const started =
+        atomic_load_explicit(&graph->started_ns, __ATOMIC_RELAXED);
+    double const secs = (started && (now > started))
+                            ? ((double)(now - started) / 1e9)
+                            : 0;
+
+    double const   percentiles[2] = {50, 99};
+    double         hops_ns[2]     = {0};
+    uint64_t const msgs =
+        atomic_load_explicit(&stage->msgs, __ATOMIC_RELAXED);
+    x9_inbox_latency_percentiles_ns(stage->input, 2, percentiles, hops_ns);
+
+    *outparam = (x9_stage_stats){
+        .msgs         = msgs,
+        .msgs_per_sec = (secs > 0) ? ((double)msgs / secs) : 0,
+        .depth        = x9_inbox_depth_approx(stage->input),
+        .depth_hwm    = x9_inbox_depth_hwm(stage->input),
+        .hop_p50_ns   = hops_ns[0],
+        .hop_p99_ns   = hops_ns[1]};
+    return true;
+  }
+  return false;
+}
+
+/* Entry of the table of pending calls of the 'chan' that the call 'id' maps
+ * to. Ids are consecutive, hence so are the entries of consecutive calls. */
+static inline x9_call_entry* x9_call_entry_ptr(x9_channel const* const chan,
+                                               uint64_t const          id) {
+  /* From paper: Faster Remainder by Direct Computation, Lemire et al */
+  register uint64_t const idx =
+      ((__uint128_t)(chan->constant * id) * chan->sz) >> 64;
+  return (x9_call_entry*)&((char*)chan->entries)[idx * chan->entry_sz];
+}
+
+/* Called by the server once the reply to the call 'id' was written to its
+ * 'entry'. */
+static inline void x9_publish_reply(x9_call_entry* const entry,
+                                    uint64_t const       id) {
+  atomic_store_explicit(&entry->replied, id, __ATOMIC_RELEASE);
+}
+
+x9_channel* x9_create_channel(uint64_t const sz,
+                              char const* restrict const name,
+                              uint64_t const req_sz,
+                              uint64_t const reply_sz) {
+  x9_channel* chan = aligned_alloc(X9_CL_SIZE, sizeof(x9_channel));
+  if (NULL == chan) { goto channel_allocation_failed; }
+  memset(chan, 0, sizeof(x9_channel));
+
+  uint64_t const name_len  = strlen(name);
+  char*          chan_name = calloc(name_len + 1, sizeof(char));
+  if (NULL == chan_name) { goto channel_name_allocation_failed; }
+  memcpy(chan_name, name, name_len);
+
+  /* Also validates 'sz' */
+  x9_inbox* const requests =
+      x9_create_inbox(sz, name, sizeof(x9_call_header) + req_sz);
+  if (!x9_inbox_is_valid(requests)) { goto channel_requests_invalid; }
+
+  /* Rounded up to a multiple of the cache line size */
+  uint64_t const entry_sz =
+      (sizeof(x9_call_entry) + reply_sz + X9_CL_SIZE - 1) &
+      ~(uint64_t)(X9_CL_SIZE - 1);
+  void* entries = aligned_alloc(X9_CL_SIZE, sz * entry_sz);
+  if (NULL == entries) { goto channel_entries_allocation_failed; }
+  memset(entries, 0, sz * entry_sz);
+
+  void* const call = calloc(1, sizeof(x9_call_header) + req_sz);
+  if (NULL == call) { goto channel_call_allocation_failed; }
+
+  /* Id 0 means no call */
+  chan->next_id  = 1;
+  chan->call     = call;
+  chan->requests = requests;
+  chan->entries  = entries;
+  chan->sz       = sz;
+  chan->constant = UINT64_C(0xFFFFFFFFFFFFFFFF) / sz + 1;
+  chan->entry_sz = entry_sz;
+  chan->req_sz   = req_sz;
+  chan->reply_sz = reply_sz;
+  chan->name     = chan_name;
+  return chan;
+
+channel_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("CHANNEL_ALLOCATION_FAILED");
+#endif
+  return NULL;
+
+channel_name_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("CHANNEL_NAME_ALLOCATION_FAILED");
+#endif
+  free(chan);
+  return NULL;
+
+channel_requests_invalid:
+#ifdef X9_DEBUG
+  x9_print_error_msg("CHANNEL_REQUESTS_INVALID");
+#endif
+  free(chan_name);
+  free(chan);
+  return NULL;
+
+channel_entries_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("CHANNEL_ENTRIES_ALLOCATION_FAILED");
+#endif
+  x9_free_inbox(requests);
+  free(chan_name);
+  free(chan);
+  return NULL;
+
+channel_call_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("CHANNEL_CALL_ALLOCATION_FAILED");
+#endif
+  free(entries);
+  x9_free_inbox(requests);
+  free(chan_name);
+  free(chan);
+  return NULL;
+}
+
+bool x9_channel_is_valid(x9_channel const* const chan) {
+  return !(NULL == chan);
+}
+
+bool x9_channel_name_is(x9_channel const* const chan,
+                        char const* restrict const cmp) {
+  return !strcmp(chan->name, cmp) ? true : false;
+}
+
+void x9_free_channel(x9_channel* const chan) {
+  x9_free_inbox(chan->requests);
+  free(chan->entries);
+  free(chan->call);
+  free(chan->name);
+  free(chan);
+}
+
+uint64_t x9_call_async(x9_channel* const chan, void const* restrict const req) {
+  uint64_t const       id    = chan->next_id;
+  x9_call_entry* const entry = x9_call_entry_ptr(chan, id);
+  /* The call 'sz' calls before this one is still pending. */
+  if (entry->id) {
+    X9_STATS_INC(chan->requests, producer_stats, write_failures);
+    return 0;
+  }
+
+  x9_call_header const call = {.id = id};
+  memcpy(chan->call, &call, sizeof(x9_call_header));
+  memcpy((char*)chan->call + sizeof(x9_call_header), req, chan->req_sz);
+  if (!x9_write_to_inbox(chan->requests, sizeof(x9_call_header) + chan->req_sz,
+                         chan->call)) {
+    return 0;
+  }
+
+  entry->id = id;
+  ++chan->next_id;
+  return id;
+}
+
+bool x9_call_poll(x9_channel* const    chan,
+                  uint64_t const       id,
+                  void* restrict const reply) {
+  x9_call_entry* const entry = x9_call_entry_ptr(chan, id);
+  /* Already polled, in which case the entry may be pending for another. */
+  if (id != entry->id) { return false; }
+  if (id != atomic_load_explicit(&entry->replied, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  memcpy(reply, (char*)entry + sizeof(x9_call_entry), chan->reply_sz);
+  entry->id = 0;
+  return true;
+}
+
+void x9_call(x9_channel* const chan,
+             void const* restrict const req,
+             void* restrict const reply) {
+  uint64_t id = 0;
+  for (;;) {
+    id = x9_call_async(chan, req);
+    if (id) { break; }
+    _mm_pause();
+  }
+  for (;;) {
+    if (x9_call_poll(chan, id, reply)) { return; }
+    _mm_pause();
+  }
+}
+
+/* Handles a request read by 'x9_drain_inbox' for 'x9_serve'. */
+static void x9_serve_call(void const* const msg, void* const ctx) {
+  x9_serve_ctx const* const serve = (x9_serve_ctx const*)ctx;
+  x9_call_header            call  = {0};
+  memcpy(&call, msg, sizeof(x9_call_header));
+
+  /* The reply is written straight into the entry of the call. */
+  x9_call_entry* const entry = x9_call_entry_ptr(serve->chan, call.id);
+  serve->fn((char const*)msg + sizeof(x9_call_header),
+            (char*)entry + sizeof(x9_call_entry), serve->ctx);
+  x9_publish_reply(entry, call.id);
+}
+
+uint64_t x9_serve(x9_channel* const chan,
+                  x9_serve_fn const fn,
+                  void* const       ctx,
+                  uint64_t const    budget) {
+  x9_serve_ctx serve = {.chan = chan, .fn = fn, .ctx = ctx};
+  return x9_drain_inbox(chan->requests, budget, x9_serve_call, &serve);
+}
+
+bool x9_channel_recv(x9_channel* const        chan,
+                     void* restrict const     req,
+                     uint64_t* restrict const id) {
+  x9_inbox* const               inbox  = chan->requests;
+  register uint64_t const       idx    = x9_load_idx(inbox, true);
+  register x9_msg_header* const header = x9_header_ptr(inbox, idx);
+
+  if (atomic_load_explicit(&header->slot_has_data, __ATOMIC_RELAXED)) {
+    if (atomic_load_explicit(&header->msg_written, __ATOMIC_ACQUIRE)) {
+      char const* const msg  = (char*)header + sizeof(x9_msg_header);
+      x9_call_header    call = {0};
+      memcpy(&call, msg, sizeof(x9_call_header));
+      memcpy(req, msg + sizeof(x9_call_header), chan->req_sz);
+      *id = call.id;
+      x9_record_latency(inbox, header);
+      atomic_store_explicit(&header->msg_written, false, __ATOMIC_RELAXED);
+      atomic_store_explicit(&header->slot_has_data, false, __ATOMIC_RELEASE);
+      atomic_fetch_add_explicit(&inbox->read_idx, 1, __ATOMIC_RELEASE);
+      X9_STATS_INC(inbox, consumer_stats, reads);
+      return true;
+    }
+  } else {
+    X9_STATS_INC(inbox, consumer_stats, empty_events);
+  }
+  X9_STATS_INC(inbox, consumer_stats, read_failures);
+  return false;
+}
+
+void x9_channel_reply(x9_channel* const chan,
+                      uint64_t const    id,
+                      void const* restrict const reply) {
+  x9_call_entry* const entry = x9_call_entry_ptr(chan, id);
+  memcpy((char*)entry + sizeof(x9_call_entry), reply, chan->reply_sz);
+  x9_publish_reply(entry, id);
+}
+
+static inline x9_journal_header* x9_journal_header_ptr(
+    x9_journal const* const journal, char* const base, uint64_t const pos) {
+  return (x9_journal_header*)&base[pos * journal->record_sz];
+}
+
+/* Writes the name of the file of the segment 'k' of the 'journal' to
+ * 'file'. Returns 'false' if it doesn't fit. */
+static bool x9_segment_file(x9_journal const* const journal,
+                            uint64_t const          k,
+                            char* const             file) {
+  int const n = snprintf(file, PATH_MAX, "%s.%" PRIu64, journal->path, k);
+  return (n >= 0) && ((uint64_t)n < PATH_MAX);
+}
+
+/* Maps the segment 'k' of the 'journal'.
+ * If 'create' is 'true' its file must not exist yet: it is allocated on
+ * disk and every page of the mapping is touched, so that the writer never
+ * page faults on it (it is not published yet, hence nobody else sees it).
+ * Otherwise the file must exist and have the expected size.
+ * Existing files are never truncated. Returns NULL if it failed. */
+static char* x9_map_segment(x9_journal const* const journal,
+                            uint64_t const          k,
+                            bool const              create) {
+  char file[PATH_MAX] = {0};
+  if (!x9_segment_file(journal, k, file)) { return NULL; }
+
+  int const fd = open(file, O_RDWR | (create ? (O_CREAT | O_EXCL) : 0), 0644);
+  if (fd < 0) { return NULL; }
+
+  off_t const sz = (off_t)(journal->seg_sz * journal->record_sz);
+  struct stat st = {0};
+  if (create ? posix_fallocate(fd, 0, sz)
+             : (fstat(fd, &st) || (st.st_size != sz))) {
+    close(fd);
+    /* Otherwise it would block the next attempts. */
+    if (create) { unlink(file); }
+    return NULL;
+  }
+
+  /* The mapping outlives the file descriptor */
+  void* const base = mmap(NULL, (size_t)sz, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, 0);
+  close(fd);
+  if (MAP_FAILED == base) {
+    if (create) { unlink(file); }
+    return NULL;
+  }
+
+  if (create) {
+    /* MAP_POPULATE only maps the pages for reading, writing to each of
+     * them once also takes the first write fault here. */
+    uint64_t const page = (uint64_t)sysconf(_SC_PAGESIZE);
+    for (uint64_t p = 0; p < (uint64_t)sz; p += page) {
+      ((char volatile*)base)[p] = 0;
+    }
+  }
+  return base;
+}
+
+/* Called by the background thread, maps the segments up to the one after
+ * the segment of the message 'seq', so that the writer never waits for
+ * one (unless it outruns the thread). */
+static void x9_map_next_segments(x9_journal* const journal,
+                                 uint64_t const    seq) {
+  uint64_t last = (seq / journal->seg_sz) + 1;
+  if (last >= journal->max_segs) { last = journal->max_segs - 1; }
+
+  for (; journal->n_mapped <= last; ++journal->n_mapped) {
+    char* const base = x9_map_segment(journal, journal->n_mapped, true);
+    /* Tried again the next time. */
+    if (NULL == base) { return; }
+    atomic_store_explicit(&journal->segs[journal->n_mapped], base,
+                          __ATOMIC_RELEASE);
+  }
+}
+
+/* Called by the background thread, 'msync's the messages written since the
+ * last call, up to 'seq'. */
+static void x9_sync_journal(x9_journal* const journal, uint64_t const seq) {
+  uint64_t const page = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t from = atomic_load_explicit(&journal->synced, __ATOMIC_RELAXED);
+
+  while (from != seq) {
+    uint64_t const seg   = from / journal->seg_sz;
+    uint64_t const first = from % journal->seg_sz;
+    uint64_t const last  = ((seq / journal->seg_sz) == seg)
+                               ? (seq % journal->seg_sz)
+                               : journal->seg_sz;
+    char* const base =
+        atomic_load_explicit(&journal->segs[seg], __ATOMIC_RELAXED);
+
+    /* 'msync' must start on a page boundary */
+    uint64_t const start = (first * journal->record_sz) & ~(page - 1);
+    uint64_t const end   = last * journal->record_sz;
+    msync(base + start, end - start, MS_SYNC);
+    from += last - first;
+  }
+  atomic_store_explicit(&journal->synced, seq, __ATOMIC_RELEASE);
+}
+
+static void* x9_journal_thread_fn(void* args) {
+  x9_journal* const     journal = (x9_journal*)args;
+  struct timespec const interval = {
+      .tv_sec  = (time_t)(journal->sync_interval_ms / 1000),
+      .tv_nsec = (long)((journal->sync_interval_ms % 1000) * 1000000)};
+
+  for (;;) {
+    /* Loaded first, so that everything written before 'x9_free_journal'
+     * is synced. */
+    bool const stop = atomic_load_explicit(&journal->stop, __ATOMIC_ACQUIRE);
+    uint64_t const seq =
+        atomic_load_explicit(&journal->write_seq, __ATOMIC_ACQUIRE);
+    x9_map_next_segments(journal, seq);
+    x9_sync_journal(journal, seq);
+    if (stop) { return 0; }
+    nanosleep(&interval, NULL);
+  }
+}
+
+/* Finds where the writer of a 'journal' that was reopened resumes, that is,
+ * after the last message of its first 'n_mapped' segments that was
+ * completely written, and returns its sequence number.
+ * The messages after it are discarded, so that cursors don't read them
+ * before they are rewritten. */
+static uint64_t x9_recover_journal(x9_journal* const journal) {
+  /* The segments after the last one whose first message was written were
+   * only mapped ahead of the writer. */
+  uint64_t seg = journal->n_mapped - 1;
+  for (; seg; --seg) {
+    char* const base =
+        atomic_load_explicit(&journal->segs[seg], __ATOMIC_RELAXED);
+    if (((seg * journal->seg_sz) + 1) ==
+        atomic_load_explicit(&x9_journal_header_ptr(journal, base, 0)->seq,
+                             __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+
+  char* const base =
+      atomic_load_explicit(&journal->segs[seg], __ATOMIC_RELAXED);
+  uint64_t pos = 0;
+  for (; pos != journal->seg_sz; ++pos) {
+    uint64_t const seq = (seg * journal->seg_sz) + pos;
+    if ((seq + 1) !=
+        atomic_load_explicit(&x9_journal_header_ptr(journal, base, pos)->seq,
+                             __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+
+  for (uint64_t k = seg; k != journal->n_mapped; ++k) {
+    char* const stale =
+        atomic_load_explicit(&journal->segs[k], __ATOMIC_RELAXED);
+    for (uint64_t p = (k == seg) ? pos : 0; p != journal->seg_sz; ++p) {
+      atomic_store_explicit(&x9_journal_header_ptr(journal, stale, p)->seq, 0,
+                            __ATOMIC_RELAXED);
+    }
+  }
+
+  journal->write_base = base;
+  journal->write_seg  = seg;
+  journal->write_pos  = pos;
+  return (seg * journal->seg_sz) + pos;
+}
+
+x9_journal* x9_create_journal(char const* restrict const path,
+                              uint64_t const seg_sz,
+                              uint64_t const max_segs,
+                              uint64_t const msg_sz,
+                              uint64_t const sync_interval_ms) {
+  if (!(seg_sz && max_segs)) { goto journal_incorrect_size; }
+  if (!sync_interval_ms) { goto journal_incorrect_sync_interval; }
+
+  x9_journal* journal = aligned_alloc(X9_CL_SIZE, sizeof(x9_journal));
+  if (NULL == journal) { goto journal_allocation_failed; }
+  memset(journal, 0, sizeof(x9_journal));
+
+  uint64_t const path_len     = strlen(path);
+  char*          journal_path = calloc(path_len + 1, sizeof(char));
+  if (NULL == journal_path) { goto journal_path_allocation_failed; }
+  memcpy(journal_path, path, path_len);
+
+  _Atomic(char*)* segs = calloc(max_segs, sizeof(_Atomic(char*)));
+  if (NULL == segs) { goto journal_segments_allocation_failed; }
+
+  journal->segs             = segs;
+  journal->seg_sz           = seg_sz;
+  journal->max_segs         = max_segs;
+  journal->msg_sz           = msg_sz;
+  journal->record_sz =
+      sizeof(x9_journal_header) + ((msg_sz + 7) & ~UINT64_C(7));
+  journal->sync_interval_ms = sync_interval_ms;
+  journal->path             = journal_path;
+
+  /* Reopen the segments of a previous journal, if any. Every file that
+   * exists must be one of its segments, that is, there can't be gaps and
+   * they must all have the expected size, otherwise they would be
+   * truncated, or overwritten, later on. */
+  char file[PATH_MAX] = {0};
+  for (uint64_t k = 0; k != max_segs; ++k) {
+    if (!x9_segment_file(journal, k, file)) { goto journal_segment_invalid; }
+    if (access(file, F_OK)) { continue; }
+    if (k != journal->n_mapped) { goto journal_segment_invalid; }
+    char* const base = x9_map_segment(journal, k, false);
+    if (NULL == base) { goto journal_segment_invalid; }
+    atomic_init(&segs[journal->n_mapped++], base);
+  }
+  if (!journal->n_mapped) {
+    char* const base = x9_map_segment(journal, 0, true);
+    if (NULL == base) { goto journal_segment_invalid; }
+    atomic_init(&segs[0], base);
+    journal->n_mapped = 1;
+  }
+  uint64_t const seq = x9_recover_journal(journal);
+  atomic_init(&journal->write_seq, seq);
+  atomic_init(&journal->synced, seq);
+
+  if (pthread_create(&journal->th, NULL, x9_journal_thread_fn, journal)) {
+    goto journal_thread_creation_failed;
+  }
+  return journal;
+
+journal_incorrect_size:
+#ifdef X9_DEBUG
+  x9_print_error_msg("JOURNAL_INCORRECT_SIZE");
+#endif
+  return NULL;
+
+journal_incorrect_sync_interval:
+#ifdef X9_DEBUG
+  x9_print_error_msg("JOURNAL_INCORRECT_SYNC_INTERVAL");
+#endif
+  return NULL;
+
+journal_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("JOURNAL_ALLOCATION_FAILED");
+#endif
+  return NULL;
+
+journal_path_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("JOURNAL_PATH_ALLOCATION_FAILED");
+#endif
+  free(journal);
+  return NULL;
+
+journal_segments_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("JOURNAL_SEGMENTS_ALLOCATION_FAILED");
+#endif
+  free(journal_path);
+  free(journal);
+  return NULL;
+
+journal_segment_invalid:
+#ifdef X9_DEBUG
+  x9_print_error_msg("JOURNAL_SEGMENT_INVALID");
+#endif
+  for (uint64_t k = 0; k != journal->n_mapped; ++k) {
+    munmap(atomic_load_explicit(&segs[k], __ATOMIC_RELAXED),
+           seg_sz * journal->record_sz);
+  }
+  free(segs);
+  free(journal_path);
+  free(journal);
+  return NULL;
+
+journal_thread_creation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("JOURNAL_THREAD_CREATION_FAILED");
+#endif
+  for (uint64_t k = 0; k != journal->n_mapped; ++k) {
+    munmap(atomic_load_explicit(&segs[k], __ATOMIC_RELAXED),
+           seg_sz * journal->record_sz);
+  }
+  free(segs);
+  free(journal_path);
+  free(journal);
+  return NULL;
+}
+
+bool x9_journal_is_valid(x9_journal const* const journal) {
+  return !(NULL == journal);
+}
+
+bool x9_journal_name_is(x9_journal const* const journal,
+                        char const* restrict const cmp) {
+  return !strcmp(journal->path, cmp) ? true : false;
+}
+
+void x9_free_journal(x9_journal* const journal) {
+  atomic_store_explicit(&journal->stop, true, __ATOMIC_RELEASE);
+  pthread_join(journal->th, NULL);
+
+  for (uint64_t k = 0; k != journal->n_mapped; ++k) {
+    munmap(atomic_load_explicit(&journal->segs[k], __ATOMIC_RELAXED),
+           journal->seg_sz * journal->record_sz);
+  }
+  free(journal->segs);
+  free(journal->path);
+  free(journal);
+}
+
+bool x9_write_to_journal(x9_journal* const journal,
+                         uint64_t const    msg_sz,
+                         void const* restrict const msg) {
+  if (journal->write_pos == journal->seg_sz) {
+    if ((journal->write_seg + 1) == journal->max_segs) { return false; }
+    char* const base = atomic_load_explicit(
+        &journal->segs[journal->write_seg + 1], __ATOMIC_ACQUIRE);
+    if (NULL == base) { return false; }
+    journal->write_base = base;
+    journal->write_pos  = 0;
+    ++journal->write_seg;
+  }
+
+  uint64_t const seq =
+      atomic_load_explicit(&journal->write_seq, __ATOMIC_RELAXED);
+  x9_journal_header* const header =
+      x9_journal_header_ptr(journal, journal->write_base, journal->write_pos);
+  memcpy((char*)header + sizeof(x9_journal_header), msg, msg_sz);
+  atomic_store_explicit(&header->seq, seq + 1, __ATOMIC_RELEASE);
+  ++journal->write_pos;
+  atomic_store_explicit(&journal->write_seq, seq + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+void x9_write_to_journal_spin(x9_journal* const journal,
+                              uint64_t const    msg_sz,
+                              void const* restrict const msg) {
+  for (;;) {
+    if (x9_write_to_journal(journal, msg_sz, msg)) { return; }
+    _mm_pause();
+  }
+}
+
+uint64_t x9_journal_seq(x9_journal const* const journal) {
+  return atomic_load_explicit(&journal->write_seq, __ATOMIC_ACQUIRE);
+}
+
+uint64_t x9_journal_synced_seq(x9_journal const* const journal) {
+  return atomic_load_explicit(&journal->synced, __ATOMIC_ACQUIRE);
+}
+
+x9_journal_cursor* x9_journal_attach(x9_journal* const journal,
+                                     uint64_t const    seq) {
+  if (seq >= (journal->seg_sz * journal->max_segs)) {
+    goto journal_seq_out_of_range;
+  }
+
+  x9_journal_cursor* const cursor = calloc(1, sizeof(x9_journal_cursor));
+  if (NULL == cursor) { goto journal_cursor_allocation_failed; }
+
+  cursor->journal = journal;
+  cursor->seq     = seq;
+  cursor->seg     = seq / journal->seg_sz;
+  cursor->pos     = seq % journal->seg_sz;
+  cursor->base =
+      atomic_load_explicit(&journal->segs[cursor->seg], __ATOMIC_ACQUIRE);
+  return cursor;
+
+journal_seq_out_of_range:
+#ifdef X9_DEBUG
+  x9_print_error_msg("JOURNAL_SEQ_OUT_OF_RANGE");
+#endif
+  return NULL;
+
+journal_cursor_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("JOURNAL_CURSOR_ALLOCATION_FAILED");
+#endif
+  return NULL;
+}
+
+void x9_journal_detach(x9_journal_cursor* const cursor) { free(cursor); }
+
+uint64_t x9_journal_cursor_seq(x9_journal_cursor const* const cursor) {
+  return cursor->seq;
+}
+
+bool x9_read_from_journal(x9_journal_cursor* const cursor,
+                          uint64_t const           msg_sz,
+                          void* restrict const     outparam) {
+  x9_journal* const journal = cursor->journal;
+
+  if (cursor->pos == journal->seg_sz) {
+    if ((cursor->seg + 1) == journal->max_segs) { return false; }
+    cursor->base = NULL;
+    cursor->pos  = 0;
+    ++cursor->seg;
+  }
+  if (NULL == cursor->base) {
+    cursor->base = atomic_load_explicit(&journal->segs[cursor->seg],
+                                        __ATOMIC_ACQUIRE);
+    if (NULL == cursor->base) { return false; }
+  }
+
+  x9_journal_header* const header =
+      x9_journal_header_ptr(journal, cursor->base, cursor->pos);
+  if ((cursor->seq + 1) !=
+      atomic_load_explicit(&header->seq, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  memcpy(outparam, (char*)header + sizeof(x9_journal_header), msg_sz);
+  ++cursor->pos;
+  ++cursor->seq;
+  return true;
+}
+
+void x9_read_from_journal_spin(x9_journal_cursor* const cursor,
+                               uint64_t const           msg_sz,
+                               void* restrict const     outparam) {
+  for (;;) {
+    if (x9_read_from_journal(cursor, msg_sz, outparam)) { return; }
+    _mm_pause();
+  }
+}
+
+#ifdef X9_TRACE
+static void* x9_trace_thread_fn(void* args) {
+  x9_trace* const       trace = (x9_trace*)args;
+  struct timespec const nap   = {.tv_nsec = 1000000};
+
+  for (;;) {
+    /* Loaded first, so that everything recorded before 'x9_trace_stop' is
+     * written. */
+    bool const stop = atomic_load_explicit(&trace->stop, __ATOMIC_ACQUIRE);
+    uint64_t   n    = 0;
+    while (x9_read_from_inbox(trace->buf, trace->record_sz, trace->record)) {
+      if (1 == fwrite(trace->record, trace->record_sz, 1, trace->file)) {
+        ++n;
+      } else {
+        atomic_fetch_add_explicit(&trace->dropped, 1, __ATOMIC_RELAXED);
+      }
+    }
+    atomic_fetch_add_explicit(&trace->n_msgs, n, __ATOMIC_RELAXED);
+    if (stop) { return 0; }
+    if (!n) { nanosleep(&nap, NULL); }
+  }
+}
+
+/* Writes the header of the file of the 'trace' at its start, and moves back
+ * to its end. */
+static bool x9_write_trace_header(x9_trace* const trace) {
+  x9_trace_header header = {
+      .version      = X9_TRACE_VERSION,
+      .msg_sz       = trace->msg_sz,
+      .n_msgs       = atomic_load_explicit(&trace->n_msgs, __ATOMIC_RELAXED),
+      .dropped      = atomic_load_explicit(&trace->dropped, __ATOMIC_RELAXED),
+      .ns_per_cycle = atomic_load(&x9_tsc_ns_per_cycle)};
+  memcpy(header.magic, X9_TRACE_MAGIC, sizeof(X9_TRACE_MAGIC));
+
+  return !fseek(trace->file, 0, SEEK_SET) &&
+         (1 == fwrite(&header, sizeof(x9_trace_header), 1, trace->file)) &&
+         !fseek(trace->file, 0, SEEK_END);
+}
+#endif
+
+x9_trace* x9_trace_inbox(x9_inbox* const inbox,
+                         char const* restrict const path,
+                         uint64_t const buf_sz) {
+#ifdef X9_TRACE
+  if (0 == atomic_load(&x9_tsc_ns_per_cycle)) { goto tsc_not_calibrated; }
+  /* Checked again once everything is set up, in case of a concurrent call,
+   * but a second call would otherwise open its 'path' for nothing, or
+   * worse, the one of the running trace. */
+  if (NULL != atomic_load(&inbox->trace)) { goto inbox_already_traced; }
+
+  x9_trace* trace = aligned_alloc(X9_CL_SIZE, sizeof(x9_trace));
+  if (NULL == trace) { goto trace_allocation_failed; }
+  memset(trace, 0, sizeof(x9_trace));
+
+  trace->inbox     = inbox;
+  trace->msg_sz    = inbox->msg_sz;
+  trace->record_sz = sizeof(uint64_t) + inbox->msg_sz;
+
+  trace->record = calloc(1, trace->record_sz);
+  if (NULL == trace->record) { goto trace_record_allocation_failed; }
+
+  trace->buf = x9_create_inbox(buf_sz, "trace", trace->record_sz);
+  if (NULL == trace->buf) { goto trace_buffer_invalid; }
+
+  /* An existing file, e.g. a previous capture, is never overwritten */
+  trace->file = fopen(path, "wbx");
+  if (NULL == trace->file) { goto trace_file_invalid; }
+  /* Written in large chunks, rather than one syscall per message */
+  setvbuf(trace->file, NULL, _IOFBF, 1 << 20);
+  if (!x9_write_trace_header(trace)) { goto trace_header_write_failed; }
+
+  if (pthread_create(&trace->th, NULL, x9_trace_thread_fn, trace)) {
+    goto trace_thread_creation_failed;
+  }
+
+  x9_trace* expected = NULL;
+  if (!atomic_compare_exchange_strong(&inbox->trace, &expected, trace)) {
+    goto trace_inbox_already_traced;
+  }
+  return trace;
+
+tsc_not_calibrated:
+#ifdef X9_DEBUG
+  x9_print_error_msg("TSC_NOT_CALIBRATED");
+#endif
+  return NULL;
+
+inbox_already_traced:
+#ifdef X9_DEBUG
+  x9_print_error_msg("TRACE_INBOX_ALREADY_TRACED");
+#endif
+  return NULL;
+
+trace_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("TRACE_ALLOCATION_FAILED");
+#endif
+  return NULL;
+
+trace_record_allocation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("TRACE_RECORD_ALLOCATION_FAILED");
+#endif
+  free(trace);
+  return NULL;
+
+trace_buffer_invalid:
+#ifdef X9_DEBUG
+  x9_print_error_msg("TRACE_BUFFER_INVALID");
+#endif
+  free(trace->record);
+  free(trace);
+  return NULL;
+
+trace_file_invalid:
+#ifdef X9_DEBUG
+  x9_print_error_msg("TRACE_FILE_INVALID");
+#endif
+  x9_free_inbox(trace->buf);
+  free(trace->record);
+  free(trace);
+  return NULL;
+
+trace_header_write_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("TRACE_HEADER_WRITE_FAILED");
+#endif
+  fclose(trace->file);
+  remove(path);
+  x9_free_inbox(trace->buf);
+  free(trace->record);
+  free(trace);
+  return NULL;
+
+trace_thread_creation_failed:
+#ifdef X9_DEBUG
+  x9_print_error_msg("TRACE_THREAD_CREATION_FAILED");
+#endif
+  fclose(trace->file);
+  remove(path);
+  x9_free_inbox(trace->buf);
+  free(trace->record);
+  free(trace);
+  return NULL;
+
+trace_inbox_already_traced:
+#ifdef X9_DEBUG
+  x9_print_error_msg("TRACE_INBOX_ALREADY_TRACED");
+#endif
+  atomic_store_explicit(&trace->stop, true, __ATOMIC_RELEASE);
+  pthread_join(trace->th, NULL);
+  fclose(trace->file);
+  remove(path);
+  x9_free_inbox(trace->buf);
+  free(trace->record);
+  free(trace);
+  return NULL;
+#else
+  (void)inbox;
+  (void)path;
+  (void)buf_sz;
+#ifdef X9_DEBUG
+  x9_print_error_msg("TRACE_NOT_COMPILED");
+#endif
+  return NULL;
+#endif
+}
+
+bool x9_trace_is_valid(x9_trace const* const trace) {
+  return !(NULL == trace);
+}
+
+uint64_t x9_trace_n_msgs(x9_trace const* const trace) {
+  return atomic_load_explicit(&trace->n_msgs, __ATOMIC_RELAXED);
+}
+
+uint64_t x9_trace_dropped(x9_trace const* const trace) {
+  return atomic_load_explicit(&trace->dropped, __ATOMIC_RELAXED);
+}
+
+void x9_trace_stop(x9_trace* const trace) {
+#ifdef X9_TRACE
+  x9_inbox* const inbox = trace->inbox;
+  atomic_store_explicit(&inbox->trace, NULL, __ATOMIC_SEQ_CST);
+  while (atomic_load_explicit(&inbox->trace_refs, __ATOMIC_SEQ_CST)) {
+    _mm_pause();
+  }
+
+  atomic_store_explicit(&trace->stop, true, __ATOMIC_RELEASE);
+  pthread_join(trace->th, NULL);
+
+  x9_write_trace_header(trace);
+  fclose(trace->file);
+  x9_free_inbox(trace->buf);
+  free(trace->record);
+#endif
+  free(trace);
+}
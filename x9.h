@@ -37,8 +37,111 @@
 
 /* --- Opaque types --- */
 
-typedef struct x9_node_internal  x9_node;
-typedef struct x9_inbox_internal x9_inbox;
+typedef struct x9_node_internal             x9_node;
+typedef struct x9_inbox_internal            x9_inbox;
+typedef struct x9_prio_inbox_internal       x9_prio_inbox;
+typedef struct x9_conflating_inbox_internal x9_conflating_inbox;
+typedef struct x9_elastic_inbox_internal    x9_elastic_inbox;
+typedef struct x9_lossy_inbox_internal      x9_lossy_inbox;
+typedef struct x9_executor_internal         x9_executor;
+typedef struct x9_graph_internal            x9_graph;
+typedef struct x9_channel_internal          x9_channel;
+typedef struct x9_journal_internal          x9_journal;
+typedef struct x9_journal_cursor_internal   x9_journal_cursor;
+typedef struct x9_trace_internal            x9_trace;
+
+/* --- Public types --- */
+
+/* Snapshot of the operational counters of a x9_inbox, filled by
+ * 'x9_inbox_stats' (only available when compiled with 'X9_STATS').
+ *  - writes/reads: messages written/read.
+ *  - write_failures/read_failures: non spinning calls that returned 'false'.
+ *  - write_cas_failures/read_cas_failures: compare-and-swaps lost to another
+ *  thread that was using the same slot.
+ *  - write_spins/read_spins: extra iterations done by spinning calls.
+ *  - full_events/empty_events: calls that found a slot still holding an
+ *  unread message/a slot without a message (the read side of 'x9_node_run'
+ *  'x9_serve' and 'x9_graph' stages count one per batch that drained an
+ *  inbox).*/
+typedef struct {
+  uint64_t writes;
+  uint64_t write_failures;
+  uint64_t write_cas_failures;
+  uint64_t write_spins;
+  uint64_t full_events;
+  uint64_t reads;
+  uint64_t read_failures;
+  uint64_t read_cas_failures;
+  uint64_t read_spins;
+  uint64_t empty_events;
+} x9_inbox_counters;
+
+/* Header of the file written by a x9_trace, followed by the records of the
+ * messages, each a uint64_t TSC (of when the message was published) and the
+ * 'msg_sz' bytes of the message, without padding.
+ * 'n_msgs' and 'dropped' are only filled when the trace is stopped, readers
+ * should rely on the size of the file instead.*/
+#define X9_TRACE_MAGIC   "X9TRACE"
+#define X9_TRACE_VERSION 1
+
+typedef struct {
+  char     magic[8]; /* X9_TRACE_MAGIC */
+  uint64_t version;
+  uint64_t msg_sz;
+  uint64_t n_msgs;
+  uint64_t dropped;
+  double   ns_per_cycle; /* Of the TSC of the host that recorded it */
+} x9_trace_header;
+
+/* Maximum number of bytes of args that a task submitted to a x9_executor
+ * can carry inline, which makes a task (function pointer plus args) and the
+ * x9_inbox slot header fit in a single cache line.*/
+#define X9_TASK_ARGS_SZ 48
+
+/* A task run by a x9_executor worker. 'args' points to a copy of the args
+ * given when it was submitted, which is only valid until it returns.*/
+typedef void (*x9_task_fn)(void* const args);
+
+/* Handler of a x9_graph stage, called with each 'msg' read from its input
+ * inbox, the 'outputs' inboxes it was declared with (in the same order), and
+ * the 'ctx' it was given.
+ * 'msg' points to the slot of the input inbox it was written to, and is
+ * only valid until it returns.*/
+typedef void (*x9_stage_fn)(void* const            msg,
+                            x9_inbox* const* const outputs,
+                            void* const            ctx);
+
+/* Handler registered with 'x9_node_register_handler', called by
+ * 'x9_node_run' with each 'msg' read from its inbox and the 'ctx' it was
+ * registered with.
+ * 'msg' points to the slot of the inbox (it is not copied), and is only
+ * valid until it returns.*/
+typedef void (*x9_handler_fn)(void const* const msg, void* const ctx);
+
+/* Handler of the requests of a x9_channel, called by 'x9_serve' with each
+ * 'req', where to write its 'reply' and the 'ctx' it was given.
+ * Both point into the x9_channel (they are not copied), and are only valid
+ * until it returns.*/
+typedef void (*x9_serve_fn)(void const* const req,
+                            void* const       reply,
+                            void* const       ctx);
+
+/* Snapshot of a x9_graph stage, filled by 'x9_graph_stage_stats'.
+ *  - msgs: messages handled.
+ *  - msgs_per_sec: 'msgs' over the time the graph has been running.
+ *  - depth/depth_hwm: see 'x9_inbox_depth_approx'/'x9_inbox_depth_hwm' of
+ *  its input inbox.
+ *  - hop_p50_ns/hop_p99_ns: time messages waited in its input inbox (only
+ *  available when compiled with 'X9_LATENCY' and once 'x9_calibrate_tsc' was
+ *  called, 0 otherwise).*/
+typedef struct {
+  uint64_t msgs;
+  double   msgs_per_sec;
+  uint64_t depth;
+  uint64_t depth_hwm;
+  double   hop_p50_ns;
+  double   hop_p99_ns;
+} x9_stage_stats;
 
 /* --- Public API --- */
 
@@ -155,6 +258,97 @@ __attribute__((nonnull)) void x9_write_to_inbox_spin(
     uint64_t const  msg_sz,
     void const* restrict const msg);
 
+/* Returns the number of slots of the 'inbox' ('sz' in 'x9_create_inbox'). */
+__attribute__((nonnull)) uint64_t x9_inbox_sz(x9_inbox const* const inbox);
+
+/* Returns the number of bytes between consecutive slots of the 'inbox', that
+ * is, its 'msg_sz' plus the per message header (which is larger when compiled
+ * with 'X9_LATENCY').
+ * 'x9_inbox_sz' times this is the memory the ring buffer spans, useful for
+ * checking whether it fits in a given cache level.*/
+__attribute__((nonnull)) uint64_t x9_inbox_slot_sz(
+    x9_inbox const* const inbox);
+
+/* Returns the approximate number of messages pending in the 'inbox', between
+ * 0 and its 'sz'.
+ * The value is computed from the read/write indexes without touching the
+ * slots, and since the spinning functions move the indexes before the message
+ * is actually written/read, it is only a (close) estimate while the 'inbox'
+ * is in use.
+ * Also updates the high-water mark returned by 'x9_inbox_depth_hwm'.
+ * Can be called from any thread, e.g. by a monitoring thread.*/
+__attribute__((nonnull)) uint64_t x9_inbox_depth_approx(x9_inbox* const inbox);
+
+/* Returns the highest depth observed for the 'inbox' since it was created or
+ * since the last call to 'x9_inbox_reset_depth_hwm'.
+ * The high-water mark is updated by 'x9_inbox_depth_approx' samples and by
+ * writers finding the 'inbox' full, hence it costs nothing to the consumer
+ * and the writers' fast path.
+ * IMPORTANT: Peaks below 'sz' that happen between two 'x9_inbox_depth_approx'
+ * samples are missed, only a full 'inbox' is always recorded.*/
+__attribute__((nonnull)) uint64_t x9_inbox_depth_hwm(
+    x9_inbox const* const inbox);
+
+/* Resets the high-water mark of the 'inbox' and returns its previous value.*/
+__attribute__((nonnull)) uint64_t x9_inbox_reset_depth_hwm(
+    x9_inbox* const inbox);
+
+/* Returns 'true' and writes a snapshot of the 'inbox' counters to
+ * 'outparam' if the library was compiled with 'X9_STATS', otherwise returns
+ * 'false' and zeroes 'outparam'.
+ * Producer and consumer counters live on separate cache lines, and are not
+ * compiled at all without 'X9_STATS'.
+ * Can be called from any thread, while the 'inbox' is in use.*/
+__attribute__((nonnull)) bool x9_inbox_stats(
+    x9_inbox const* const inbox, x9_inbox_counters* restrict const outparam);
+
+/* Measures how many nanoseconds a TSC cycle takes (blocks for ~50ms).
+ * Latencies are recorded in TSC cycles and converted when queried, hence
+ * this must be called once at startup, before traffic starts, and before
+ * querying latencies or tracing an inbox. It is never called implicitly.*/
+void x9_calibrate_tsc(void);
+
+/* Returns the nanoseconds per TSC cycle measured by 'x9_calibrate_tsc', or 0
+ * if it was not called yet.*/
+double x9_ns_per_cycle(void);
+
+/* Returns the number of latencies recorded by the 'inbox' since it was
+ * created or since the last call to 'x9_inbox_latency_reset'.
+ * Always returns 0 if the library was not compiled with 'X9_LATENCY'.
+ *
+ * When compiled with 'X9_LATENCY', every message carries the TSC of when it
+ * was published, and readers record how long it waited in the 'inbox' into a
+ * lock-free, log-bucketed histogram (~3% precision) owned by the 'inbox'.*/
+__attribute__((nonnull)) uint64_t x9_inbox_latency_count(
+    x9_inbox const* const inbox);
+
+/* Returns the 'percentile' (0 to 100) of the time, in nanoseconds, messages
+ * waited in the 'inbox' between being published and being read.
+ * Can be called from any thread while the 'inbox' is in use.
+ * Returns 0 if no latency was recorded, if 'x9_calibrate_tsc' was not called
+ * or if the library was not compiled with 'X9_LATENCY'.*/
+__attribute__((nonnull)) double x9_inbox_latency_percentile_ns(
+    x9_inbox const* const inbox, double const percentile);
+
+/* Same as 'x9_inbox_latency_percentile_ns' for 'n' 'percentiles' at once,
+ * which must be sorted in ascending order, writing each result to the same
+ * position of 'outparam'.
+ * Walks the histogram once for all of them and does not allocate, hence it
+ * is cheap enough to be called periodically by a monitoring thread.
+ *
+ * Example:
+ *   double const ps[3] = {50, 99, 99.9};
+ *   double       ns[3] = {0};
+ *   x9_inbox_latency_percentiles_ns(inbox, 3, ps, ns);*/
+__attribute__((nonnull)) void x9_inbox_latency_percentiles_ns(
+    x9_inbox const* const inbox,
+    uint64_t const        n,
+    double const* restrict const percentiles,
+    double* restrict const outparam);
+
+/* Clears the latencies recorded by the 'inbox'. */
+__attribute__((nonnull)) void x9_inbox_latency_reset(x9_inbox* const inbox);
+
 /* Writes the same 'msg' to all 'node' inboxes.
  * Calls 'x9_write_to_inbox_spin' in the background.
  * Users must guarantee that all 'node' inboxes accept messages of the
@@ -164,3 +358,720 @@ __attribute__((nonnull)) void x9_broadcast_msg_to_all_node_inboxes(
     uint64_t const       msg_sz,
     void const* restrict const msg);
 
+/* Registers 'fn' (and its 'ctx') as the handler of the messages of the
+ * 'inbox' of the 'node' that 'x9_node_run' reads, replacing the previous
+ * one if the 'inbox' already had one.
+ * Returns 'false' if the 'node' does not contain the 'inbox' (or allocation
+ * failed), 'true' otherwise.
+ * Inboxes without a handler are not read by 'x9_node_run'.
+ *
+ * Example:
+ *   x9_node_register_handler(node, inbox_1, handle_msg_1, &ctx);*/
+__attribute__((nonnull(1, 2, 3))) bool x9_node_register_handler(
+    x9_node* const      node,
+    x9_inbox* const     inbox,
+    x9_handler_fn const fn,
+    void* const         ctx);
+
+/* Reads the messages ready in the inboxes of the 'node' with a handler, and
+ * calls the handler on each of them in place (without copying them out of
+ * their slot), until 'budget' messages were handled or all of those inboxes
+ * are empty. Returns the number of messages handled.
+ * Each inbox is drained (within the 'budget') before moving on to the next
+ * one, and its read index is only updated once per batch. Every call starts
+ * with the inbox after the one the previous call started with, so that a
+ * continuously fed inbox can not starve the others.
+ * Meant to be called in a loop by the thread consuming the 'node', instead
+ * of reading from each inbox and dispatching on its name.
+ * IMPORTANT: Can only be used when the thread calling this function is the
+ * only thread reading from said inboxes.*/
+__attribute__((nonnull)) uint64_t x9_node_run(x9_node* const node,
+                                              uint64_t const budget);
+
+/* --- Priority inbox --- */
+
+/* Creates a x9_prio_inbox, which groups 'n_lanes' (1 to 64) x9_inbox(es),
+ * each with a buffer of size 'sz' (same rules as 'x9_create_inbox'), under a
+ * single handle.
+ * Lanes are ordered by priority: lane 0 is the most urgent one, and readers
+ * always drain the lowest numbered non-empty lane first. A summary bitmask of
+ * the non-empty lanes makes finding it O(1), regardless of 'n_lanes'.
+ *
+ * Example:
+ *   x9_prio_inbox* inbox =
+ *       x9_create_prio_inbox(2, 512, "ibx", sizeof(<some struct>));*/
+__attribute__((nonnull)) x9_prio_inbox* x9_create_prio_inbox(
+    uint64_t const n_lanes,
+    uint64_t const sz,
+    char const* restrict const name,
+    uint64_t const msg_sz);
+
+/* Returns 'true' if the 'inbox' is valid, 'false' otherwise.
+ * Should always be called after 'x9_create_prio_inbox'.*/
+bool x9_prio_inbox_is_valid(x9_prio_inbox const* const inbox);
+
+/* Returns 'true' if the 'inbox' name == 'cmp', 'false' otherwise.*/
+__attribute__((nonnull)) bool x9_prio_inbox_name_is(
+    x9_prio_inbox const* const inbox, char const* restrict const cmp);
+
+/* Frees the 'inbox' data structure and all of its lanes. */
+__attribute__((nonnull)) void x9_free_prio_inbox(x9_prio_inbox* const inbox);
+
+/* Returns 'true' if the message was written to 'lane' of the 'inbox', 'false'
+ * otherwise.
+ * IMPORTANT: Each lane can only be written by a single writer thread (the
+ * same thread can write to several lanes), as two writers racing for the
+ * same slot can leave a hole that blocks the lane.*/
+__attribute__((nonnull)) bool x9_write_to_prio_inbox(
+    x9_prio_inbox* const inbox,
+    uint64_t const       lane,
+    uint64_t const       msg_sz,
+    void const* restrict const msg);
+
+/* Writes the 'msg' to 'lane' of the 'inbox'.
+ * Uses spinning, that is, it will not return until it has written the 'msg',
+ * and it will keep checking if 'lane' has a free slot it can write to.
+ * Messages of a lane are read in the order they were written.
+ * IMPORTANT: Each lane can only be written by a single writer thread.*/
+__attribute__((nonnull)) void x9_write_to_prio_inbox_spin(
+    x9_prio_inbox* const inbox,
+    uint64_t const       lane,
+    uint64_t const       msg_sz,
+    void const* restrict const msg);
+
+/* Returns 'true' if a message was read, 'false' otherwise.
+ * If 'true', the message, taken from the most urgent non-empty lane, will be
+ * written to 'outparam'.
+ * IMPORTANT: Can only be used by a single reader thread per 'inbox'.*/
+__attribute__((nonnull)) bool x9_read_from_prio_inbox(
+    x9_prio_inbox* const inbox,
+    uint64_t const       msg_sz,
+    void* restrict const outparam);
+
+/* Reads the next message from the most urgent non-empty lane of the 'inbox'
+ * to 'outparam'.
+ * Uses spinning, that is, it will not return until it has read a message.
+ * IMPORTANT: Can only be used by a single reader thread per 'inbox'.*/
+__attribute__((nonnull)) void x9_read_from_prio_inbox_spin(
+    x9_prio_inbox* const inbox,
+    uint64_t const       msg_sz,
+    void* restrict const outparam);
+
+/* --- Conflating inbox --- */
+
+/* Creates a x9_conflating_inbox, which keeps only the latest message per
+ * 64-bit key, for up to 'n_keys' (> 0) distinct keys.
+ * Writing a message for a key that was not read yet overwrites it in place,
+ * hence the backlog is bounded by the number of distinct keys and not by the
+ * rate at which messages are written.
+ *
+ * Example:
+ *   x9_conflating_inbox* inbox =
+ *       x9_create_conflating_inbox(1024, "ibx", sizeof(<some struct>));*/
+__attribute__((nonnull)) x9_conflating_inbox* x9_create_conflating_inbox(
+    uint64_t const n_keys, char const* restrict const name,
+    uint64_t const msg_sz);
+
+/* Returns 'true' if the 'inbox' is valid, 'false' otherwise.
+ * Should always be called after 'x9_create_conflating_inbox'.*/
+bool x9_conflating_inbox_is_valid(x9_conflating_inbox const* const inbox);
+
+/* Returns 'true' if the 'inbox' name == 'cmp', 'false' otherwise.*/
+__attribute__((nonnull)) bool x9_conflating_inbox_name_is(
+    x9_conflating_inbox const* const inbox, char const* restrict const cmp);
+
+/* Frees the 'inbox' data structure and its internal components. */
+__attribute__((nonnull)) void x9_free_conflating_inbox(
+    x9_conflating_inbox* const inbox);
+
+/* Writes the 'msg' as the latest value of 'key', overwriting the previous
+ * one if it was not read yet.
+ * Returns 'false' only if the 'inbox' already holds 'n_keys' other keys.
+ * Can be called by multiple threads concurrently. */
+__attribute__((nonnull)) bool x9_write_to_conflating_inbox(
+    x9_conflating_inbox* const inbox,
+    uint64_t const             key,
+    uint64_t const             msg_sz,
+    void const* restrict const msg);
+
+/* Returns 'true' if a message was read, 'false' otherwise.
+ * If 'true', the newest message of a key that was written since it was last
+ * read will be written to 'outparam', and the key to 'key'.
+ * A key written while it is being read may be returned again later.
+ * IMPORTANT: Can only be used by a single reader thread per 'inbox'.*/
+__attribute__((nonnull)) bool x9_read_from_conflating_inbox(
+    x9_conflating_inbox* const inbox,
+    uint64_t const             msg_sz,
+    uint64_t* restrict const   key,
+    void* restrict const       outparam);
+
+/* Same as 'x9_read_from_conflating_inbox', but uses spinning, that is, it
+ * will not return until it has read a message.
+ * IMPORTANT: Can only be used by a single reader thread per 'inbox'.*/
+__attribute__((nonnull)) void x9_read_from_conflating_inbox_spin(
+    x9_conflating_inbox* const inbox,
+    uint64_t const             msg_sz,
+    uint64_t* restrict const   key,
+    void* restrict const       outparam);
+
+/* --- Elastic inbox --- */
+
+/* Creates a x9_elastic_inbox, a single producer single consumer inbox made
+ * of a chain of x9_inbox(es) (segments), which starts with one segment of
+ * 'min_sz' slots and grows when it becomes full by linking a segment twice as
+ * large, up to 'max_sz' slots per segment.
+ * The reader moves to the next segment once the previous one is drained, and
+ * frees it. When the producer completes a lap of its segment with it mostly
+ * empty (at most a quarter full), it links one half as large, hence memory is
+ * given back once the backpressure is gone.
+ * 'min_sz' and 'max_sz' follow the same rules as 'sz' in 'x9_create_inbox',
+ * and 'max_sz' must be >= 'min_sz'.
+ * Messages are read in the order they were written.
+ *
+ * Example:
+ *   x9_elastic_inbox* inbox =
+ *       x9_create_elastic_inbox(64, 4096, "ibx", sizeof(<some struct>));*/
+__attribute__((nonnull)) x9_elastic_inbox* x9_create_elastic_inbox(
+    uint64_t const min_sz,
+    uint64_t const max_sz,
+    char const* restrict const name,
+    uint64_t const msg_sz);
+
+/* Returns 'true' if the 'inbox' is valid, 'false' otherwise.
+ * Should always be called after 'x9_create_elastic_inbox'.*/
+bool x9_elastic_inbox_is_valid(x9_elastic_inbox const* const inbox);
+
+/* Returns 'true' if the 'inbox' name == 'cmp', 'false' otherwise.*/
+__attribute__((nonnull)) bool x9_elastic_inbox_name_is(
+    x9_elastic_inbox const* const inbox, char const* restrict const cmp);
+
+/* Frees the 'inbox' data structure and all of its segments. */
+__attribute__((nonnull)) void x9_free_elastic_inbox(
+    x9_elastic_inbox* const inbox);
+
+/* Returns the number of slots of all the segments of the 'inbox' that were
+ * not freed yet.
+ * Can be called from any thread, while the 'inbox' is in use.*/
+__attribute__((nonnull)) uint64_t x9_elastic_inbox_sz(
+    x9_elastic_inbox const* const inbox);
+
+/* Returns 'true' if the message was written to the 'inbox', 'false' if its
+ * newest segment is full and already 'max_sz' slots (or allocating a new one
+ * failed).
+ * Costs the same as 'x9_write_to_inbox' while the current segment has free
+ * slots.
+ * IMPORTANT: Can only be used by a single writer thread per 'inbox'.*/
+__attribute__((nonnull)) bool x9_write_to_elastic_inbox(
+    x9_elastic_inbox* const inbox,
+    uint64_t const          msg_sz,
+    void const* restrict const msg);
+
+/* Writes the 'msg' to the 'inbox'.
+ * Uses spinning, that is, it will not return until it has written the 'msg'.
+ * It only spins when the 'inbox' is full and can not grow any further,
+ * otherwise it grows it and returns right away.
+ * IMPORTANT: Can only be used by a single writer thread per 'inbox'.*/
+__attribute__((nonnull)) void x9_write_to_elastic_inbox_spin(
+    x9_elastic_inbox* const inbox,
+    uint64_t const          msg_sz,
+    void const* restrict const msg);
+
+/* Returns 'true' if a message was read, 'false' otherwise.
+ * If 'true', the message will be written to 'outparam'.
+ * IMPORTANT: Can only be used by a single reader thread per 'inbox'.*/
+__attribute__((nonnull)) bool x9_read_from_elastic_inbox(
+    x9_elastic_inbox* const inbox,
+    uint64_t const          msg_sz,
+    void* restrict const    outparam);
+
+/* Reads the next message of the 'inbox' to 'outparam'.
+ * Uses spinning, that is, it will not return until it has read a message.
+ * IMPORTANT: Can only be used by a single reader thread per 'inbox'.*/
+__attribute__((nonnull)) void x9_read_from_elastic_inbox_spin(
+    x9_elastic_inbox* const inbox,
+    uint64_t const          msg_sz,
+    void* restrict const    outparam);
+
+/* --- Lossy inbox --- */
+
+/* Creates a x9_lossy_inbox with a buffer of size 'sz' (same rules as
+ * 'x9_create_inbox'), where the writer never waits: when the reader falls
+ * 'sz' messages behind, the oldest unread message is overwritten.
+ * Every slot is guarded by a sequence number (seqlock), which the reader uses
+ * to detect that a message was overwritten before or while it read it, in
+ * which case it skips to the oldest message that is still valid and reports
+ * how many were dropped.
+ * Meant for telemetry (metrics, debug traces, ...), where losing old messages
+ * is preferable to making the producer wait.
+ *
+ * Example:
+ *   x9_lossy_inbox* inbox =
+ *       x9_create_lossy_inbox(1024, "ibx", sizeof(<some struct>));*/
+__attribute__((nonnull)) x9_lossy_inbox* x9_create_lossy_inbox(
+    uint64_t const sz, char const* restrict const name, uint64_t const msg_sz);
+
+/* Returns 'true' if the 'inbox' is valid, 'false' otherwise.
+ * Should always be called after 'x9_create_lossy_inbox'.*/
+bool x9_lossy_inbox_is_valid(x9_lossy_inbox const* const inbox);
+
+/* Returns 'true' if the 'inbox' name == 'cmp', 'false' otherwise.*/
+__attribute__((nonnull)) bool x9_lossy_inbox_name_is(
+    x9_lossy_inbox const* const inbox, char const* restrict const cmp);
+
+/* Frees the 'inbox' data structure and its internal components. */
+__attribute__((nonnull)) void x9_free_lossy_inbox(x9_lossy_inbox* const inbox);
+
+/* Writes the 'msg' to the 'inbox', overwriting the oldest message if it was
+ * not read yet.
+ * Always succeeds, and its cost does not depend on the reader.
+ * IMPORTANT: Can only be used by a single writer thread per 'inbox'.*/
+__attribute__((nonnull)) void x9_write_to_lossy_inbox(
+    x9_lossy_inbox* const inbox,
+    uint64_t const        msg_sz,
+    void const* restrict const msg);
+
+/* Returns 'true' if a message was read, 'false' otherwise.
+ * If 'true', the oldest message that was not overwritten will be written to
+ * 'outparam'.
+ * 'dropped' is set to the number of messages that were overwritten before
+ * they could be read, and hence skipped, by this call.
+ * IMPORTANT: Can only be used by a single reader thread per 'inbox'.*/
+__attribute__((nonnull)) bool x9_read_from_lossy_inbox(
+    x9_lossy_inbox* const    inbox,
+    uint64_t const           msg_sz,
+    void* restrict const     outparam,
+    uint64_t* restrict const dropped);
+
+/* Same as 'x9_read_from_lossy_inbox', but uses spinning, that is, it will
+ * not return until it has read a message.
+ * IMPORTANT: Can only be used by a single reader thread per 'inbox'.*/
+__attribute__((nonnull)) void x9_read_from_lossy_inbox_spin(
+    x9_lossy_inbox* const    inbox,
+    uint64_t const           msg_sz,
+    void* restrict const     outparam,
+    uint64_t* restrict const dropped);
+
+/* Returns the number of messages of the 'inbox' that were overwritten before
+ * being read, since it was created.
+ * Can be called from any thread, while the 'inbox' is in use.*/
+__attribute__((nonnull)) uint64_t x9_lossy_inbox_dropped(
+    x9_lossy_inbox const* const inbox);
+
+/* --- Executor --- */
+
+/* Creates a x9_executor, a pool of 'n_workers' threads, each with its own
+ * x9_inbox of 'sz' slots (same rules as 'x9_create_inbox') where submitted
+ * tasks are written to.
+ * Workers run the tasks of their own inbox and, when it is empty, steal from
+ * the inboxes of their siblings, hence a worker stuck on a long task doesn't
+ * hold back the ones queued behind it.
+ * If 'cores' is not NULL, worker 'k' is pinned to core 'cores[k]'.
+ * Idle workers spin (as the '_spin' functions do) instead of sleeping, hence
+ * a task starts with the latency of a x9_inbox, at the cost of keeping all
+ * of the 'n_workers' cores busy.
+ *
+ * Example:
+ *   uint64_t const cores[] = {2, 3, 4, 5};
+ *   x9_executor* executor = x9_create_executor(4, cores, 1024, "exec");*/
+__attribute__((nonnull(4))) x9_executor* x9_create_executor(
+    uint64_t const n_workers,
+    uint64_t const* const cores,
+    uint64_t const sz,
+    char const* restrict const name);
+
+/* Returns 'true' if the 'executor' is valid, 'false' otherwise.
+ * Should always be called after 'x9_create_executor'.*/
+bool x9_executor_is_valid(x9_executor const* const executor);
+
+/* Returns 'true' if the 'executor' name == 'cmp', 'false' otherwise.*/
+__attribute__((nonnull)) bool x9_executor_name_is(
+    x9_executor const* const executor, char const* restrict const cmp);
+
+/* Waits for the workers to run every task submitted so far, stops them and
+ * frees the 'executor' data structure and its internal components.*/
+__attribute__((nonnull)) void x9_free_executor(x9_executor* const executor);
+
+/* Returns 'true' if the task was written to the inbox of a worker, 'false'
+ * if all of them were full.
+ * Workers are tried in round-robin order, and 'args_sz' bytes of 'args'
+ * (<= X9_TASK_ARGS_SZ) are copied into the task, hence nothing is allocated.
+ * IMPORTANT: Can only be used by a single thread per 'executor' (which must
+ * not be one of its workers).*/
+__attribute__((nonnull(1, 2))) bool x9_executor_submit(
+    x9_executor* const executor,
+    x9_task_fn const   fn,
+    uint64_t const     args_sz,
+    void const* restrict const args);
+
+/* Same as 'x9_executor_submit', but uses spinning, that is, it will not
+ * return until a worker had a free slot for the task.
+ * IMPORTANT: Can only be used by a single thread per 'executor' (which must
+ * not be one of its workers).*/
+__attribute__((nonnull(1, 2))) void x9_executor_submit_spin(
+    x9_executor* const executor,
+    x9_task_fn const   fn,
+    uint64_t const     args_sz,
+    void const* restrict const args);
+
+/* Same as 'x9_executor_submit', but writes the task to the inbox of
+ * 'worker' (< 'n_workers') only, e.g. to run it where its data is hot.
+ * It can still be stolen by a sibling if 'worker' is busy.
+ * IMPORTANT: Can only be used by a single thread per 'executor' (which must
+ * not be one of its workers).*/
+__attribute__((nonnull(1, 3))) bool x9_executor_submit_to(
+    x9_executor* const executor,
+    uint64_t const     worker,
+    x9_task_fn const   fn,
+    uint64_t const     args_sz,
+    void const* restrict const args);
+
+/* Returns the number of tasks run by 'worker', including the stolen ones.
+ * Can be called from any thread, while the 'executor' is in use.*/
+__attribute__((nonnull)) uint64_t x9_executor_tasks_run(
+    x9_executor const* const executor, uint64_t const worker);
+
+/* Returns the number of tasks 'worker' stole from the inbox of a sibling.
+ * Can be called from any thread, while the 'executor' is in use.*/
+__attribute__((nonnull)) uint64_t x9_executor_tasks_stolen(
+    x9_executor const* const executor, uint64_t const worker);
+
+/* --- Graph --- */
+
+/* Creates a x9_graph, a runtime that drives stages (a handler reading from
+ * one inbox and writing to zero or more) connected by x9_inbox(es), in
+ * 'n_threads' threads, several stages per thread when they are light.
+ * If 'cores' is not NULL, thread 'k' is pinned to core 'cores[k]'.
+ * Each thread visits its stages in turns, handling up to 'batch' (> 0)
+ * messages of a stage per turn, and spins when none of them had any.
+ * Messages are handled in place, and the read index of the input is only
+ * updated once per turn, same as 'x9_node_run'.
+ * A stage is only handed as many messages as every one of its outputs has
+ * free slots for (checked once per turn), hence a handler that writes at
+ * most one message per output can use 'x9_write_to_inbox' and never fail,
+ * and a full inbox never blocks a thread from running its other stages
+ * (which may be the ones draining it).
+ *
+ * Example:
+ *   uint64_t const cores[] = {2, 3};
+ *   x9_graph* graph = x9_create_graph("graph", 2, cores, 32);*/
+__attribute__((nonnull(1))) x9_graph* x9_create_graph(
+    char const* restrict const name,
+    uint64_t const n_threads,
+    uint64_t const* const cores,
+    uint64_t const batch);
+
+/* Returns 'true' if the 'graph' is valid, 'false' otherwise.
+ * Should always be called after 'x9_create_graph'.*/
+bool x9_graph_is_valid(x9_graph const* const graph);
+
+/* Returns 'true' if the 'graph' name == 'cmp', 'false' otherwise.*/
+__attribute__((nonnull)) bool x9_graph_name_is(x9_graph const* const graph,
+                                               char const* restrict const cmp);
+
+/* Stops the 'graph' if it is running, and frees the 'graph' data structure
+ * and its internal components.
+ * The inboxes are owned by the user, and must be freed separately. */
+__attribute__((nonnull)) void x9_free_graph(x9_graph* const graph);
+
+/* Variadic function that adds a stage called 'name' to the 'graph', run by
+ * thread 'thread' (< 'n_threads'), which calls 'fn' with each message read
+ * from 'input', the 'n_outputs' inboxes passed after it and 'ctx'.
+ * Returns 'true' if the stage was added, 'false' otherwise.
+ * IMPORTANT: Stages can only be added before 'x9_graph_start'. Every inbox
+ * can only be the input of one stage, and only be written to by the stages
+ * of one thread (or by a single thread outside of the 'graph'). To merge
+ * inboxes written by different threads, add one stage per inbox with the
+ * same 'fn' and 'ctx' to the same thread.
+ *
+ * Example:
+ *   x9_graph_add_stage(graph, "risk", 1, orders, risk_fn, &ctx, 1, gateway);*/
+__attribute__((nonnull(1, 2, 4, 5))) bool x9_graph_add_stage(
+    x9_graph* const graph,
+    char const* restrict const name,
+    uint64_t const    thread,
+    x9_inbox* const   input,
+    x9_stage_fn const fn,
+    void* const       ctx,
+    uint64_t const    n_outputs,
+    ...);
+
+/* Starts the threads of the 'graph'.
+ * Returns 'true' if all of them were started, 'false' otherwise (in which
+ * case the ones that were are stopped).
+ * IMPORTANT: 'x9_graph_start', 'x9_graph_stop' and 'x9_free_graph' must be
+ * called from the same thread.*/
+__attribute__((nonnull)) bool x9_graph_start(x9_graph* const graph);
+
+/* Stops the threads of the 'graph', each once none of its stages has
+ * anything to do, and waits for them.
+ * Messages the stages could not handle yet are left in their inboxes, hence
+ * it should be called once the last stages handled everything expected.*/
+__attribute__((nonnull)) void x9_graph_stop(x9_graph* const graph);
+
+/* Fills 'outparam' with the stats of the stage called 'name'.
+ * Returns 'false' if the 'graph' has no such stage, 'true' otherwise.
+ * Can be called from any thread, while the 'graph' is running or once it was
+ * stopped, and neither allocates nor blocks, hence a monitoring thread can
+ * poll it and format the results as it sees fit.*/
+__attribute__((nonnull)) bool x9_graph_stage_stats(
+    x9_graph* const graph,
+    char const* restrict const name,
+    x9_stage_stats* restrict const outparam);
+
+/* --- Channel --- */
+
+/* Creates a x9_channel, a request/reply channel between a client thread,
+ * which calls the server with requests of 'req_sz' bytes, and a server
+ * thread, which answers each of them with a reply of 'reply_sz' bytes.
+ * Requests are written to a x9_inbox of 'sz' slots (same rules as
+ * 'x9_create_inbox'), prefixed by the id of the call, and replies are
+ * written by the server straight into the entry of the table of pending
+ * calls (also of 'sz' entries, each on its own cache line(s)) that the id
+ * maps to, which the client polls. Hence up to 'sz' calls can be pending
+ * (pipelined), the server can reply to them in any order, and nothing is
+ * allocated per call.
+ * When a request plus 16 bytes fits in a cache line and a reply plus 16
+ * bytes does too, a call moves one cache line each way.
+ * IMPORTANT: Only a single client thread and a single server thread can use
+ * a 'chan'. A server serving several clients should use a channel per
+ * client, and serve all of them in its loop.
+ *
+ * Example:
+ *   x9_channel* chan = x9_create_channel(
+ *       64, "chan", sizeof(<request struct>), sizeof(<reply struct>));*/
+__attribute__((nonnull)) x9_channel* x9_create_channel(
+    uint64_t const sz,
+    char const* restrict const name,
+    uint64_t const req_sz,
+    uint64_t const reply_sz);
+
+/* Returns 'true' if the 'chan' is valid, 'false' otherwise.
+ * Should always be called after 'x9_create_channel'.*/
+bool x9_channel_is_valid(x9_channel const* const chan);
+
+/* Returns 'true' if the 'chan' name == 'cmp', 'false' otherwise.*/
+__attribute__((nonnull)) bool x9_channel_name_is(
+    x9_channel const* const chan, char const* restrict const cmp);
+
+/* Frees the 'chan' data structure and its internal components. */
+__attribute__((nonnull)) void x9_free_channel(x9_channel* const chan);
+
+/* Sends the request 'req' (of 'req_sz' bytes) to the server, without waiting
+ * for the reply.
+ * Returns the id of the call (> 0), to be passed to 'x9_call_poll', or 0
+ * if the request could not be sent because the call 'sz' calls before this
+ * one was not replied to and polled yet, or the requests inbox is full.
+ * IMPORTANT: Can only be used by the client thread of the 'chan'.
+ * IMPORTANT: Calls can not be cancelled and do not expire. A call that is
+ * never polled keeps its entry pending forever, hence every 'sz'-th call
+ * after it fails until it is polled.*/
+__attribute__((nonnull)) uint64_t x9_call_async(x9_channel* const chan,
+                                                void const* restrict const req);
+
+/* Returns 'true' if the server replied to the call 'id', 'false' otherwise.
+ * If 'true', the reply (of 'reply_sz' bytes) will be written to 'reply', and
+ * the 'id' can no longer be polled.
+ * Calls can be polled in any order.
+ * IMPORTANT: Can only be used by the client thread of the 'chan'.*/
+__attribute__((nonnull)) bool x9_call_poll(x9_channel* const    chan,
+                                           uint64_t const       id,
+                                           void* restrict const reply);
+
+/* Sends the request 'req' to the server and writes its reply to 'reply'.
+ * Uses spinning, that is, it will not return until the server replied, and
+ * until the request could be sent if it could not right away.
+ * IMPORTANT: Can only be used by the client thread of the 'chan'.*/
+__attribute__((nonnull)) void x9_call(x9_channel* const chan,
+                                      void const* restrict const req,
+                                      void* restrict const reply);
+
+/* Reads the requests of the 'chan' that are ready, and calls 'fn' on each
+ * of them in place, with where to write its reply, replying once it returns,
+ * until 'budget' requests were handled or there are none left.
+ * Returns the number of requests handled.
+ * Meant to be called in a loop by the server thread.
+ * IMPORTANT: Can only be used by the server thread of the 'chan'.*/
+__attribute__((nonnull(1, 2))) uint64_t x9_serve(x9_channel* const chan,
+                                                 x9_serve_fn const fn,
+                                                 void* const       ctx,
+                                                 uint64_t const    budget);
+
+/* Returns 'true' if a request was read, 'false' otherwise.
+ * If 'true', the request will be written to 'req', and the id of its call
+ * to 'id', which must be replied to (in any order) with
+ * 'x9_channel_reply'.
+ * For servers that don't reply right away, otherwise see 'x9_serve'.
+ * IMPORTANT: Can only be used by the server thread of the 'chan'.*/
+__attribute__((nonnull)) bool x9_channel_recv(x9_channel* const        chan,
+                                              void* restrict const     req,
+                                              uint64_t* restrict const id);
+
+/* Replies to the call 'id' (read with 'x9_channel_recv') with 'reply'.
+ * IMPORTANT: Can only be used by the server thread of the 'chan', and only
+ * once per 'id'.*/
+__attribute__((nonnull)) void x9_channel_reply(
+    x9_channel* const chan,
+    uint64_t const    id,
+    void const* restrict const reply);
+
+/* --- Journal --- */
+
+/* Creates a x9_journal, an append-only inbox whose slots are memory mapped
+ * segment files of 'seg_sz' messages each, called '<path>.0', '<path>.1',
+ * and so on, up to 'max_segs' of them. Each message gets a sequence number
+ * (0, 1, ...), and is written straight into the file, hence journaling it
+ * costs no extra copy.
+ * Messages are never overwritten, instead consumers attach a cursor at any
+ * sequence number (see 'x9_journal_attach') and read from there, e.g. to
+ * replay a session.
+ * A background thread creates and prefaults the next segment before the
+ * writer needs it, and 'msync's what was written every 'sync_interval_ms'
+ * (which must be > 0).
+ * If the files of a previous journal with the same 'path', 'seg_sz' and
+ * 'msg_sz' exist (e.g. after a crash), they are reopened, and writing
+ * resumes after the last message that was completely written.
+ * IMPORTANT: Existing files are never truncated, if any of them does not
+ * have the size implied by 'seg_sz' and 'msg_sz', or if there is a gap
+ * between them, it returns NULL instead.
+ * IMPORTANT: A journal holds at most 'seg_sz' * 'max_segs' messages, after
+ * which writes fail. Segments are not recycled, and all of them stay
+ * mapped until 'x9_free_journal', hence 'max_segs' bounds both the disk
+ * and the address space it uses.
+ *
+ * Example:
+ *   x9_journal* journal = x9_create_journal(
+ *       "/data/orders", 65536, 64, sizeof(<some struct>), 10);*/
+__attribute__((nonnull)) x9_journal* x9_create_journal(
+    char const* restrict const path,
+    uint64_t const seg_sz,
+    uint64_t const max_segs,
+    uint64_t const msg_sz,
+    uint64_t const sync_interval_ms);
+
+/* Returns 'true' if the 'journal' is valid, 'false' otherwise.
+ * Should always be called after 'x9_create_journal'.*/
+bool x9_journal_is_valid(x9_journal const* const journal);
+
+/* Returns 'true' if the 'journal' path == 'cmp', 'false' otherwise.*/
+__attribute__((nonnull)) bool x9_journal_name_is(
+    x9_journal const* const journal, char const* restrict const cmp);
+
+/* Stops the background thread (after a last 'msync'), unmaps the segments
+ * and frees the 'journal' data structure and its internal components.
+ * The files are kept, and the cursors must be detached before.*/
+__attribute__((nonnull)) void x9_free_journal(x9_journal* const journal);
+
+/* Returns 'true' if the 'msg' was written to the 'journal', 'false'
+ * otherwise, which happens when the next segment is not mapped yet or the
+ * 'journal' is full ('max_segs' segments written).
+ * IMPORTANT: Can only be used by a single writer thread per 'journal'.*/
+__attribute__((nonnull)) bool x9_write_to_journal(
+    x9_journal* const journal,
+    uint64_t const    msg_sz,
+    void const* restrict const msg);
+
+/* Writes the 'msg' to the 'journal'.
+ * Uses spinning, that is, it will not return until the next segment is
+ * mapped, if it had to move to it.
+ * IMPORTANT: Can only be used by a single writer thread per 'journal', and
+ * never returns if the 'journal' is full.*/
+__attribute__((nonnull)) void x9_write_to_journal_spin(
+    x9_journal* const journal,
+    uint64_t const    msg_sz,
+    void const* restrict const msg);
+
+/* Returns the number of messages written to the 'journal', which is also
+ * the sequence number of the next one.
+ * Can be called from any thread.*/
+__attribute__((nonnull)) uint64_t x9_journal_seq(
+    x9_journal const* const journal);
+
+/* Returns the number of messages of the 'journal' that were 'msync'ed to
+ * its files.
+ * Can be called from any thread.*/
+__attribute__((nonnull)) uint64_t x9_journal_synced_seq(
+    x9_journal const* const journal);
+
+/* Creates a cursor, that reads the messages of the 'journal' in order
+ * starting at sequence number 'seq', which can be that of a message written
+ * in the past (to replay from it) or in the future.
+ * Returns NULL if 'seq' is beyond the capacity of the 'journal' or if
+ * allocation failed.
+ * Each cursor belongs to a single reader thread, and any number of them can
+ * read from the same 'journal' without affecting the writer.
+ *
+ * Example:
+ *   x9_journal_cursor* cursor = x9_journal_attach(journal, 0);*/
+__attribute__((nonnull)) x9_journal_cursor* x9_journal_attach(
+    x9_journal* const journal, uint64_t const seq);
+
+/* Frees the 'cursor'. */
+__attribute__((nonnull)) void x9_journal_detach(
+    x9_journal_cursor* const cursor);
+
+/* Returns the sequence number of the next message the 'cursor' reads. */
+__attribute__((nonnull)) uint64_t x9_journal_cursor_seq(
+    x9_journal_cursor const* const cursor);
+
+/* Returns 'true' if a message was read, 'false' otherwise.
+ * If 'true', the message at the 'cursor' will be written to 'outparam', and
+ * the 'cursor' moves to the next one.*/
+__attribute__((nonnull)) bool x9_read_from_journal(
+    x9_journal_cursor* const cursor,
+    uint64_t const           msg_sz,
+    void* restrict const     outparam);
+
+/* Reads the message at the 'cursor' to 'outparam'.
+ * Uses spinning, that is, it will not return until it has read a message.*/
+__attribute__((nonnull)) void x9_read_from_journal_spin(
+    x9_journal_cursor* const cursor,
+    uint64_t const           msg_sz,
+    void* restrict const     outparam);
+
+/* --- Trace --- */
+
+/* Starts capturing the messages written to the 'inbox' (with
+ * 'x9_write_to_inbox' and 'x9_write_to_inbox_spin', hence also by
+ * 'x9_broadcast_msg_to_all_node_inboxes') to the file at 'path', which is
+ * created in the format of 'x9_trace_header', and must not exist yet (a
+ * previous capture is never overwritten).
+ * Writers copy each message, next to the TSC of when it was published, to a
+ * x9_inbox of 'buf_sz' slots (same rules as 'x9_create_inbox'), and a
+ * background thread appends them to the file. Writers never wait for it: a
+ * message that doesn't fit is dropped from the trace (see
+ * 'x9_trace_dropped'), never from the 'inbox'.
+ * Returns NULL if the library was not compiled with 'X9_TRACE', if the
+ * 'inbox' is already traced, or if the file already exists or could not
+ * be created.
+ * Returns NULL as well if 'x9_calibrate_tsc' was not called before, as the
+ * trace header records its result.
+ * Can be called while the 'inbox' is in use.
+ *
+ * Example:
+ *   x9_trace* trace = x9_trace_inbox(inbox, "/tmp/orders.x9trace", 4096);*/
+__attribute__((nonnull)) x9_trace* x9_trace_inbox(
+    x9_inbox* const inbox,
+    char const* restrict const path,
+    uint64_t const buf_sz);
+
+/* Returns 'true' if the 'trace' is valid, 'false' otherwise.
+ * Should always be called after 'x9_trace_inbox'.*/
+bool x9_trace_is_valid(x9_trace const* const trace);
+
+/* Returns the number of messages written to the file of the 'trace'.
+ * Can be called from any thread.*/
+__attribute__((nonnull)) uint64_t x9_trace_n_msgs(x9_trace const* const trace);
+
+/* Returns the number of messages that were left out of the 'trace', because
+ * its buffer was full or the file could not be written.
+ * Can be called from any thread.*/
+__attribute__((nonnull)) uint64_t x9_trace_dropped(
+    x9_trace const* const trace);
+
+/* Stops capturing the messages of the traced inbox, waits for the writers
+ * that were recording one, writes the messages left to the file, fills its
+ * header and closes it, and frees the 'trace' data structure and its
+ * internal components.
+ * Can be called while the inbox is in use, but must be called before the
+ * inbox is freed.*/
+__attribute__((nonnull)) void x9_trace_stop(x9_trace* const trace);
@@ -0,0 +1,442 @@
+/*
+   X9 - high performance message passing library.
+   Copyright (c) 2023, Diogo Flores
+
+   BSD 2-Clause License (https://opensource.org/license/bsd-2-clause/)
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are
+   met:
+
+       * Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+       * Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   You can contact the author at: diogoxflores@gmail.com
+*/
+
+/* C++20 interface to x9.h (requires '-std=c++20'), the library itself is
+ * still compiled as C and linked with x9.c.
+ *
+ * Coroutines:
+ *   A x9::scheduler runs x9::task(s) (coroutines) in the thread that calls
+ *   'run', which can 'co_await' reading from/writing to the inboxes attached
+ *   to the scheduler. Instead of spinning, a coroutine that can't read/write
+ *   yet is suspended, and the scheduler polls the inboxes that have
+ *   coroutines waiting on them and resumes them (in batches) once they can,
+ *   hence thousands of them can share a single (pinned) thread without
+ *   context switches.
+ *
+ *   x9::scheduler sched;
+ *   x9::async_inbox ibx = sched.attach(inbox);
+ *
+ *   x9::task consumer(x9::async_inbox ibx) {
+ *     for (;;) {
+ *       msg const m = co_await ibx.read<msg>();
+ *       ...
+ *     }
+ *   }
+ *
+ *   sched.spawn(consumer(ibx));
+ *   sched.run();
+ *
+ * Typed inboxes:
+ *   A x9::inbox<T, Capacity> owns a x9_inbox of 'Capacity' slots of
+ *   messages of type 'T', hence the 'msg_sz' can't disagree with the inbox.
+ *   Its reads/writes are inlined from x9_inline.h, with 'sizeof(T)' and
+ *   'Capacity' as constants.
+ *   IMPORTANT: Code that includes x9.hpp must be compiled with the same
+ *   'X9_STATS', 'X9_LATENCY' and 'X9_TRACE' as x9.c, which share the layout
+ *   of the x9_inbox (otherwise it fails to link, on 'x9_layout_*').
+ *
+ *   x9::inbox<msg, 512> inbox{"ibx"};
+ *   inbox.write_spin(msg{...});
+ *   msg const m = inbox.read_spin(); */
+
+#pragma once
+
+#include <bit>         /* std::bit_cast */
+#include <coroutine>   /* std::coroutine_handle, std::suspend_always */
+#include <cstdint>     /* uint64_t */
+#include <exception>   /* std::terminate */
+#include <memory>      /* std::unique_ptr, std::make_unique */
+#include <new>         /* std::bad_alloc */
+#include <type_traits> /* std::is_trivially_copyable_v */
+#include <utility>     /* std::exchange */
+#include <vector>      /* std::vector */
+#include <x86intrin.h> /* _mm_pause */
+
+/* 'restrict' is not a C++ keyword, any 'restrict' macro of the user is
+ * restored afterwards. */
+#pragma push_macro("restrict")
+#undef restrict
+#define restrict __restrict
+extern "C" {
+#include "x9.h"
+}
+#include "x9_inline.h"
+#pragma pop_macro("restrict")
+
+namespace x9 {
+
+/* Owns a x9_inbox of 'Capacity' slots (same rules as 'x9_create_inbox'),
+ * which is freed by the destructor. Move-only.
+ * Its member functions are the x9_inbox functions of the same name, inlined
+ * with 'sizeof(T)' as the 'msg_sz', and have the same requirements (e.g.
+ * 'read' must only be called by a single thread). */
+template <typename T, uint64_t Capacity>
+class inbox {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "x9 messages are copied with memcpy");
+  static_assert((Capacity > 0) && !(Capacity % 2),
+                "Capacity must be positive and mod 2 == 0");
+
+ public:
+  static constexpr uint64_t capacity = Capacity;
+  static constexpr uint64_t msg_sz   = sizeof(T);
+
+  /* 'Capacity' is checked at compile time, hence 'x9_create_inbox' can only
+   * fail to allocate, in which case it throws std::bad_alloc. */
+  explicit inbox(char const* const name)
+      : inbox_(x9_create_inbox(Capacity, name, sizeof(T))) {
+    X9_LAYOUT();
+    if (!x9_inbox_is_valid(inbox_)) { throw std::bad_alloc{}; }
+  }
+
+  inbox(inbox&& other) noexcept : inbox_(std::exchange(other.inbox_, {})) {}
+  inbox& operator=(inbox&& other) noexcept {
+    if (this != &other) {
+      if (inbox_) { x9_free_inbox(inbox_); }
+      inbox_ = std::exchange(other.inbox_, {});
+    }
+    return *this;
+  }
+  inbox(inbox const&)            = delete;
+  inbox& operator=(inbox const&) = delete;
+  ~inbox() {
+    if (inbox_) { x9_free_inbox(inbox_); }
+  }
+
+  bool write(T const& msg) noexcept {
+    return detail::x9_write_to_inbox_inline(inbox_, shape_, sizeof(T), &msg);
+  }
+
+  void write_spin(T const& msg) noexcept {
+    detail::x9_write_to_inbox_spin_inline(inbox_, shape_, sizeof(T), &msg);
+  }
+
+  bool read(T& outparam) noexcept {
+    return detail::x9_read_from_inbox_inline(inbox_, shape_, sizeof(T),
+                                             &outparam);
+  }
+
+  T read_spin() noexcept {
+    /* Uninitialized, hence 'T' doesn't have to be default constructible. */
+    alignas(T) unsigned char msg[sizeof(T)];
+    detail::x9_read_from_inbox_spin_inline(inbox_, shape_, sizeof(T), msg);
+    return std::bit_cast<T>(msg);
+  }
+
+  bool read_shared(T& outparam) noexcept {
+    return detail::x9_read_from_shared_inbox_inline(inbox_, shape_, sizeof(T),
+                                                    &outparam);
+  }
+
+  T read_shared_spin() noexcept {
+    alignas(T) unsigned char msg[sizeof(T)];
+    detail::x9_read_from_shared_inbox_spin_inline(inbox_, shape_, sizeof(T),
+                                                  msg);
+    return std::bit_cast<T>(msg);
+  }
+
+  uint64_t depth_approx() noexcept { return x9_inbox_depth_approx(inbox_); }
+
+  /* The underlying x9_inbox, still owned by this, e.g. to attach it to a
+   * x9_node or a x9::scheduler. NULL once moved from or released. */
+  x9_inbox* get() const noexcept { return inbox_; }
+
+  /* Gives up the ownership of the underlying x9_inbox, which the caller
+   * must free with 'x9_free_inbox'. */
+  x9_inbox* release() noexcept { return std::exchange(inbox_, {}); }
+
+ private:
+  /* Same as the one of the x9_inbox created, folded in the reads/writes. */
+  static constexpr x9_inbox_shape shape_ = {
+      Capacity, X9_FASTMOD_CONSTANT(Capacity), sizeof(T)};
+
+  x9_inbox* inbox_;
+};
+
+class scheduler;
+
+/* Coroutine run by a x9::scheduler, which owns it once spawned.
+ * Exceptions escaping it call 'std::terminate'. */
+class task {
+ public:
+  struct promise_type {
+    task get_return_object() noexcept {
+      return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    /* Only starts running once the scheduler resumes it. */
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    /* Destroyed by the scheduler. */
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void                return_void() noexcept {}
+    void                unhandled_exception() noexcept { std::terminate(); }
+  };
+
+  task(task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  task(task const&)            = delete;
+  task& operator=(task const&) = delete;
+  task& operator=(task&&)      = delete;
+  ~task() {
+    if (handle_) { handle_.destroy(); }
+  }
+
+ private:
+  friend class scheduler;
+  explicit task(std::coroutine_handle<promise_type> const handle) noexcept
+      : handle_(handle) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+/* A coroutine suspended on an inbox, lives in its frame. */
+struct waiter {
+  std::coroutine_handle<> handle;
+  void*                   msg; /* Read to/written from */
+  uint64_t                msg_sz;
+  waiter*                 next;
+};
+
+/* Intrusive FIFO, hence suspending doesn't allocate. */
+struct waiter_queue {
+  waiter* head = nullptr;
+  waiter* tail = nullptr;
+
+  bool empty() const noexcept { return nullptr == head; }
+
+  void push(waiter* const w) noexcept {
+    w->next = nullptr;
+    if (nullptr == tail) {
+      head = w;
+    } else {
+      tail->next = w;
+    }
+    tail = w;
+  }
+
+  waiter* pop() noexcept {
+    waiter* const w = head;
+    head            = w->next;
+    if (nullptr == head) { tail = nullptr; }
+    return w;
+  }
+};
+
+/* An inbox attached to a x9::scheduler. */
+struct registration {
+  x9_inbox*    inbox = nullptr;
+  waiter_queue readers;
+  waiter_queue writers;
+};
+
+}  // namespace detail
+
+/* Awaitable returned by 'x9::async_inbox::read', results in the message. */
+template <typename T>
+class read_awaiter {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "x9 messages are copied with memcpy");
+
+ public:
+  /* Doesn't jump ahead of coroutines already waiting on the inbox. */
+  bool await_ready() noexcept {
+    return reg_->readers.empty() &&
+           x9_read_from_inbox(reg_->inbox, sizeof(T), msg_);
+  }
+  void await_suspend(std::coroutine_handle<> const handle) noexcept {
+    waiter_ = {handle, msg_, sizeof(T), nullptr};
+    reg_->readers.push(&waiter_);
+  }
+  T await_resume() noexcept { return std::bit_cast<T>(msg_); }
+
+ private:
+  friend class async_inbox;
+  explicit read_awaiter(detail::registration* const reg) noexcept
+      : reg_(reg) {}
+
+  detail::registration* reg_;
+  detail::waiter        waiter_{};
+  /* Uninitialized, hence 'T' doesn't have to be default constructible. */
+  alignas(T) unsigned char msg_[sizeof(T)];
+};
+
+/* Awaitable returned by 'x9::async_inbox::write'. */
+template <typename T>
+class write_awaiter {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "x9 messages are copied with memcpy");
+
+ public:
+  bool await_ready() noexcept {
+    return reg_->writers.empty() &&
+           x9_write_to_inbox(reg_->inbox, sizeof(T), &msg_);
+  }
+  void await_suspend(std::coroutine_handle<> const handle) noexcept {
+    waiter_ = {handle, &msg_, sizeof(T), nullptr};
+    reg_->writers.push(&waiter_);
+  }
+  void await_resume() noexcept {}
+
+ private:
+  friend class async_inbox;
+  write_awaiter(detail::registration* const reg, T const& msg) noexcept
+      : reg_(reg), msg_(msg) {}
+
+  detail::registration* reg_;
+  detail::waiter        waiter_{};
+  T                     msg_;
+};
+
+/* A x9_inbox attached to a x9::scheduler, returned by 'attach'.
+ * Cheap to copy, and only valid while the scheduler is alive. */
+class async_inbox {
+ public:
+  /* 'co_await' results in the next message of the inbox, 'sizeof(T)' must
+   * be the 'msg_sz' of the inbox. */
+  template <typename T>
+  read_awaiter<T> read() const noexcept {
+    return read_awaiter<T>{reg_};
+  }
+
+  /* 'co_await' completes once 'msg' (copied by the awaitable) was written
+   * to the inbox. */
+  template <typename T>
+  write_awaiter<T> write(T const& msg) const noexcept {
+    return write_awaiter<T>{reg_, msg};
+  }
+
+  x9_inbox* get() const noexcept { return reg_->inbox; }
+
+ private:
+  friend class scheduler;
+  explicit async_inbox(detail::registration* const reg) noexcept
+      : reg_(reg) {}
+
+  detail::registration* reg_;
+};
+
+/* Single threaded scheduler of x9::task(s), all of its member functions
+ * must be called from the same thread.
+ * IMPORTANT: Coroutines read with 'x9_read_from_inbox' and write with
+ * 'x9_write_to_inbox', hence the scheduler must be the only reader of the
+ * inboxes its coroutines read from, and the only writer of the ones they
+ * write to. */
+class scheduler {
+ public:
+  scheduler() = default;
+  scheduler(scheduler const&)            = delete;
+  scheduler& operator=(scheduler const&) = delete;
+
+  /* Destroys the tasks that did not finish. */
+  ~scheduler() {
+    std::vector<std::coroutine_handle<>> pending{ready_};
+    for (auto const& reg : registrations_) {
+      for (detail::waiter* w = reg->readers.head; w; w = w->next) {
+        pending.push_back(w->handle);
+      }
+      for (detail::waiter* w = reg->writers.head; w; w = w->next) {
+        pending.push_back(w->handle);
+      }
+    }
+    for (auto const handle : pending) { handle.destroy(); }
+  }
+
+  /* Returns the handle coroutines of this scheduler use to read from/write
+   * to the 'inbox'. Attaching the same inbox twice returns the same. */
+  async_inbox attach(x9_inbox* const inbox) {
+    for (auto const& reg : registrations_) {
+      if (inbox == reg->inbox) { return async_inbox{reg.get()}; }
+    }
+    registrations_.push_back(std::make_unique<detail::registration>());
+    registrations_.back()->inbox = inbox;
+    return async_inbox{registrations_.back().get()};
+  }
+
+  /* Takes ownership of the task 't', which starts running on the next call
+   * to 'run_once'/'run'. */
+  void spawn(task&& t) {
+    ready_.push_back(std::exchange(t.handle_, {}));
+    ++n_tasks_;
+  }
+
+  /* Moves the coroutines that can now read/write to the ready list, and
+   * resumes all of them, as a batch. Returns the number of resumptions. */
+  uint64_t run_once() {
+    for (auto const& reg : registrations_) {
+      while (!reg->readers.empty()) {
+        detail::waiter* const w = reg->readers.head;
+        if (!x9_read_from_inbox(reg->inbox, w->msg_sz, w->msg)) { break; }
+        ready_.push_back(reg->readers.pop()->handle);
+      }
+      while (!reg->writers.empty()) {
+        detail::waiter* const w = reg->writers.head;
+        if (!x9_write_to_inbox(reg->inbox, w->msg_sz, w->msg)) { break; }
+        ready_.push_back(reg->writers.pop()->handle);
+      }
+    }
+
+    /* Coroutines resumed now may become ready again, for the next batch. */
+    batch_.swap(ready_);
+    for (auto const handle : batch_) {
+      handle.resume();
+      if (handle.done()) {
+        handle.destroy();
+        --n_tasks_;
+      }
+    }
+    uint64_t const n = batch_.size();
+    batch_.clear();
+    return n;
+  }
+
+  /* Runs until every task spawned finished.
+   * IMPORTANT: It spins (with '_mm_pause', without ever yielding the core)
+   * while none of them can make progress, as it is meant for a thread pinned
+   * to its own core. Otherwise call 'run_once' in a loop that backs off
+   * (e.g. 'sched_yield' or sleeping) when it returns 0. */
+  void run() {
+    while (n_tasks_) {
+      if (!run_once()) { _mm_pause(); }
+    }
+  }
+
+  /* Number of tasks spawned that did not finish yet. */
+  uint64_t n_tasks() const noexcept { return n_tasks_; }
+
+ private:
+  std::vector<std::unique_ptr<detail::registration>> registrations_;
+  std::vector<std::coroutine_handle<>>               ready_;
+  std::vector<std::coroutine_handle<>>               batch_;
+  uint64_t                                           n_tasks_ = 0;
+};
+
+}  // namespace x9
@@ -0,0 +1,489 @@
+/*
+   X9 - high performance message passing library.
+   Copyright (c) 2023, Diogo Flores
+
+   BSD 2-Clause License (https://opensource.org/license/bsd-2-clause/)
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are
+   met:
+
+       * Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+       * Redistributions in binary form must reproduce the above
+   copyright notice, this list of conditions and the following disclaimer
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   You can contact the author at: diogoxflores@gmail.com
+*/
+
+/* Layout of the x9_inbox, and its read/write paths as static inline
+ * functions, shared by x9.c and x9.hpp so that 'x9::inbox' is compiled with
+ * 'sizeof(T)' and its capacity as constants. Not part of the API, it is
+ * included (after x9.h) by x9.c and x9.hpp only.
+ * IMPORTANT: 'X9_STATS', 'X9_LATENCY' and 'X9_TRACE' change the layout,
+ * hence code that includes x9.hpp must be compiled with the same ones as
+ * x9.c, otherwise it fails to link ('X9_LAYOUT'). */
+
+#pragma once
+
+#ifdef __cplusplus
+#include <atomic>      /* std::atomic, std::atomic_* */
+#include <cstring>     /* memcpy */
+#else
+#include <stdatomic.h> /* atomic_* */
+#include <string.h>    /* memcpy */
+#endif
+#include <immintrin.h> /* _mm_pause, __rdtsc */
+
+#ifdef __cplusplus
+#define X9_ATOMIC(T) std::atomic<T>
+/* The layout must be the same as the one of '_Atomic(T)' in x9.c. */
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  (sizeof(std::atomic<uint64_t>) == sizeof(uint64_t)) &&
+                  (sizeof(std::atomic<bool>) == sizeof(bool)),
+              "x9 requires lock free atomics");
+#else
+#define X9_ATOMIC(T) _Atomic(T)
+#endif
+
+/* CPU cache line size */
+#define X9_CL_SIZE       64
+#define X9_ALIGN_TO_CL() __attribute__((__aligned__(X9_CL_SIZE)))
+
+/* Constant of the fast modulo of an inbox of 'sz' slots. */
+#define X9_FASTMOD_CONSTANT(sz) (UINT64_C(0xFFFFFFFFFFFFFFFF) / (sz) + 1)
+
+/* Operational counters, only compiled in when 'X9_STATS' is defined. */
+#ifdef X9_STATS
+#define X9_STATS_ADD(inbox, side, counter, n) \
+  atomic_fetch_add_explicit(&(inbox)->side.counter, (n), memory_order_relaxed)
+#else
+#define X9_STATS_ADD(inbox, side, counter, n) ((void)(n))
+#endif
+#define X9_STATS_INC(inbox, side, counter) X9_STATS_ADD(inbox, side, counter, 1)
+
+/* Name of a function of x9.c, which depends on the flags that change the
+ * layout. */
+#ifdef X9_STATS
+#define X9_LAYOUT_STATS _stats
+#else
+#define X9_LAYOUT_STATS
+#endif
+#ifdef X9_LATENCY
+#define X9_LAYOUT_LATENCY _latency
+#else
+#define X9_LAYOUT_LATENCY
+#endif
+#ifdef X9_TRACE
+#define X9_LAYOUT_TRACE _trace
+#else
+#define X9_LAYOUT_TRACE
+#endif
+#define X9_CONCAT_(a, b, c, d) a##b##c##d
+#define X9_CONCAT(a, b, c, d)  X9_CONCAT_(a, b, c, d)
+#define X9_LAYOUT \
+  X9_CONCAT(x9_layout, X9_LAYOUT_STATS, X9_LAYOUT_LATENCY, X9_LAYOUT_TRACE)
+
+/* --- Internal types --- */
+
+typedef struct {
+  X9_ATOMIC(bool) slot_has_data;
+  X9_ATOMIC(bool) msg_written;
+  X9_ATOMIC(bool) shared;
+  char const      pad[5];
+#ifdef X9_LATENCY
+  uint64_t        tsc; /* Taken when the message is published. */
+#endif
+} x9_msg_header;
+
+/* Latency histogram (only compiled in when 'X9_LATENCY' is defined).
+ * Values (in TSC cycles) below 2^X9_LAT_SUB_BITS have their own bucket, and
+ * every power of 2 above that is split in 2^X9_LAT_SUB_BITS linear
+ * sub-buckets, which bounds the relative error of any value to ~3%. */
+#define X9_LAT_SUB_BITS 5
+#define X9_LAT_SUB      (UINT64_C(1) << X9_LAT_SUB_BITS)
+#define X9_LAT_BUCKETS  ((64 - X9_LAT_SUB_BITS + 1) * X9_LAT_SUB)
+
+#ifdef X9_STATS
+typedef struct {
+  X9_ATOMIC(uint64_t) writes;
+  X9_ATOMIC(uint64_t) write_failures;
+  X9_ATOMIC(uint64_t) write_cas_failures;
+  X9_ATOMIC(uint64_t) write_spins;
+  X9_ATOMIC(uint64_t) full_events;
+} x9_producer_stats;
+
+typedef struct {
+  X9_ATOMIC(uint64_t) reads;
+  X9_ATOMIC(uint64_t) read_failures;
+  X9_ATOMIC(uint64_t) read_cas_failures;
+  X9_ATOMIC(uint64_t) read_spins;
+  X9_ATOMIC(uint64_t) empty_events;
+} x9_consumer_stats;
+#endif
+
+typedef struct x9_inbox_internal {
+  X9_ATOMIC(uint64_t) read_idx  X9_ALIGN_TO_CL();
+  X9_ATOMIC(uint64_t) write_idx X9_ALIGN_TO_CL();
+  uint64_t sz                   X9_ALIGN_TO_CL();
+  uint64_t                      msg_sz;
+  uint64_t                      constant;
+  void*                         msgs;
+  char*                         name;
+#ifdef X9_LATENCY
+  X9_ATOMIC(uint64_t)*          latency;
+  char                          pad[16];
+#else
+  char                          pad[24];
+#endif
+  X9_ATOMIC(uint64_t) depth_hwm X9_ALIGN_TO_CL();
+#ifdef X9_TRACE
+  /* Set while the inbox is traced, and writers recording a message to it.
+   * On the line of 'depth_hwm', which writers rarely touch. */
+  X9_ATOMIC(x9_trace*)          trace;
+  X9_ATOMIC(uint64_t)           trace_refs;
+#endif
+#ifdef X9_STATS
+  /* Written by producers and consumers respectively, hence on separate cache
+   * lines. */
+  x9_producer_stats producer_stats X9_ALIGN_TO_CL();
+  x9_consumer_stats consumer_stats X9_ALIGN_TO_CL();
+#endif
+} x9_inbox;
+
+/* What locating a slot takes, either read from the x9_inbox (x9.c) or
+ * compile time constants (x9.hpp). */
+typedef struct {
+  uint64_t sz;
+  uint64_t constant;
+  uint64_t msg_sz;
+} x9_inbox_shape;
+
+/* --- Functions of x9.c --- */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void X9_LAYOUT(void);
+
+#ifdef X9_TRACE
+/* Records the 'msg' written to the 'inbox' to its trace, if still traced. */
+void x9_trace_msg_slow(x9_inbox* const inbox, void const* restrict const msg);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/* --- Internal functions --- */
+
+#ifdef __cplusplus
+namespace x9::detail {
+using std::atomic_compare_exchange_strong_explicit;
+using std::atomic_compare_exchange_weak_explicit;
+using std::atomic_fetch_add_explicit;
+using std::atomic_load_explicit;
+using std::atomic_store_explicit;
+using std::memcpy;
+using std::memory_order_acquire;
+using std::memory_order_relaxed;
+using std::memory_order_release;
+#endif
+
+static inline x9_inbox_shape x9_shape_of(x9_inbox const* const inbox) {
+  x9_inbox_shape const shape = {inbox->sz, inbox->constant, inbox->msg_sz};
+  return shape;
+}
+
+static inline uint64_t x9_fastmod(uint64_t const idx,
+                                  uint64_t const constant,
+                                  uint64_t const sz) {
+  /* From paper: Faster Remainder by Direct Computation, Lemire et al */
+  return ((__uint128_t)(constant * idx) * sz) >> 64;
+}
+
+/* Header of the slot that the (ever increasing) index 'idx' points to. */
+static inline x9_msg_header* x9_slot_header(x9_inbox const* const inbox,
+                                            x9_inbox_shape const  shape,
+                                            uint64_t const        idx) {
+  uint64_t const slot = x9_fastmod(idx, shape.constant, shape.sz);
+  return (x9_msg_header*)&(
+      (char*)inbox->msgs)[slot * (shape.msg_sz + sizeof(x9_msg_header))];
+}
+
+/* Records that the 'inbox' was seen full, without a read-modify-write when
+ * that was already the case. Only called from the writers' slow paths, once
+ * the slot they wanted was found holding an unread message ('msg_written'),
+ * since a lost compare-and-swap says nothing about the depth. */
+static inline void x9_inbox_full_hwm(x9_inbox* const inbox, uint64_t const sz) {
+  if (atomic_load_explicit(&inbox->depth_hwm, memory_order_relaxed) != sz) {
+    atomic_store_explicit(&inbox->depth_hwm, sz, memory_order_relaxed);
+  }
+}
+
+#ifdef X9_LATENCY
+static inline uint64_t x9_lat_bucket(uint64_t const cycles) {
+  if (cycles < X9_LAT_SUB) { return cycles; }
+  uint64_t const shift =
+      (uint64_t)(63 - __builtin_clzll(cycles)) - X9_LAT_SUB_BITS;
+  return ((shift + 1) << X9_LAT_SUB_BITS) + ((cycles >> shift) - X9_LAT_SUB);
+}
+
+static inline void x9_stamp_msg(x9_msg_header* const header) {
+  header->tsc = __rdtsc();
+}
+
+/* Called by readers after acquiring 'msg_written' of the 'header'. */
+static inline void x9_record_latency(x9_inbox* const            inbox,
+                                     x9_msg_header const* const header) {
+  uint64_t const now = __rdtsc();
+  /* TSCs of different cores may be slightly skewed */
+  uint64_t const cycles = (now > header->tsc) ? (now - header->tsc) : 0;
+  atomic_fetch_add_explicit(&inbox->latency[x9_lat_bucket(cycles)], 1,
+                            memory_order_relaxed);
+}
+#else
+#define x9_stamp_msg(header)             ((void)(header))
+#define x9_record_latency(inbox, header) ((void)(inbox), (void)(header))
+#endif
+
+#ifdef X9_TRACE
+/* Called by writers after publishing the 'msg'. Costs a load of a line that
+ * stays shared while the 'inbox' is not traced. */
+static inline void x9_trace_msg(x9_inbox* const inbox,
+                                void const* restrict const msg) {
+  if (__builtin_expect(
+          NULL == atomic_load_explicit(&inbox->trace, memory_order_relaxed),
+          1)) {
+    return;
+  }
+  x9_trace_msg_slow(inbox, msg);
+}
+#else
+#define x9_trace_msg(inbox, msg) ((void)(inbox), (void)(msg))
+#endif
+
+/* The functions below are the ones of x9.h without '_inline', which copy
+ * 'msg_sz' bytes to/from slots of the given 'shape'. */
+
+static inline bool x9_write_to_inbox_inline(x9_inbox* const      inbox,
+                                            x9_inbox_shape const shape,
+                                            uint64_t const       msg_sz,
+                                            void const* restrict const msg) {
+  bool                 f   = false;
+  uint64_t const       idx =
+      atomic_load_explicit(&inbox->write_idx, memory_order_relaxed);
+  x9_msg_header* const header = x9_slot_header(inbox, shape, idx);
+
+  if (atomic_compare_exchange_strong_explicit(&header->slot_has_data, &f, true,
+                                              memory_order_acquire,
+                                              memory_order_relaxed)) {
+    memcpy((char*)header + sizeof(x9_msg_header), msg, msg_sz);
+    atomic_fetch_add_explicit(&inbox->write_idx, 1, memory_order_release);
+    x9_stamp_msg(header);
+    atomic_store_explicit(&header->msg_written, true, memory_order_release);
+    X9_STATS_INC(inbox, producer_stats, writes);
+    x9_trace_msg(inbox, msg);
+    return true;
+  }
+  /* The slot either holds a message that was not read yet, or is being
+   * written (or released) by another thread that won the race for it. */
+  if (atomic_load_explicit(&header->msg_written, memory_order_relaxed)) {
+    x9_inbox_full_hwm(inbox, shape.sz);
+    X9_STATS_INC(inbox, producer_stats, full_events);
+  } else {
+    X9_STATS_INC(inbox, producer_stats, write_cas_failures);
+  }
+  X9_STATS_INC(inbox, producer_stats, write_failures);
+  return false;
+}
+
+static inline void x9_write_to_inbox_spin_inline(
+    x9_inbox* const inbox, x9_inbox_shape const shape, uint64_t const msg_sz,
+    void const* restrict const msg) {
+  uint64_t spins        = 0;
+  uint64_t cas_failures = 0;
+  for (;;) {
+    bool                 f   = false;
+    uint64_t const       idx =
+        atomic_fetch_add_explicit(&inbox->write_idx, 1, memory_order_relaxed);
+    x9_msg_header* const header = x9_slot_header(inbox, shape, idx);
+    if (atomic_compare_exchange_weak_explicit(&header->slot_has_data, &f, true,
+                                              memory_order_acquire,
+                                              memory_order_relaxed)) {
+      memcpy((char*)header + sizeof(x9_msg_header), msg, msg_sz);
+      x9_stamp_msg(header);
+      atomic_store_explicit(&header->msg_written, true, memory_order_release);
+      break;
+    }
+    /* Same as 'x9_write_to_inbox', an occupied slot is not a lost race
+     * ('f' is also left false by a spurious failure). */
+    if (!(f && atomic_load_explicit(&header->msg_written,
+                                    memory_order_relaxed))) {
+      ++cas_failures;
+    }
+    ++spins;
+  }
+  X9_STATS_INC(inbox, producer_stats, writes);
+  x9_trace_msg(inbox, msg);
+  if (spins) {
+    X9_STATS_ADD(inbox, producer_stats, write_cas_failures, cas_failures);
+    X9_STATS_ADD(inbox, producer_stats, write_spins, spins);
+    if (spins != cas_failures) {
+      x9_inbox_full_hwm(inbox, shape.sz);
+      X9_STATS_INC(inbox, producer_stats, full_events);
+    }
+  }
+}
+
+static inline bool x9_read_from_inbox_inline(x9_inbox* const      inbox,
+                                             x9_inbox_shape const shape,
+                                             uint64_t const       msg_sz,
+                                             void* restrict const outparam) {
+  uint64_t const idx =
+      atomic_load_explicit(&inbox->read_idx, memory_order_relaxed);
+  x9_msg_header* const header = x9_slot_header(inbox, shape, idx);
+
+  if (atomic_load_explicit(&header->slot_has_data, memory_order_relaxed)) {
+    if (atomic_load_explicit(&header->msg_written, memory_order_acquire)) {
+      memcpy(outparam, (char*)header + sizeof(x9_msg_header), msg_sz);
+      x9_record_latency(inbox, header);
+      atomic_store_explicit(&header->msg_written, false, memory_order_relaxed);
+      atomic_store_explicit(&header->slot_has_data, false,
+                            memory_order_release);
+      atomic_fetch_add_explicit(&inbox->read_idx, 1, memory_order_release);
+      X9_STATS_INC(inbox, consumer_stats, reads);
+      return true;
+    }
+  } else {
+    X9_STATS_INC(inbox, consumer_stats, empty_events);
+  }
+  X9_STATS_INC(inbox, consumer_stats, read_failures);
+  return false;
+}
+
+static inline void x9_read_from_inbox_spin_inline(
+    x9_inbox* const inbox, x9_inbox_shape const shape, uint64_t const msg_sz,
+    void* restrict const outparam) {
+  uint64_t const idx =
+      atomic_fetch_add_explicit(&inbox->read_idx, 1, memory_order_relaxed);
+  x9_msg_header* const header = x9_slot_header(inbox, shape, idx);
+
+  uint64_t spins = 0;
+  for (;;) {
+    _mm_pause();
+    if (atomic_load_explicit(&header->slot_has_data, memory_order_relaxed)) {
+      if (atomic_load_explicit(&header->msg_written, memory_order_acquire)) {
+        memcpy(outparam, (char*)header + sizeof(x9_msg_header), msg_sz);
+        x9_record_latency(inbox, header);
+        atomic_store_explicit(&header->msg_written, false,
+                              memory_order_relaxed);
+        atomic_store_explicit(&header->slot_has_data, false,
+                              memory_order_release);
+        break;
+      }
+    }
+    ++spins;
+  }
+  X9_STATS_INC(inbox, consumer_stats, reads);
+  if (spins) {
+    X9_STATS_ADD(inbox, consumer_stats, read_spins, spins);
+    X9_STATS_INC(inbox, consumer_stats, empty_events);
+  }
+}
+
+static inline bool x9_read_from_shared_inbox_inline(
+    x9_inbox* const inbox, x9_inbox_shape const shape, uint64_t const msg_sz,
+    void* restrict const outparam) {
+  bool           f   = false;
+  uint64_t const idx =
+      atomic_load_explicit(&inbox->read_idx, memory_order_relaxed);
+  x9_msg_header* const header = x9_slot_header(inbox, shape, idx);
+
+  if (atomic_compare_exchange_strong_explicit(&header->shared, &f, true,
+                                              memory_order_acquire,
+                                              memory_order_relaxed)) {
+    if (atomic_load_explicit(&header->slot_has_data, memory_order_relaxed)) {
+      if (atomic_load_explicit(&header->msg_written, memory_order_acquire)) {
+        memcpy(outparam, (char*)header + sizeof(x9_msg_header), msg_sz);
+        x9_record_latency(inbox, header);
+        atomic_fetch_add_explicit(&inbox->read_idx, 1, memory_order_release);
+        atomic_store_explicit(&header->msg_written, false,
+                              memory_order_relaxed);
+        atomic_store_explicit(&header->slot_has_data, false,
+                              memory_order_release);
+        atomic_store_explicit(&header->shared, false, memory_order_release);
+        X9_STATS_INC(inbox, consumer_stats, reads);
+        return true;
+      }
+    } else {
+      X9_STATS_INC(inbox, consumer_stats, empty_events);
+    }
+    atomic_store_explicit(&header->shared, false, memory_order_release);
+  } else {
+    X9_STATS_INC(inbox, consumer_stats, read_cas_failures);
+  }
+  X9_STATS_INC(inbox, consumer_stats, read_failures);
+  return false;
+}
+
+static inline void x9_read_from_shared_inbox_spin_inline(
+    x9_inbox* const inbox, x9_inbox_shape const shape, uint64_t const msg_sz,
+    void* restrict const outparam) {
+  uint64_t spins        = 0;
+  uint64_t cas_failures = 0;
+  for (;;) {
+    bool           f   = false;
+    uint64_t const idx =
+        atomic_fetch_add_explicit(&inbox->read_idx, 1, memory_order_relaxed);
+    x9_msg_header* const header = x9_slot_header(inbox, shape, idx);
+
+    if (atomic_compare_exchange_strong_explicit(&header->shared, &f, true,
+                                                memory_order_acquire,
+                                                memory_order_relaxed)) {
+      if (atomic_load_explicit(&header->slot_has_data, memory_order_relaxed)) {
+        if (atomic_load_explicit(&header->msg_written, memory_order_acquire)) {
+          memcpy(outparam, (char*)header + sizeof(x9_msg_header), msg_sz);
+          x9_record_latency(inbox, header);
+          atomic_store_explicit(&header->msg_written, false,
+                                memory_order_relaxed);
+          atomic_store_explicit(&header->slot_has_data, false,
+                                memory_order_release);
+          atomic_store_explicit(&header->shared, false, memory_order_release);
+          break;
+        }
+      }
+      atomic_store_explicit(&header->shared, false, memory_order_release);
+    } else {
+      ++cas_failures;
+    }
+    ++spins;
+  }
+  X9_STATS_INC(inbox, consumer_stats, reads);
+  if (spins) {
+    X9_STATS_ADD(inbox, consumer_stats, read_cas_failures, cas_failures);
+    X9_STATS_ADD(inbox, consumer_stats, read_spins, spins);
+    if (spins != cas_failures) {
+      X9_STATS_INC(inbox, consumer_stats, empty_events);
+    }
+  }
+}
+
+#ifdef __cplusplus
+}  // namespace x9::detail
+#endif